@@ -24,8 +24,6 @@ double div_calclator(double left, double right);
 double plus_calclator(double left, double right);
 double minus_calclator(double left, double right);
 
-// トークンに合わせて計算機を取得する
-double (*get_calclator(Token *token))(double left, double right);
 // 何の関数かを調べて計算機を返す。
 double (*get_func_calclator(char *function_name))(double left, double right);
 
@@ -174,4 +172,788 @@ double plus_calclator(double left, double right)
 double minus_calclator(double left, double right)
 {
     return left - right;
+}
+
+/**
+ * ==================================================================
+ *
+ * 以下、自動微分(二重数)用の計算機
+ * a + bε (ε^2 = 0) として計算すると、bに微分係数が求まる。
+ *
+ * ==================================================================
+ */
+
+// 三角関数
+Dual sin_dual_calclator(Dual left, Dual right);
+Dual cos_dual_calclator(Dual left, Dual right);
+Dual tan_dual_calclator(Dual left, Dual right);
+
+// 指数対数関数
+Dual exp_dual_calclator(Dual left, Dual right);
+Dual log_dual_calclator(Dual left, Dual right);
+
+// 符号逆にする計算機
+Dual minus_mono_dual_calclator(Dual left, Dual right);
+
+// 四則演算計算機
+Dual times_dual_calclator(Dual left, Dual right);
+Dual div_dual_calclator(Dual left, Dual right);
+Dual plus_dual_calclator(Dual left, Dual right);
+Dual minus_dual_calclator(Dual left, Dual right);
+
+// トークンに合わせて自動微分用の計算機を取得する
+Dual (*get_dual_calclator(Token *token))(Dual left, Dual right);
+
+Dual calclate_dual(double x, Node *node)
+{
+    // 定数の場合(微分係数は0)
+    if (node->token->type == num || node->token->type == e || node->token->type == pi)
+    {
+        Dual result = {calclate(x, node), 0};
+        return result;
+    }
+    // 変数の場合(dx/dx = 1)
+    if (node->token->type == variable)
+    {
+        Dual result = {x, 1};
+        return result;
+    }
+
+    Dual (*calclator)(Dual left, Dual right) = get_dual_calclator(node->token);
+    Dual left = {0, 0}, right = {0, 0};
+    if (calclator == NULL)
+    {
+        return left;
+    }
+    if (node->left != NULL)
+    {
+        left = calclate_dual(x, node->left);
+    }
+    if (node->right != NULL)
+    {
+        right = calclate_dual(x, node->right);
+    }
+    return calclator(left, right);
+}
+
+// get_calclator()と同じ対応で、二重数用の計算機を返す。
+Dual (*get_dual_calclator(Token *token))(Dual left, Dual right)
+{
+    double (*calclator)(double left, double right) = get_calclator(token);
+    if (calclator == sin_calclator)
+    {
+        return sin_dual_calclator;
+    }
+    else if (calclator == cos_calclator)
+    {
+        return cos_dual_calclator;
+    }
+    else if (calclator == tan_calclator)
+    {
+        return tan_dual_calclator;
+    }
+    else if (calclator == log_calclator)
+    {
+        return log_dual_calclator;
+    }
+    else if (calclator == exp_calclator)
+    {
+        return exp_dual_calclator;
+    }
+    else if (calclator == minus_mono_calclator)
+    {
+        return minus_mono_dual_calclator;
+    }
+    else if (calclator == times_calclator)
+    {
+        return times_dual_calclator;
+    }
+    else if (calclator == div_calclator)
+    {
+        return div_dual_calclator;
+    }
+    else if (calclator == plus_calclator)
+    {
+        return plus_dual_calclator;
+    }
+    else if (calclator == minus_calclator)
+    {
+        return minus_dual_calclator;
+    }
+    return NULL;
+}
+
+Dual sin_dual_calclator(Dual left, Dual right)
+{
+    Dual result = {sin(right.value), cos(right.value) * right.derivative};
+    return result;
+}
+Dual cos_dual_calclator(Dual left, Dual right)
+{
+    Dual result = {cos(right.value), -sin(right.value) * right.derivative};
+    return result;
+}
+Dual tan_dual_calclator(Dual left, Dual right)
+{
+    double c = cos(right.value);
+    Dual result = {tan(right.value), right.derivative / (c * c)};
+    return result;
+}
+Dual exp_dual_calclator(Dual left, Dual right)
+{
+    Dual result = {pow(left.value, right.value), 0};
+    // 指数が定数の場合は (u^n)' = n * u^(n-1) * u' (底が負でも計算できるように分けている)
+    if (right.derivative == 0)
+    {
+        if (left.derivative != 0)
+        {
+            result.derivative = right.value * pow(left.value, right.value - 1) * left.derivative;
+        }
+        return result;
+    }
+    // (u^v)' = u^v * (v' * log(u) + v * u' / u)
+    result.derivative = result.value * (right.derivative * log(left.value) + right.value * left.derivative / left.value);
+    return result;
+}
+Dual log_dual_calclator(Dual left, Dual right)
+{
+    Dual result = {log(right.value), right.derivative / right.value};
+    return result;
+}
+Dual minus_mono_dual_calclator(Dual left, Dual right)
+{
+    Dual result = {-right.value, -right.derivative};
+    return result;
+}
+
+Dual times_dual_calclator(Dual left, Dual right)
+{
+    Dual result = {left.value * right.value, left.derivative * right.value + left.value * right.derivative};
+    return result;
+}
+Dual div_dual_calclator(Dual left, Dual right)
+{
+    Dual result = {left.value / right.value,
+                   (left.derivative * right.value - left.value * right.derivative) / (right.value * right.value)};
+    return result;
+}
+Dual plus_dual_calclator(Dual left, Dual right)
+{
+    Dual result = {left.value + right.value, left.derivative + right.derivative};
+    return result;
+}
+Dual minus_dual_calclator(Dual left, Dual right)
+{
+    Dual result = {left.value - right.value, left.derivative - right.derivative};
+    return result;
+}
+
+
+/**
+ * ==================================================================
+ *
+ * 以下、2階の自動微分用の計算機
+ * 値と1階・2階の微分係数の組を、合成関数の微分法則で伝える。
+ *
+ * ==================================================================
+ */
+
+// 三角関数
+Dual2 sin_dual2_calclator(Dual2 left, Dual2 right);
+Dual2 cos_dual2_calclator(Dual2 left, Dual2 right);
+Dual2 tan_dual2_calclator(Dual2 left, Dual2 right);
+
+// 指数対数関数
+Dual2 exp_dual2_calclator(Dual2 left, Dual2 right);
+Dual2 log_dual2_calclator(Dual2 left, Dual2 right);
+
+// 符号逆にする計算機
+Dual2 minus_mono_dual2_calclator(Dual2 left, Dual2 right);
+
+// 四則演算計算機
+Dual2 times_dual2_calclator(Dual2 left, Dual2 right);
+Dual2 div_dual2_calclator(Dual2 left, Dual2 right);
+Dual2 plus_dual2_calclator(Dual2 left, Dual2 right);
+Dual2 minus_dual2_calclator(Dual2 left, Dual2 right);
+
+// トークンに合わせて2階の自動微分用の計算機を取得する
+Dual2 (*get_dual2_calclator(Token *token))(Dual2 left, Dual2 right);
+// 値と微分係数の組を生成する。
+Dual2 make_dual2(double value, double derivative, double second_derivative);
+
+Dual2 calclate_dual2(double x, Node *node)
+{
+    // 定数の場合(微分係数は0)
+    if (node->token->type == num || node->token->type == e || node->token->type == pi)
+    {
+        return make_dual2(calclate(x, node), 0, 0);
+    }
+    // 変数の場合(dx/dx = 1)
+    if (node->token->type == variable)
+    {
+        return make_dual2(x, 1, 0);
+    }
+
+    Dual2 (*calclator)(Dual2 left, Dual2 right) = get_dual2_calclator(node->token);
+    Dual2 left = make_dual2(0, 0, 0), right = make_dual2(0, 0, 0);
+    if (calclator == NULL)
+    {
+        return left;
+    }
+    if (node->left != NULL)
+    {
+        left = calclate_dual2(x, node->left);
+    }
+    if (node->right != NULL)
+    {
+        right = calclate_dual2(x, node->right);
+    }
+    return calclator(left, right);
+}
+
+// get_calclator()と同じ対応で、2階の自動微分用の計算機を返す。
+Dual2 (*get_dual2_calclator(Token *token))(Dual2 left, Dual2 right)
+{
+    double (*calclator)(double left, double right) = get_calclator(token);
+    if (calclator == sin_calclator)
+    {
+        return sin_dual2_calclator;
+    }
+    else if (calclator == cos_calclator)
+    {
+        return cos_dual2_calclator;
+    }
+    else if (calclator == tan_calclator)
+    {
+        return tan_dual2_calclator;
+    }
+    else if (calclator == log_calclator)
+    {
+        return log_dual2_calclator;
+    }
+    else if (calclator == exp_calclator)
+    {
+        return exp_dual2_calclator;
+    }
+    else if (calclator == minus_mono_calclator)
+    {
+        return minus_mono_dual2_calclator;
+    }
+    else if (calclator == times_calclator)
+    {
+        return times_dual2_calclator;
+    }
+    else if (calclator == div_calclator)
+    {
+        return div_dual2_calclator;
+    }
+    else if (calclator == plus_calclator)
+    {
+        return plus_dual2_calclator;
+    }
+    else if (calclator == minus_calclator)
+    {
+        return minus_dual2_calclator;
+    }
+    return NULL;
+}
+
+Dual2 make_dual2(double value, double derivative, double second_derivative)
+{
+    Dual2 result = {value, derivative, second_derivative};
+    return result;
+}
+
+// (f(u))'' = f''(u) * u'^2 + f'(u) * u''
+Dual2 sin_dual2_calclator(Dual2 left, Dual2 right)
+{
+    double s = sin(right.value), c = cos(right.value);
+    return make_dual2(s, c * right.derivative, -s * right.derivative * right.derivative + c * right.second_derivative);
+}
+Dual2 cos_dual2_calclator(Dual2 left, Dual2 right)
+{
+    double s = sin(right.value), c = cos(right.value);
+    return make_dual2(c, -s * right.derivative, -c * right.derivative * right.derivative - s * right.second_derivative);
+}
+Dual2 tan_dual2_calclator(Dual2 left, Dual2 right)
+{
+    double t = tan(right.value);
+    // tan' = 1 + tan^2, tan'' = 2 * tan * (1 + tan^2)
+    double d = 1 + t * t;
+    return make_dual2(t, d * right.derivative, 2 * t * d * right.derivative * right.derivative + d * right.second_derivative);
+}
+Dual2 exp_dual2_calclator(Dual2 left, Dual2 right)
+{
+    double value = pow(left.value, right.value);
+    // 指数が定数の場合は (u^n)' = n * u^(n-1) * u' (底が負でも計算できるように分けている)
+    if (right.derivative == 0 && right.second_derivative == 0)
+    {
+        double n = right.value;
+        if (left.derivative == 0 && left.second_derivative == 0)
+        {
+            return make_dual2(value, 0, 0);
+        }
+        double d1 = n * pow(left.value, n - 1);
+        double d2 = n * (n - 1) * pow(left.value, n - 2);
+        return make_dual2(value, d1 * left.derivative, d2 * left.derivative * left.derivative + d1 * left.second_derivative);
+    }
+    // u^v = e^g (g = v * log(u)) として、(e^g)'' = e^g * (g'^2 + g'')
+    double log_u = log(left.value);
+    double g1 = right.derivative * log_u + right.value * left.derivative / left.value;
+    double g2 = right.second_derivative * log_u + 2 * right.derivative * left.derivative / left.value +
+                right.value * (left.second_derivative / left.value - left.derivative * left.derivative / (left.value * left.value));
+    return make_dual2(value, value * g1, value * (g1 * g1 + g2));
+}
+Dual2 log_dual2_calclator(Dual2 left, Dual2 right)
+{
+    double u = right.value;
+    return make_dual2(log(u), right.derivative / u, right.second_derivative / u - right.derivative * right.derivative / (u * u));
+}
+Dual2 minus_mono_dual2_calclator(Dual2 left, Dual2 right)
+{
+    return make_dual2(-right.value, -right.derivative, -right.second_derivative);
+}
+
+Dual2 times_dual2_calclator(Dual2 left, Dual2 right)
+{
+    return make_dual2(left.value * right.value, left.derivative * right.value + left.value * right.derivative,
+                      left.second_derivative * right.value + 2 * left.derivative * right.derivative + left.value * right.second_derivative);
+}
+// q = u / v とすると、q' = (u' - q * v') / v, q'' = (u'' - 2 * q' * v' - q * v'') / v
+Dual2 div_dual2_calclator(Dual2 left, Dual2 right)
+{
+    double q = left.value / right.value;
+    double q1 = (left.derivative - q * right.derivative) / right.value;
+    double q2 = (left.second_derivative - 2 * q1 * right.derivative - q * right.second_derivative) / right.value;
+    return make_dual2(q, q1, q2);
+}
+Dual2 plus_dual2_calclator(Dual2 left, Dual2 right)
+{
+    return make_dual2(left.value + right.value, left.derivative + right.derivative, left.second_derivative + right.second_derivative);
+}
+Dual2 minus_dual2_calclator(Dual2 left, Dual2 right)
+{
+    return make_dual2(left.value - right.value, left.derivative - right.derivative, left.second_derivative - right.second_derivative);
+}
+
+/**
+ * ==================================================================
+ *
+ * 以下、区間演算用の計算機
+ * 引数の区間内のどの値で計算しても、結果が必ず結果の区間に入るように計算する。
+ *
+ * ==================================================================
+ */
+
+// 三角関数
+Interval sin_interval_calclator(Interval left, Interval right);
+Interval cos_interval_calclator(Interval left, Interval right);
+Interval tan_interval_calclator(Interval left, Interval right);
+
+// 指数対数関数
+Interval exp_interval_calclator(Interval left, Interval right);
+Interval log_interval_calclator(Interval left, Interval right);
+
+// 符号逆にする計算機
+Interval minus_mono_interval_calclator(Interval left, Interval right);
+
+// 四則演算計算機
+Interval times_interval_calclator(Interval left, Interval right);
+Interval div_interval_calclator(Interval left, Interval right);
+Interval plus_interval_calclator(Interval left, Interval right);
+Interval minus_interval_calclator(Interval left, Interval right);
+
+// トークンに合わせて区間演算用の計算機を取得する
+Interval (*get_interval_calclator(Token *token))(Interval left, Interval right);
+// 区間を生成する
+Interval make_interval(double low, double high, bool is_continuous);
+// 値がどうなるか分からない区間(実数全体で、連続とは限らない)
+Interval unknown_interval();
+// 区間を整数乗する
+Interval integer_power_interval(Interval base, int n);
+// calclate_interval_xy()の本体。max_absがNULLでなければ、途中の値の絶対値の上限の最大値をそこに求める。
+Interval calclate_interval_node(Interval x, Interval y, Node *node, const char *y_name, double *max_abs);
+// 区間の絶対値の上限でmax_absを更新する。(NaNの端は無視する)
+Interval record_magnitude(Interval value, double *max_abs);
+
+Interval calclate_interval(Interval x, Node *node)
+{
+    return calclate_interval_with_parameter(x, node, NULL, 0);
+}
+
+Interval calclate_interval_with_parameter(Interval x, Node *node, const char *parameter_name, double parameter)
+{
+    // パラメータは幅0の区間を動く変数と同じ。
+    return calclate_interval_xy(x, make_interval(parameter, parameter, true), node, parameter_name);
+}
+
+Interval calclate_interval_xy(Interval x, Interval y, Node *node, const char *y_name)
+{
+    return calclate_interval_node(x, y, node, y_name, NULL);
+}
+
+Interval calclate_interval_magnitude(Interval x, Node *node, double *max_abs)
+{
+    *max_abs = 0;
+    return calclate_interval_node(x, make_interval(0, 0, true), node, NULL, max_abs);
+}
+
+Interval calclate_interval_node(Interval x, Interval y, Node *node, const char *y_name, double *max_abs)
+{
+    // 定数の場合
+    if (node->token->type == num || node->token->type == e || node->token->type == pi)
+    {
+        double value = calclate(0, node);
+        return record_magnitude(make_interval(value, value, true), max_abs);
+    }
+    // 変数の場合
+    if (node->token->type == variable)
+    {
+        if (y_name != NULL && strcmp(node->token->data, y_name) == 0)
+        {
+            return record_magnitude(y, max_abs);
+        }
+        return record_magnitude(x, max_abs);
+    }
+
+    Interval (*calclator)(Interval left, Interval right) = get_interval_calclator(node->token);
+    Interval left = make_interval(0, 0, true), right = make_interval(0, 0, true);
+    if (calclator == NULL)
+    {
+        return left;
+    }
+    if (node->left != NULL)
+    {
+        left = calclate_interval_node(x, y, node->left, y_name, max_abs);
+    }
+    if (node->right != NULL)
+    {
+        right = calclate_interval_node(x, y, node->right, y_name, max_abs);
+    }
+    return record_magnitude(calclator(left, right), max_abs);
+}
+
+Interval record_magnitude(Interval value, double *max_abs)
+{
+    if (max_abs != NULL)
+    {
+        *max_abs = fmax(*max_abs, fmax(fabs(value.low), fabs(value.high)));
+    }
+    return value;
+}
+
+// get_calclator()と同じ対応で、区間演算用の計算機を返す。
+Interval (*get_interval_calclator(Token *token))(Interval left, Interval right)
+{
+    double (*calclator)(double left, double right) = get_calclator(token);
+    if (calclator == sin_calclator)
+    {
+        return sin_interval_calclator;
+    }
+    else if (calclator == cos_calclator)
+    {
+        return cos_interval_calclator;
+    }
+    else if (calclator == tan_calclator)
+    {
+        return tan_interval_calclator;
+    }
+    else if (calclator == log_calclator)
+    {
+        return log_interval_calclator;
+    }
+    else if (calclator == exp_calclator)
+    {
+        return exp_interval_calclator;
+    }
+    else if (calclator == minus_mono_calclator)
+    {
+        return minus_mono_interval_calclator;
+    }
+    else if (calclator == times_calclator)
+    {
+        return times_interval_calclator;
+    }
+    else if (calclator == div_calclator)
+    {
+        return div_interval_calclator;
+    }
+    else if (calclator == plus_calclator)
+    {
+        return plus_interval_calclator;
+    }
+    else if (calclator == minus_calclator)
+    {
+        return minus_interval_calclator;
+    }
+    return NULL;
+}
+
+Interval make_interval(double low, double high, bool is_continuous)
+{
+    Interval result = {low, high, is_continuous};
+    return result;
+}
+
+Interval unknown_interval()
+{
+    return make_interval(-INFINITY, INFINITY, false);
+}
+
+// sin(x)が最大(1)になるのは x = pi/2 + 2k*pi、最小(-1)になるのは x = -pi/2 + 2k*pi
+Interval sin_interval_calclator(Interval left, Interval right)
+{
+    double pi_value = 3.1415926535897932;
+    if (!(right.high - right.low < 2 * pi_value))
+    {
+        // 1周期以上の幅があれば、すべての値をとる。(NaNの場合もここに来る)
+        return make_interval(-1, 1, right.is_continuous);
+    }
+    double a = sin(right.low), b = sin(right.high);
+    Interval result = make_interval(fmin(a, b), fmax(a, b), right.is_continuous);
+    // 区間内に最大・最小となる点があるか調べる。
+    double k_max = ceil((right.low - pi_value / 2) / (2 * pi_value));
+    if (pi_value / 2 + 2 * pi_value * k_max <= right.high)
+    {
+        result.high = 1;
+    }
+    double k_min = ceil((right.low + pi_value / 2) / (2 * pi_value));
+    if (-pi_value / 2 + 2 * pi_value * k_min <= right.high)
+    {
+        result.low = -1;
+    }
+    return result;
+}
+// cos(x) = sin(x + pi/2)
+Interval cos_interval_calclator(Interval left, Interval right)
+{
+    double pi_value = 3.1415926535897932;
+    return sin_interval_calclator(left, make_interval(right.low + pi_value / 2, right.high + pi_value / 2, right.is_continuous));
+}
+// tan(x)は極(x = pi/2 + k*pi)の間では単調増加
+Interval tan_interval_calclator(Interval left, Interval right)
+{
+    double pi_value = 3.1415926535897932;
+    double k = ceil((right.low - pi_value / 2) / pi_value);
+    if (!(right.high - right.low < pi_value) || pi_value / 2 + pi_value * k <= right.high)
+    {
+        // 極を含む
+        return unknown_interval();
+    }
+    return make_interval(tan(right.low), tan(right.high), right.is_continuous);
+}
+Interval exp_interval_calclator(Interval left, Interval right)
+{
+    bool is_continuous = left.is_continuous && right.is_continuous;
+    // 指数が整数の定数の場合
+    if (right.low == right.high && right.low == floor(right.low) && fabs(right.low) < 1 << 30)
+    {
+        Interval result = integer_power_interval(left, (int)right.low);
+        result.is_continuous = result.is_continuous && is_continuous;
+        return result;
+    }
+    // 底が正の場合、 u^v = exp(v * log(u)) で v * log(u) は各引数について単調なので、端点の組み合わせで最大・最小が決まる。
+    if (left.low > 0)
+    {
+        double values[] = {pow(left.low, right.low), pow(left.low, right.high),
+                           pow(left.high, right.low), pow(left.high, right.high)};
+        Interval result = make_interval(values[0], values[0], is_continuous);
+        int i;
+        for (i = 1; i < 4; i++)
+        {
+            result.low = fmin(result.low, values[i]);
+            result.high = fmax(result.high, values[i]);
+        }
+        return result;
+    }
+    // 底がすべて負の場合は定義されない。
+    if (left.high < 0)
+    {
+        return make_interval(NAN, NAN, false);
+    }
+    // 底が0以上で指数が正の場合は、0から最大値まで。
+    if (left.low == 0 && right.low > 0)
+    {
+        return make_interval(0, fmax(pow(left.high, right.low), pow(left.high, right.high)), is_continuous);
+    }
+    // 負の底(定義されない部分がある)や、0の負の乗数(極)を含む。
+    return unknown_interval();
+}
+Interval log_interval_calclator(Interval left, Interval right)
+{
+    // 定義域(x > 0)の外
+    if (right.high <= 0)
+    {
+        return make_interval(NAN, NAN, false);
+    }
+    // 定義域の端を含む
+    if (right.low <= 0)
+    {
+        return make_interval(-INFINITY, log(right.high), false);
+    }
+    return make_interval(log(right.low), log(right.high), right.is_continuous);
+}
+Interval minus_mono_interval_calclator(Interval left, Interval right)
+{
+    return make_interval(-right.high, -right.low, right.is_continuous);
+}
+
+Interval times_interval_calclator(Interval left, Interval right)
+{
+    double lefts[] = {left.low, left.low, left.high, left.high};
+    double rights[] = {right.low, right.high, right.low, right.high};
+    double values[4];
+    int i;
+    for (i = 0; i < 4; i++)
+    {
+        values[i] = lefts[i] * rights[i];
+        // 0と無限大の積(NAN)は、区間内の有限の値との積の極限として0にする。(定義された区間どうしの積を、定義されない範囲とみなさないように)
+        if (isnan(values[i]) && !isnan(lefts[i]) && !isnan(rights[i]))
+        {
+            values[i] = 0;
+        }
+    }
+    Interval result = make_interval(values[0], values[0], left.is_continuous && right.is_continuous);
+    for (i = 1; i < 4; i++)
+    {
+        result.low = fmin(result.low, values[i]);
+        result.high = fmax(result.high, values[i]);
+    }
+    return result;
+}
+Interval div_interval_calclator(Interval left, Interval right)
+{
+    // 0で割る可能性がある場合は極を含む。
+    if (right.low <= 0 && 0 <= right.high)
+    {
+        return unknown_interval();
+    }
+    return times_interval_calclator(left, make_interval(1 / right.high, 1 / right.low, right.is_continuous));
+}
+Interval plus_interval_calclator(Interval left, Interval right)
+{
+    return make_interval(left.low + right.low, left.high + right.high, left.is_continuous && right.is_continuous);
+}
+Interval minus_interval_calclator(Interval left, Interval right)
+{
+    return make_interval(left.low - right.high, left.high - right.low, left.is_continuous && right.is_continuous);
+}
+
+Interval integer_power_interval(Interval base, int n)
+{
+    if (n == 0)
+    {
+        return make_interval(1, 1, base.is_continuous);
+    }
+    // 負の乗数は逆数にする。
+    if (n < 0)
+    {
+        return div_interval_calclator(make_interval(1, 1, true), integer_power_interval(base, -n));
+    }
+    double a = pow(base.low, n), b = pow(base.high, n);
+    // 奇数乗は単調増加
+    if (n % 2 == 1)
+    {
+        return make_interval(a, b, base.is_continuous);
+    }
+    // 偶数乗は0を含む場合は0が最小
+    if (base.low <= 0 && 0 <= base.high)
+    {
+        return make_interval(0, fmax(a, b), base.is_continuous);
+    }
+    return make_interval(fmin(a, b), fmax(a, b), base.is_continuous);
+}
+
+/**
+ * ==================================================================
+ *
+ * 以下、1次式の判定用の計算機
+ * 部分式をそれぞれ a * x + b の形で表し、1次式のまま計算できない演算があれば1次式ではないとする。
+ *
+ * ==================================================================
+ */
+
+// 1次式を生成する。
+Affine make_affine(double slope, double intercept, bool is_affine);
+
+Affine calclate_affine(Node *node, const char *parameter_name, double parameter)
+{
+    // 定数の場合
+    if (node->token->type == num || node->token->type == e || node->token->type == pi)
+    {
+        return make_affine(0, calclate(0, node), true);
+    }
+    // 変数の場合
+    if (node->token->type == variable)
+    {
+        if (parameter_name != NULL && strcmp(node->token->data, parameter_name) == 0)
+        {
+            return make_affine(0, parameter, true);
+        }
+        return make_affine(1, 0, true);
+    }
+
+    double (*calclator)(double left, double right) = get_calclator(node->token);
+    Affine left = make_affine(0, 0, true), right = make_affine(0, 0, true);
+    if (calclator == NULL)
+    {
+        return left;
+    }
+    if (node->left != NULL)
+    {
+        left = calclate_affine(node->left, parameter_name, parameter);
+    }
+    if (node->right != NULL)
+    {
+        right = calclate_affine(node->right, parameter_name, parameter);
+    }
+    if (!left.is_affine || !right.is_affine)
+    {
+        return make_affine(0, 0, false);
+    }
+    Affine result = make_affine(0, 0, false);
+    // 引数がどちらも定数なら、どの演算でも結果は定数になる。
+    if (left.slope == 0 && right.slope == 0)
+    {
+        result = make_affine(0, calclator(left.intercept, right.intercept), true);
+    }
+    else if (calclator == plus_calclator)
+    {
+        result = make_affine(left.slope + right.slope, left.intercept + right.intercept, true);
+    }
+    else if (calclator == minus_calclator)
+    {
+        result = make_affine(left.slope - right.slope, left.intercept - right.intercept, true);
+    }
+    else if (calclator == minus_mono_calclator)
+    {
+        result = make_affine(-right.slope, -right.intercept, true);
+    }
+    // 積は片方が定数の場合、商は割る数が定数の場合だけ1次式になる。
+    else if (calclator == times_calclator && (left.slope == 0 || right.slope == 0))
+    {
+        result = left.slope == 0 ? make_affine(left.intercept * right.slope, left.intercept * right.intercept, true)
+                                 : make_affine(right.intercept * left.slope, right.intercept * left.intercept, true);
+    }
+    else if (calclator == div_calclator && right.slope == 0)
+    {
+        result = make_affine(left.slope / right.intercept, left.intercept / right.intercept, true);
+    }
+    // 1乗はそのまま
+    else if (calclator == exp_calclator && right.slope == 0 && right.intercept == 1)
+    {
+        result = left;
+    }
+    // 0での除算などで係数が有限でなくなった場合は、1次式として扱わない。
+    if (!isfinite(result.slope) || !isfinite(result.intercept))
+    {
+        result.is_affine = false;
+    }
+    return result;
+}
+
+Affine make_affine(double slope, double intercept, bool is_affine)
+{
+    Affine result = {slope, intercept, is_affine};
+    return result;
 }
\ No newline at end of file
@@ -1,8 +1,67 @@
 #ifndef CALCLATOR
 #define CALCLATOR
 
+#include <stdbool.h>
 #include "parser.h"
 
+// 値と微分係数の組(二重数)
+typedef struct dual
+{
+    // 値 f(x)
+    double value;
+    // 微分係数 f'(x)
+    double derivative;
+} Dual;
+
+// 値と1階・2階の微分係数の組
+typedef struct dual2
+{
+    // 値 f(x)
+    double value;
+    // 微分係数 f'(x)
+    double derivative;
+    // 2階微分係数 f''(x)
+    double second_derivative;
+} Dual2;
+
+// 区間(値の範囲)
+typedef struct interval
+{
+    // 下端
+    double low;
+    // 上端
+    double high;
+    // 区間内で連続(かつ定義されている)ことが保証できればtrue。極(0での除算, tanの極)や定義域の端を含む場合はfalse
+    bool is_continuous;
+} Interval;
+
+// 1次式 slope * x + intercept
+typedef struct affine
+{
+    // 傾き
+    double slope;
+    // 切片
+    double intercept;
+    // xについて1次以下の式であればtrue(falseの場合、傾きと切片は意味を持たない)
+    bool is_affine;
+} Affine;
+
 // 二分木を用いて計算する。
 double calclate(double x, Node *node);
+// トークンに合わせて計算機を取得する。(演算子や関数でなければNULL)
+double (*get_calclator(Token *token))(double left, double right);
+// 二分木を用いて、値と微分係数を1回で計算する。(前進型の自動微分)
+Dual calclate_dual(double x, Node *node);
+// 二分木を用いて、値と1階・2階の微分係数を1回で計算する。(ハレー法などの2階微分を使う解法用)
+Dual2 calclate_dual2(double x, Node *node);
+// 二分木を用いて、xが区間内を動いた時の値の範囲を計算する。(区間演算)
+Interval calclate_interval(Interval x, Node *node);
+// calclate_interval()と同じだが、parameter_nameという名前の変数はxではなく定数parameterとして扱う。
+Interval calclate_interval_with_parameter(Interval x, Node *node, const char *parameter_name, double parameter);
+// calclate_interval()と同じだが、y_nameという名前の変数はxではなく区間yを動く変数として扱う。(2変数の式用)
+Interval calclate_interval_xy(Interval x, Interval y, Node *node, const char *y_name);
+// calclate_interval()と同じだが、途中の値(定数・変数を含む)の絶対値の上限の最大値もmax_absに求める。(floatで計算できるかの判定用)
+Interval calclate_interval_magnitude(Interval x, Node *node, double *max_abs);
+// 式がxの1次式(定数を含む)かを調べ、傾きと切片を求める。parameter_nameという名前の変数は定数parameterとして扱う。(NULLなら、すべての変数をxとして扱う)
+Affine calclate_affine(Node *node, const char *parameter_name, double parameter);
 #endif
\ No newline at end of file
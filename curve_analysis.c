@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdbool.h>
+#include "parser.h"
+#include "calclator.h"
+#include "graph_writer.h"
+#include "parallel.h"
+#include "root_finder.h"
+#include "curve_analysis.h"
+
+// 1つのスレッドがまとめて処理する仕事(1つの曲線の極値、または1組の曲線の交点を探す)の数
+#define FEATURE_CHUNK_SIZE 32
+// 求め直した解を採用する残差の上限(値の大きさに対する相対誤差)
+#define FEATURE_RESIDUAL_TOLERANCE 1.0e-6
+
+// 見つかった点の配列
+typedef struct feature_list
+{
+    CurveFeature *features;
+    int count;
+    int capacity;
+} FeatureList;
+
+// スレッド間で共有する情報
+typedef struct feature_work
+{
+    Node **nodes;
+    int curve_count;
+    // 描画と同じ点の集合
+    GraphSamples *samples;
+    // 仕事の数(曲線の数 + 曲線の組の数)
+    int task_count;
+    // まとまりごとに見つかった点(まとまりの順に連結するので、スレッドの数によらず同じ結果になる)
+    FeatureList *lists;
+    // 画像に写る範囲
+    double x_min, x_max, y_min, y_max;
+} FeatureWork;
+
+// 交点を求める2つの曲線
+typedef struct curve_pair
+{
+    Node *a;
+    Node *b;
+} CurvePair;
+
+// FEATURE_CHUNK_SIZE個の仕事を処理する。
+void find_features_chunk(int chunk_index, void *context);
+// 曲線の極値を探す。
+void find_extrema(FeatureWork *work, int curve, FeatureList *list);
+// 2つの曲線の交点を探す。
+void find_intersections(FeatureWork *work, int a, int b, FeatureList *list);
+// 点を追加する。(画像に写らない点は追加しない)
+void add_feature(FeatureWork *work, FeatureList *list, FeatureType type, int curve, int other_curve, double x, double y);
+// 区間[x0, x1]で符号の変わる関数の解をブレント法で求める。(見つからなければNAN)
+double refine_root(RootFunction function, void *userdata, double x0, double x1);
+// 2つの曲線の差(userdataはCurvePair)
+void evaluate_difference(double x, int order, double *values, void *userdata);
+// 曲線の微分係数(userdataはNode)
+void evaluate_slope(double x, int order, double *values, void *userdata);
+// x座標の順に並べるための比較関数
+int compare_feature(const void *a, const void *b);
+
+const char *get_feature_type_name(FeatureType type)
+{
+    switch (type)
+    {
+    case feature_intersection:
+        return "交点";
+    case feature_minimum:
+        return "極小";
+    case feature_maximum:
+        return "極大";
+    default:
+        return "不明";
+    }
+}
+
+int find_curve_features(Node **nodes, int count, Accuracy accuracy, CurveFeature **features, int thread_count)
+{
+    FeatureWork work;
+    work.nodes = nodes;
+    work.curve_count = count;
+    // 点の集合は全曲線をまとめて1回で計算し、各スレッドは読むだけにする。
+    work.samples = sample_graph_expressions(nodes, count, accuracy);
+    work.task_count = count + count * (count - 1) / 2;
+    get_graph_x_range(&work.x_min, &work.x_max);
+    get_graph_y_range(&work.y_min, &work.y_max);
+    int chunk_count = (work.task_count + FEATURE_CHUNK_SIZE - 1) / FEATURE_CHUNK_SIZE;
+    work.lists = (FeatureList *)calloc(chunk_count + 1, sizeof(FeatureList));
+    if (work.lists == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    parallel_for(chunk_count, find_features_chunk, &work, thread_count);
+
+    int total = 0, i;
+    for (i = 0; i < chunk_count; i++)
+    {
+        total += work.lists[i].count;
+    }
+    *features = (CurveFeature *)malloc(sizeof(CurveFeature) * (total + 1));
+    if (*features == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    total = 0;
+    for (i = 0; i < chunk_count; i++)
+    {
+        int j;
+        for (j = 0; j < work.lists[i].count; j++)
+        {
+            (*features)[total++] = work.lists[i].features[j];
+        }
+        free(work.lists[i].features);
+    }
+    qsort(*features, total, sizeof(CurveFeature), compare_feature);
+    free(work.lists);
+    dispose_graph_samples(work.samples);
+    return total;
+}
+
+// 仕事の番号が曲線の数より小さければその曲線の極値を、そうでなければ曲線の組(0, 1), (0, 2), ..., (1, 2), ...の交点を探す。
+void find_features_chunk(int chunk_index, void *context)
+{
+    FeatureWork *work = (FeatureWork *)context;
+    FeatureList *list = work->lists + chunk_index;
+    int first = chunk_index * FEATURE_CHUNK_SIZE;
+    int last = first + FEATURE_CHUNK_SIZE < work->task_count ? first + FEATURE_CHUNK_SIZE : work->task_count;
+    int task = first;
+    for (; task < last && task < work->curve_count; task++)
+    {
+        find_extrema(work, task, list);
+    }
+    if (task == last)
+    {
+        return;
+    }
+    // 最初の組を求め、以降は順に進める。
+    int pair_index = task - work->curve_count;
+    int a = 0, b;
+    while (pair_index >= work->curve_count - 1 - a)
+    {
+        pair_index -= work->curve_count - 1 - a;
+        a++;
+    }
+    b = a + 1 + pair_index;
+    for (; task < last; task++)
+    {
+        find_intersections(work, a, b, list);
+        b++;
+        if (b == work->curve_count)
+        {
+            a++;
+            b = a + 1;
+        }
+    }
+}
+
+// 隣り合う点の差の符号が変わる所(描画した折れ線の山と谷)を見つけ、その両隣の点の間で微分係数が0になる点を求める。
+void find_extrema(FeatureWork *work, int curve, FeatureList *list)
+{
+    int count = work->samples->count;
+    double *xs = work->samples->xs;
+    double *ys = work->samples->ys + (long long)curve * count;
+    bool *is_continuous = work->samples->is_continuous + (long long)curve * count;
+    Node *node = work->nodes[curve];
+    int i;
+    for (i = 1; i < count - 1; i++)
+    {
+        if (!is_continuous[i - 1] || !is_continuous[i])
+        {
+            continue;
+        }
+        double left = ys[i] - ys[i - 1];
+        double right = ys[i + 1] - ys[i];
+        bool is_maximum = left > 0 && right < 0;
+        bool is_minimum = left < 0 && right > 0;
+        if (!is_maximum && !is_minimum)
+        {
+            continue;
+        }
+        double x = refine_root(evaluate_slope, node, xs[i - 1], xs[i + 1]);
+        if (isnan(x))
+        {
+            continue;
+        }
+        // 極(微分係数が発散する点)に収束した場合は極値ではない。
+        Dual fx = calclate_dual(x, node);
+        double scale = 1 + fabs(calclate_dual(xs[i - 1], node).derivative) + fabs(calclate_dual(xs[i + 1], node).derivative);
+        if (!(fabs(fx.derivative) <= FEATURE_RESIDUAL_TOLERANCE * scale))
+        {
+            continue;
+        }
+        add_feature(work, list, is_maximum ? feature_maximum : feature_minimum, curve, -1, x, fx.value);
+    }
+}
+
+// 2つの曲線の差の符号が変わる区間(どちらの曲線も連続な区間)を見つけ、その区間で差が0になる点を求める。
+void find_intersections(FeatureWork *work, int a, int b, FeatureList *list)
+{
+    int count = work->samples->count;
+    double *xs = work->samples->xs;
+    double *ys_a = work->samples->ys + (long long)a * count;
+    double *ys_b = work->samples->ys + (long long)b * count;
+    bool *is_continuous_a = work->samples->is_continuous + (long long)a * count;
+    bool *is_continuous_b = work->samples->is_continuous + (long long)b * count;
+    CurvePair pair = {work->nodes[a], work->nodes[b]};
+    int i;
+    for (i = 0; i < count - 1; i++)
+    {
+        if (!is_continuous_a[i] || !is_continuous_b[i])
+        {
+            continue;
+        }
+        double d0 = ys_a[i] - ys_b[i];
+        double d1 = ys_a[i + 1] - ys_b[i + 1];
+        double x;
+        if (d0 == 0)
+        {
+            // 点の上でちょうど交わる場合(重なっている曲線は交点としない)
+            if (d1 == 0 || (i > 0 && ys_a[i - 1] == ys_b[i - 1]))
+            {
+                continue;
+            }
+            x = xs[i];
+        }
+        else if ((d0 < 0 && d1 > 0) || (d0 > 0 && d1 < 0))
+        {
+            x = refine_root(evaluate_difference, &pair, xs[i], xs[i + 1]);
+            if (isnan(x))
+            {
+                continue;
+            }
+        }
+        else
+        {
+            continue;
+        }
+        double y_a = calclate(x, pair.a);
+        double y_b = calclate(x, pair.b);
+        if (!(fabs(y_a - y_b) <= FEATURE_RESIDUAL_TOLERANCE * (1 + fabs(y_a) + fabs(y_b))))
+        {
+            continue;
+        }
+        add_feature(work, list, feature_intersection, a, b, x, (y_a + y_b) / 2);
+    }
+}
+
+void add_feature(FeatureWork *work, FeatureList *list, FeatureType type, int curve, int other_curve, double x, double y)
+{
+    if (!(work->x_min <= x && x <= work->x_max && work->y_min <= y && y <= work->y_max))
+    {
+        return;
+    }
+    // 足りなくなったら倍の大きさにする。
+    if (list->count == list->capacity)
+    {
+        int capacity = list->capacity == 0 ? 16 : list->capacity * 2;
+        CurveFeature *features = (CurveFeature *)realloc(list->features, sizeof(CurveFeature) * capacity);
+        if (features == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        list->features = features;
+        list->capacity = capacity;
+    }
+    CurveFeature *feature = list->features + list->count;
+    feature->type = type;
+    feature->curve = curve;
+    feature->other_curve = other_curve;
+    feature->x = x;
+    feature->y = y;
+    list->count++;
+}
+
+// 区間の幅が丸め誤差の大きさになるまで狭める。
+double refine_root(RootFunction function, void *userdata, double x0, double x1)
+{
+    RootOptions options = get_default_root_options(root_brent);
+    options.tolerance = 0;
+    options.x1 = x1;
+    RootResult result = find_root(function, userdata, x0, &options);
+    return result.is_converged ? result.root : NAN;
+}
+
+// refine_root()でブレント法(微分係数を使わない)にだけ渡すので、orderは常に0で、値だけを求める。
+void evaluate_difference(double x, int order, double *values, void *userdata)
+{
+    (void)order;
+    CurvePair *pair = (CurvePair *)userdata;
+    values[0] = calclate(x, pair->a) - calclate(x, pair->b);
+}
+
+// evaluate_difference()と同じく、ブレント法用に値(曲線の微分係数)だけを求める。
+void evaluate_slope(double x, int order, double *values, void *userdata)
+{
+    (void)order;
+    values[0] = calclate_dual(x, (Node *)userdata).derivative;
+}
+
+int compare_feature(const void *a, const void *b)
+{
+    const CurveFeature *p = (const CurveFeature *)a;
+    const CurveFeature *q = (const CurveFeature *)b;
+    if (p->x != q->x)
+    {
+        return p->x < q->x ? -1 : 1;
+    }
+    if (p->curve != q->curve)
+    {
+        return p->curve < q->curve ? -1 : 1;
+    }
+    if (p->other_curve != q->other_curve)
+    {
+        return p->other_curve < q->other_curve ? -1 : 1;
+    }
+    return p->type - q->type;
+}
\ No newline at end of file
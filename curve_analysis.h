@@ -0,0 +1,34 @@
+#ifndef CURVE_ANALYSIS
+#define CURVE_ANALYSIS
+#include "parser.h"
+#include "fast_math.h"
+
+// 曲線上の特徴的な点の種類
+typedef enum feature_type
+{
+    feature_intersection, // 2つの曲線の交点
+    feature_minimum,      // 極小
+    feature_maximum,      // 極大
+} FeatureType;
+
+// 曲線上の特徴的な点
+typedef struct curve_feature
+{
+    FeatureType type;
+    // 曲線の番号(交点の場合はcurve < other_curve。極値の場合はother_curveは-1)
+    int curve;
+    int other_curve;
+    // 座標(グラフの座標系)
+    double x;
+    double y;
+} CurveFeature;
+
+// count個の式のグラフについて、画像に写る範囲の交点と極値を求め、x座標の順に並べて*featuresに入れる。(使い終わったらfreeする)
+// 描画と同じ点の集合から符号の変わる区間を見つけ、その区間で解を求め直す。
+// 極値と曲線の組をまとまりに分け、thread_count個のスレッドで並列に処理する。(0以下の場合はCPUの数)
+// 見つかった点の数を返す。
+int find_curve_features(Node **nodes, int count, Accuracy accuracy, CurveFeature **features, int thread_count);
+// 点の種類の名前を返す。
+const char *get_feature_type_name(FeatureType type);
+
+#endif
\ No newline at end of file
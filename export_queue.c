@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "graph_writer.h"
+#include "export_queue.h"
+
+// 書き出し待ちの画像1枚分
+typedef struct export_frame
+{
+    // 書き出す画像(書き出し後は次のフレームで使い回す)
+    GraphImage *graph_image;
+    // 出力ファイル名のコピー(書き出し後に開放する)
+    char *file_name;
+} ExportFrame;
+
+// 環状の待ち行列
+struct export_queue
+{
+    ExportFrame *frames;
+    int capacity;
+    // 次に書き出すフレームの位置
+    int head;
+    // 書き出し待ちのフレーム数
+    int count;
+    // trueになったら、書き出し待ちがなくなった時点でスレッドを終了する。
+    bool is_closing;
+    pthread_mutex_t mutex;
+    // フレームが追加されたことを書き出し用のスレッドに知らせる
+    pthread_cond_t not_empty;
+    // フレームが空いたことを描画側に知らせる
+    pthread_cond_t not_full;
+    pthread_t thread;
+};
+
+// 書き出し用のスレッドで実行する関数
+void *export_worker(void *arg);
+
+ExportQueue *init_export_queue(int capacity)
+{
+    if (capacity < 1)
+    {
+        capacity = 1;
+    }
+    ExportQueue *queue = (ExportQueue *)calloc(1, sizeof(ExportQueue));
+    // 画像は最初に使う時に生成する。
+    ExportFrame *frames = (ExportFrame *)calloc(capacity, sizeof(ExportFrame));
+    if (queue == NULL || frames == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    queue->frames = frames;
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    queue->is_closing = false;
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    pthread_create(&queue->thread, NULL, export_worker, queue);
+    return queue;
+}
+
+void enqueue_export(ExportQueue *queue, GraphImage *graph_image, char *file_name)
+{
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == queue->capacity)
+    {
+        pthread_cond_wait(&queue->not_full, &queue->mutex);
+    }
+    ExportFrame *frame = queue->frames + (queue->head + queue->count) % queue->capacity;
+    pthread_mutex_unlock(&queue->mutex);
+
+    // 空いているフレームには書き出し用のスレッドが触らないので、ロックせずにコピーする。
+    if (frame->graph_image == NULL)
+    {
+        frame->graph_image = init_graph_image();
+    }
+    copy_graph_image(frame->graph_image, graph_image);
+    // ファイル名は長さによらず切り詰めずにコピーする。
+    frame->file_name = (char *)malloc(strlen(file_name) + 1);
+    if (frame->file_name == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    strcpy(frame->file_name, file_name);
+
+    pthread_mutex_lock(&queue->mutex);
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+void *export_worker(void *arg)
+{
+    ExportQueue *queue = (ExportQueue *)arg;
+    while (true)
+    {
+        pthread_mutex_lock(&queue->mutex);
+        while (queue->count == 0 && !queue->is_closing)
+        {
+            pthread_cond_wait(&queue->not_empty, &queue->mutex);
+        }
+        if (queue->count == 0)
+        {
+            // 書き出し待ちがなく、終了を指示されている
+            pthread_mutex_unlock(&queue->mutex);
+            return NULL;
+        }
+        ExportFrame *frame = queue->frames + queue->head;
+        pthread_mutex_unlock(&queue->mutex);
+
+        // 書き出している間も描画側は次のフレームを描画できる。
+        export_to_bmp(frame->graph_image, frame->file_name);
+        free(frame->file_name);
+        frame->file_name = NULL;
+
+        pthread_mutex_lock(&queue->mutex);
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        pthread_cond_signal(&queue->not_full);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+}
+
+void dispose_export_queue(ExportQueue *queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    queue->is_closing = true;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+    pthread_join(queue->thread, NULL);
+
+    int i;
+    for (i = 0; i < queue->capacity; i++)
+    {
+        if (queue->frames[i].graph_image != NULL)
+        {
+            dispose_image(queue->frames[i].graph_image);
+        }
+    }
+    free(queue->frames);
+    pthread_mutex_destroy(&queue->mutex);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    free(queue);
+}
\ No newline at end of file
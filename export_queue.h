@@ -0,0 +1,16 @@
+#ifndef EXPORT_QUEUE
+#define EXPORT_QUEUE
+#include "graph_writer.h"
+
+// 画像の書き出しを別スレッドで行うための待ち行列
+// 追加した画像はコピーされるので、追加した直後から元の画像に描画を続けられる。
+typedef struct export_queue ExportQueue;
+
+// 同時に保持できる画像の数を指定して待ち行列を生成し、書き出し用のスレッドを起動する。
+ExportQueue *init_export_queue(int capacity);
+// 画像のコピーを書き出し待ちに追加する。空きがない場合は、書き出しが終わって空きができるまで待つ。
+void enqueue_export(ExportQueue *queue, GraphImage *graph_image, char *file_name);
+// 書き出し待ちの画像をすべて書き出してから、スレッドを終了して待ち行列を開放する。
+void dispose_export_queue(ExportQueue *queue);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,238 @@
+// 2GBを超えるファイルを扱えるようにする。
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+// 複数の領域を1回のシステムコールで書き込める環境か
+#if defined(__unix__) || defined(__APPLE__)
+#define USE_WRITEV
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+#include "export_target.h"
+
+// 1回のwritev()に渡す領域の最大数(IOV_MAXがない環境では、POSIXで保証されている最小値)
+#ifdef IOV_MAX
+#define MAX_WRITE_VECTORS IOV_MAX
+#else
+#define MAX_WRITE_VECTORS 16
+#endif
+
+typedef enum export_target_type
+{
+    target_file,
+    target_fd,
+    target_memory,
+} ExportTargetType;
+
+struct export_target
+{
+    ExportTargetType type;
+    // ファイルまたはファイル記述子に書き出す場合の書き出し先
+    int fd;
+    FILE *fp;
+    // メモリに書き出す場合の領域
+    unsigned char *buffer;
+    long long capacity;
+    // 書き出したバイト数
+    long long size;
+    // 一度でも書き出しに失敗したらtrue
+    bool has_failed;
+};
+
+// 書き出し先を生成する。
+ExportTarget *create_export_target(ExportTargetType type);
+// ファイル記述子に複数の領域を書き出す。(一部しか書き込まれなかった場合は残りを書き込み直す)
+bool write_fd_vectors(int fd, const ExportVector *vectors, int count);
+// 複数の領域をつなげてメモリに書き出す。
+bool write_memory_vectors(ExportTarget *target, const ExportVector *vectors, int count);
+
+ExportTarget *create_export_target(ExportTargetType type)
+{
+    ExportTarget *target = (ExportTarget *)calloc(1, sizeof(ExportTarget));
+    if (target == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    target->type = type;
+    target->fd = -1;
+    return target;
+}
+
+ExportTarget *open_file_target(const char *path)
+{
+#ifdef USE_WRITEV
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    ExportTarget *target = create_export_target(target_file);
+    target->fd = fd;
+#else
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL)
+    {
+        return NULL;
+    }
+    ExportTarget *target = create_export_target(target_file);
+    target->fp = fp;
+#endif
+    return target;
+}
+
+ExportTarget *init_fd_target(int fd)
+{
+#ifdef USE_WRITEV
+    ExportTarget *target = create_export_target(target_fd);
+    target->fd = fd;
+    return target;
+#else
+    return NULL;
+#endif
+}
+
+ExportTarget *init_memory_target(unsigned char *buffer, long long capacity)
+{
+    ExportTarget *target = create_export_target(target_memory);
+    target->buffer = buffer;
+    target->capacity = capacity;
+    return target;
+}
+
+bool write_export_vectors(ExportTarget *target, const ExportVector *vectors, int count)
+{
+    if (target->has_failed)
+    {
+        return false;
+    }
+    bool is_written;
+    if (target->type == target_memory)
+    {
+        is_written = write_memory_vectors(target, vectors, count);
+    }
+    else if (target->fp != NULL)
+    {
+        // writev()のない環境では、標準入出力のバッファにまとめて書き込む。
+        is_written = true;
+        int i;
+        for (i = 0; i < count && is_written; i++)
+        {
+            is_written = fwrite(vectors[i].data, 1, vectors[i].size, target->fp) == vectors[i].size;
+        }
+    }
+    else
+    {
+        is_written = write_fd_vectors(target->fd, vectors, count);
+    }
+    if (!is_written)
+    {
+        target->has_failed = true;
+        return false;
+    }
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        target->size += vectors[i].size;
+    }
+    return true;
+}
+
+// パイプなどでは一部しか書き込まれないことがあるので、書き込まれた分だけ領域を進めて繰り返す。
+bool write_fd_vectors(int fd, const ExportVector *vectors, int count)
+{
+#ifdef USE_WRITEV
+    struct iovec iov[MAX_WRITE_VECTORS];
+    int next = 0;
+    // 次に書き出す領域のうち、書き込み済みのバイト数
+    size_t offset = 0;
+    while (next < count)
+    {
+        int iov_count = 0;
+        int i;
+        for (i = next; i < count && iov_count < MAX_WRITE_VECTORS; i++)
+        {
+            size_t skip = i == next ? offset : 0;
+            if (vectors[i].size > skip)
+            {
+                iov[iov_count].iov_base = (char *)vectors[i].data + skip;
+                iov[iov_count].iov_len = vectors[i].size - skip;
+                iov_count++;
+            }
+        }
+        if (iov_count == 0)
+        {
+            return true;
+        }
+        ssize_t written = writev(fd, iov, iov_count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        // 書き込まれたバイト数だけ、領域を進める。
+        size_t remaining = written;
+        while (next < count && remaining >= vectors[next].size - offset)
+        {
+            remaining -= vectors[next].size - offset;
+            offset = 0;
+            next++;
+        }
+        offset += remaining;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool write_memory_vectors(ExportTarget *target, const ExportVector *vectors, int count)
+{
+    long long size = 0;
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        size += vectors[i].size;
+    }
+    if (target->size + size > target->capacity)
+    {
+        return false;
+    }
+    unsigned char *destination = target->buffer + target->size;
+    for (i = 0; i < count; i++)
+    {
+        memcpy(destination, vectors[i].data, vectors[i].size);
+        destination += vectors[i].size;
+    }
+    return true;
+}
+
+long long get_export_target_size(ExportTarget *target)
+{
+    return target->size;
+}
+
+bool close_export_target(ExportTarget *target)
+{
+    bool is_succeeded = !target->has_failed;
+    if (target->fp != NULL && fclose(target->fp) != 0)
+    {
+        is_succeeded = false;
+    }
+#ifdef USE_WRITEV
+    if (target->type == target_file && close(target->fd) != 0)
+    {
+        is_succeeded = false;
+    }
+#endif
+    free(target);
+    return is_succeeded;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef EXPORT_TARGET
+#define EXPORT_TARGET
+#include <stdbool.h>
+#include <stddef.h>
+
+// 書き出す領域1つ分
+// 複数の領域をまとめて渡すと、1つにつなげるコピーをせずに、なるべく少ない回数の書き込みで書き出す。
+typedef struct export_vector
+{
+    const void *data;
+    size_t size;
+} ExportVector;
+
+// 画像の書き出し先(ファイル、開いているファイル記述子、呼び出し元のメモリ)
+typedef struct export_target ExportTarget;
+
+// ファイルを作成して書き出し先にする。(開けなければNULL)
+ExportTarget *open_file_target(const char *path);
+// 開いているファイル記述子(標準出力やパイプなど)を書き出し先にする。(閉じるのは呼び出し元。使えない環境ではNULL)
+ExportTarget *init_fd_target(int fd);
+// 呼び出し元のcapacityバイトの領域を書き出し先にする。(入りきらない書き出しは失敗する)
+ExportTarget *init_memory_target(unsigned char *buffer, long long capacity);
+// 複数の領域を順に書き出す。失敗したらfalseを返し、以降の書き出しもすべて失敗する。
+bool write_export_vectors(ExportTarget *target, const ExportVector *vectors, int count);
+// これまでに書き出したバイト数を返す。
+long long get_export_target_size(ExportTarget *target);
+// 書き出し先を開放する。(ファイルを作成した場合は閉じる) 閉じるまでのすべての書き出しが成功していればtrueを返す。
+bool close_export_target(ExportTarget *target);
+
+#endif
\ No newline at end of file
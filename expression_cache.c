@@ -0,0 +1,614 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+// キャッシュファイルをメモリにマップできる環境か
+#if defined(__unix__) || defined(__APPLE__)
+#define USE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include "lexer.h"
+#include "parser.h"
+#include "program.h"
+#include "export_target.h"
+#include "expression_cache.h"
+
+// キャッシュファイルの種類を表す先頭の4バイト
+#define CACHE_MAGIC "GEXC"
+// キャッシュファイルの拡張子
+#define CACHE_EXTENSION ".gexc"
+
+// キャッシュファイルは、ヘッダ、命令の列、構文木のノード(前順)、トークン、式の文字列、トークンの文字列の順に並べる。
+// 命令は8バイト境界に置かれるので、マップした領域の上でそのまま読める。
+typedef struct cache_header
+{
+    char magic[4];
+    // 版と、書き込んだ環境での命令の大きさ[バイト](違う場合は使わない)
+    int version;
+    int instruction_size;
+    // 式の文字数(ハッシュ値の衝突を見分けるため、式の文字列も保存する)
+    int expression_length;
+    // 命令の数と、式の値が入る命令の番号
+    int instruction_count;
+    int result;
+    // ノードとトークンの数、トークンの文字列の合計の長さ
+    int node_count;
+    int token_count;
+    int string_size;
+    int reserved;
+    // ヘッダより後ろのデータのハッシュ値(壊れたファイルを使わないように確かめる)
+    unsigned long long checksum;
+} CacheHeader;
+
+// 構文木のノード1つ分
+// 前順に並べるので、ノードの直後に左の子の部分木、その後に右の子の部分木が続く。
+typedef struct cached_node
+{
+    // 最初のトークンの番号と、つながっているトークンの数
+    int first_token;
+    int token_count;
+    // 左の子があれば1、右の子があれば2を足したもの
+    int children;
+} CachedNode;
+
+// トークン1つ分
+typedef struct cached_token
+{
+    int type;
+    // トークンの文字列の位置と長さ
+    int data_offset;
+    int data_length;
+} CachedToken;
+
+struct expression_cache
+{
+    char *directory;
+    // 読み込んだ数と書き込んだ数(複数のスレッドから数えるので、mutexで守る)
+    int load_count;
+    int store_count;
+    pthread_mutex_t mutex;
+};
+
+// 式のキャッシュファイルのパスを返す。(使い終わったらfreeする)
+char *get_cache_path(ExpressionCache *cache, const char *expression);
+// 版と式の文字列のハッシュ値(64ビットのFNV-1a)を求める。
+unsigned long long hash_cache_key(const char *expression);
+// データのハッシュ値をhashに続けて求める。(64ビットのFNV-1a)
+unsigned long long hash_cache_data(unsigned long long hash, const void *data, long long size);
+// キャッシュファイルの内容が正しいかを確かめる。
+bool validate_cache(const unsigned char *data, long long size, const char *expression);
+// index番目の命令の引数が、命令の種類に合っているかを確かめる。
+bool validate_instruction(const Instruction *instruction, int index);
+// キャッシュファイルの内容から構文木とプログラムを作る。(validate_cache()で確かめた後に使う)
+void restore_cache(const unsigned char *data, Node **node, Program **program);
+// 前順に並んだノードから構文木を作る。
+Node *restore_tree(const CachedNode *nodes, int node_count, const CachedToken *tokens, const char *strings);
+// 構文木のノードとトークンを前順に並べる。
+void flatten_tree(Node *node, CachedNode **nodes, int *node_count, CachedToken **tokens, int *token_count, char **strings, int *string_size);
+// 読み込んだ数か書き込んだ数を1つ増やす。
+void count_cache_access(ExpressionCache *cache, bool is_store);
+
+ExpressionCache *open_expression_cache(const char *directory)
+{
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST)
+    {
+        return NULL;
+    }
+    ExpressionCache *cache = (ExpressionCache *)calloc(1, sizeof(ExpressionCache));
+    char *copy = (char *)malloc(strlen(directory) + 1);
+    if (cache == NULL || copy == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    strcpy(copy, directory);
+    cache->directory = copy;
+    pthread_mutex_init(&cache->mutex, NULL);
+    return cache;
+}
+
+void close_expression_cache(ExpressionCache *cache)
+{
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache->directory);
+    free(cache);
+}
+
+char *get_cache_path(ExpressionCache *cache, const char *expression)
+{
+    char *path = (char *)malloc(strlen(cache->directory) + 32);
+    if (path == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    sprintf(path, "%s/%016llx%s", cache->directory, hash_cache_key(expression), CACHE_EXTENSION);
+    return path;
+}
+
+unsigned long long hash_cache_data(unsigned long long hash, const void *data, long long size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    long long i;
+    for (i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+unsigned long long hash_cache_key(const char *expression)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    int version = EXPRESSION_CACHE_VERSION;
+    unsigned int i;
+    for (i = 0; i < sizeof(version); i++)
+    {
+        hash = (hash ^ ((version >> (8 * i)) & 0xff)) * 1099511628211ull;
+    }
+    const char *current;
+    for (current = expression; *current != '\0'; current++)
+    {
+        hash = (hash ^ (unsigned char)*current) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// ファイルをメモリにマップし、確かめてから構文木とプログラムを作る。(マップできない環境では全体を読み込む)
+bool load_cached_expression(ExpressionCache *cache, const char *expression, Node **node, Program **program)
+{
+    char *path = get_cache_path(cache, expression);
+    bool is_loaded = false;
+#ifdef USE_MMAP
+    int fd = open(path, O_RDONLY);
+    free(path);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size < (long long)sizeof(CacheHeader))
+    {
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // マップした後はファイルディスクリプタが不要になる。
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+    if (validate_cache((const unsigned char *)map, status.st_size, expression))
+    {
+        restore_cache((const unsigned char *)map, node, program);
+        is_loaded = true;
+    }
+    munmap(map, status.st_size);
+#else
+    FILE *fp = fopen(path, "rb");
+    free(path);
+    if (fp == NULL)
+    {
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    unsigned char *data = (unsigned char *)malloc(size > 0 ? size : 1);
+    if (data == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    if (size >= (long)sizeof(CacheHeader) && fread(data, 1, size, fp) == (size_t)size && validate_cache(data, size, expression))
+    {
+        restore_cache(data, node, program);
+        is_loaded = true;
+    }
+    free(data);
+    fclose(fp);
+#endif
+    if (is_loaded)
+    {
+        count_cache_access(cache, false);
+    }
+    return is_loaded;
+}
+
+// 壊れたファイルや別の式のファイルで異常な構文木やプログラムを作らないように、すべての番号と長さが範囲内で、
+// 命令の引数が命令の種類に合っているかを確かめる。
+bool validate_cache(const unsigned char *data, long long size, const char *expression)
+{
+    const CacheHeader *header = (const CacheHeader *)data;
+    if (memcmp(header->magic, CACHE_MAGIC, 4) != 0 || header->version != EXPRESSION_CACHE_VERSION ||
+        header->instruction_size != (int)sizeof(Instruction) || header->expression_length != (int)strlen(expression) ||
+        header->instruction_count < 1 || header->node_count < 0 || header->token_count < 0 || header->string_size < 0)
+    {
+        return false;
+    }
+    long long expected_size = sizeof(CacheHeader) + (long long)sizeof(Instruction) * header->instruction_count +
+                              (long long)sizeof(CachedNode) * header->node_count + (long long)sizeof(CachedToken) * header->token_count +
+                              header->expression_length + header->string_size;
+    if (size != expected_size ||
+        hash_cache_data(14695981039346656037ull, data + sizeof(CacheHeader), size - sizeof(CacheHeader)) != header->checksum)
+    {
+        return false;
+    }
+    const Instruction *instructions = (const Instruction *)(data + sizeof(CacheHeader));
+    const CachedNode *nodes = (const CachedNode *)(instructions + header->instruction_count);
+    const CachedToken *tokens = (const CachedToken *)(nodes + header->node_count);
+    const char *stored_expression = (const char *)(tokens + header->token_count);
+    if (memcmp(stored_expression, expression, header->expression_length) != 0 ||
+        header->result < 0 || header->result >= header->instruction_count)
+    {
+        return false;
+    }
+    int i;
+    for (i = 0; i < header->instruction_count; i++)
+    {
+        if (!validate_instruction(instructions + i, i))
+        {
+            return false;
+        }
+    }
+    for (i = 0; i < header->token_count; i++)
+    {
+        const CachedToken *token = tokens + i;
+        if (token->type < num || token->type > variable || token->data_offset < 0 || token->data_length < 0 ||
+            (long long)token->data_offset + token->data_length > header->string_size)
+        {
+            return false;
+        }
+    }
+    // 前順のノードの列が1つの木になっているか(まだ埋まっていない子の数が、最後のノードで初めて0になるか)
+    int pending = header->node_count > 0 ? 1 : 0;
+    for (i = 0; i < header->node_count; i++)
+    {
+        const CachedNode *node = nodes + i;
+        if (pending == 0 || node->token_count < 1 || node->first_token < 0 || node->children < 0 || node->children > 3 ||
+            (long long)node->first_token + node->token_count > header->token_count)
+        {
+            return false;
+        }
+        pending += (node->children & 1) + (node->children >> 1) - 1;
+    }
+    return pending == 0;
+}
+
+// 命令は、それより前の命令の結果だけを使う。引数を使わない側は-1でなければならない。
+// (単項演算子と関数は右の引数だけを使い、左の引数は-1か、左辺の0の定数の命令)
+bool validate_instruction(const Instruction *instruction, int index)
+{
+    int left = instruction->left, right = instruction->right;
+    if (left < -1 || left >= index || right < -1 || right >= index)
+    {
+        return false;
+    }
+    switch (instruction->opcode)
+    {
+    case op_const:
+    case op_x:
+    case op_param:
+        return left == -1 && right == -1;
+    case op_neg:
+    case op_sin:
+    case op_cos:
+    case op_tan:
+    case op_log:
+    case op_exp:
+        return right >= 0;
+    case op_add:
+    case op_sub:
+    case op_mul:
+    case op_div:
+    case op_pow:
+        return left >= 0 && right >= 0;
+    case op_powi:
+        // 指数は1以上の整数(powi_kernel()は1以上を前提とする)
+        return left >= 0 && right == -1 && instruction->value >= 1 && instruction->value <= MAX_POWI_EXPONENT &&
+               instruction->value == floor(instruction->value);
+    }
+    return false;
+}
+
+void restore_cache(const unsigned char *data, Node **node, Program **program)
+{
+    const CacheHeader *header = (const CacheHeader *)data;
+    const Instruction *instructions = (const Instruction *)(data + sizeof(CacheHeader));
+    const CachedNode *nodes = (const CachedNode *)(instructions + header->instruction_count);
+    const CachedToken *tokens = (const CachedToken *)(nodes + header->node_count);
+    const char *strings = (const char *)(tokens + header->token_count) + header->expression_length;
+
+    Program *restored = (Program *)calloc(1, sizeof(Program));
+    Instruction *copy = (Instruction *)malloc(sizeof(Instruction) * header->instruction_count);
+    if (restored == NULL || copy == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    memcpy(copy, instructions, sizeof(Instruction) * header->instruction_count);
+    restored->instructions = copy;
+    restored->instruction_count = header->instruction_count;
+    restored->instruction_capacity = header->instruction_count;
+    restored->result = header->result;
+    restored->results = NULL;
+    restored->result_count = 0;
+    restored->lookup = NULL;
+    restored->lookup_capacity = 0;
+    restored->accuracy = accuracy_full;
+    restored->parameter_name = NULL;
+    restored->parameter = 0;
+    *program = restored;
+    *node = restore_tree(nodes, header->node_count, tokens, strings);
+}
+
+// 子を待っているノードをスタックに積み、次のノードをスタックの一番上のノードの子にする。
+// (再帰呼び出しを使わないので、長い式の深い構文木でもスタックが溢れない)
+Node *restore_tree(const CachedNode *nodes, int node_count, const CachedToken *tokens, const char *strings)
+{
+    if (node_count == 0)
+    {
+        return NULL;
+    }
+    Node **stack = (Node **)malloc(sizeof(Node *) * node_count);
+    // スタックの各ノードが待っている子(左の子なら1、右の子なら2を足したもの)
+    int *pending_children = (int *)malloc(sizeof(int) * node_count);
+    if (stack == NULL || pending_children == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int stack_count = 0;
+    Node *root = NULL;
+    int i, j;
+    for (i = 0; i < node_count; i++)
+    {
+        const CachedNode *cached = nodes + i;
+        Node *node = (Node *)calloc(1, sizeof(Node));
+        if (node == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        // つながっているトークンを作る。
+        Token *previous = NULL;
+        for (j = 0; j < cached->token_count; j++)
+        {
+            const CachedToken *cached_token = tokens + cached->first_token + j;
+            Token *token = (Token *)calloc(1, sizeof(Token));
+            char *data = (char *)malloc(cached_token->data_length + 1);
+            if (token == NULL || data == NULL)
+            {
+                perror("メモリ確保エラー");
+                exit(-1);
+            }
+            memcpy(data, strings + cached_token->data_offset, cached_token->data_length);
+            data[cached_token->data_length] = '\0';
+            token->data = data;
+            token->type = (TokenType)cached_token->type;
+            token->prev = previous;
+            token->next = NULL;
+            if (previous == NULL)
+            {
+                node->token = token;
+            }
+            else
+            {
+                previous->next = token;
+            }
+            previous = token;
+        }
+
+        if (stack_count == 0)
+        {
+            root = node;
+        }
+        else
+        {
+            int *pending = pending_children + stack_count - 1;
+            if (*pending & 1)
+            {
+                stack[stack_count - 1]->left = node;
+                *pending &= ~1;
+            }
+            else
+            {
+                stack[stack_count - 1]->right = node;
+                *pending &= ~2;
+            }
+            // 子がすべて埋まったノードはスタックから取り除く。
+            if (*pending == 0)
+            {
+                stack_count--;
+            }
+        }
+        if (cached->children != 0)
+        {
+            stack[stack_count] = node;
+            pending_children[stack_count] = cached->children;
+            stack_count++;
+        }
+    }
+    free(stack);
+    free(pending_children);
+    return root;
+}
+
+
+// 一時ファイルに書き込んでから名前を変えるので、読み込む側が書き込み途中のファイルを読むことはない。
+// 同じ式は1つのプロセスの中では同時に書き込まないので、一時ファイルの名前はプロセスごとに区別すればよい。
+void store_cached_expression(ExpressionCache *cache, const char *expression, Node *node, Program *program)
+{
+    CachedNode *nodes = NULL;
+    CachedToken *tokens = NULL;
+    char *strings = NULL;
+    int node_count = 0, token_count = 0, string_size = 0;
+    flatten_tree(node, &nodes, &node_count, &tokens, &token_count, &strings, &string_size);
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = EXPRESSION_CACHE_VERSION;
+    header.instruction_size = sizeof(Instruction);
+    header.expression_length = strlen(expression);
+    header.instruction_count = program->instruction_count;
+    header.result = program->result;
+    header.node_count = node_count;
+    header.token_count = token_count;
+    header.string_size = string_size;
+    // 書き込む順にハッシュ値を求める。
+    unsigned long long checksum = 14695981039346656037ull;
+    checksum = hash_cache_data(checksum, program->instructions, sizeof(Instruction) * program->instruction_count);
+    checksum = hash_cache_data(checksum, nodes, sizeof(CachedNode) * node_count);
+    checksum = hash_cache_data(checksum, tokens, sizeof(CachedToken) * token_count);
+    checksum = hash_cache_data(checksum, expression, header.expression_length);
+    checksum = hash_cache_data(checksum, strings, string_size);
+    header.checksum = checksum;
+
+    char *path = get_cache_path(cache, expression);
+    char *temporary_path = (char *)malloc(strlen(path) + 32);
+    if (temporary_path == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+#ifdef USE_MMAP
+    sprintf(temporary_path, "%s.%ld.tmp", path, (long)getpid());
+#else
+    sprintf(temporary_path, "%s.tmp", path);
+#endif
+    ExportTarget *target = open_file_target(temporary_path);
+    if (target != NULL)
+    {
+        ExportVector vectors[] = {
+            {&header, sizeof(header)},
+            {program->instructions, sizeof(Instruction) * program->instruction_count},
+            {nodes, sizeof(CachedNode) * node_count},
+            {tokens, sizeof(CachedToken) * token_count},
+            {expression, header.expression_length},
+            {strings, string_size},
+        };
+        write_export_vectors(target, vectors, sizeof(vectors) / sizeof(vectors[0]));
+        // 書き込みに失敗したファイルは残さない。
+        if (close_export_target(target) && rename(temporary_path, path) == 0)
+        {
+            count_cache_access(cache, true);
+        }
+        else
+        {
+            remove(temporary_path);
+        }
+    }
+    free(temporary_path);
+    free(path);
+    free(nodes);
+    free(tokens);
+    free(strings);
+}
+
+// 右の子、左の子の順にスタックに積むと、取り出す順が前順になる。
+void flatten_tree(Node *node, CachedNode **nodes, int *node_count, CachedToken **tokens, int *token_count, char **strings, int *string_size)
+{
+    int node_capacity = 0, token_capacity = 0, string_capacity = 0;
+    int stack_capacity = 16;
+    int stack_count = 0;
+    Node **stack = (Node **)malloc(sizeof(Node *) * stack_capacity);
+    if (stack == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    if (node != NULL)
+    {
+        stack[stack_count++] = node;
+    }
+    while (stack_count > 0)
+    {
+        Node *current = stack[--stack_count];
+        // 足りなくなったら倍の大きさにする。
+        if (*node_count == node_capacity)
+        {
+            node_capacity = node_capacity == 0 ? 64 : node_capacity * 2;
+            *nodes = (CachedNode *)realloc(*nodes, sizeof(CachedNode) * node_capacity);
+        }
+        if (stack_count + 2 > stack_capacity)
+        {
+            stack_capacity *= 2;
+            stack = (Node **)realloc(stack, sizeof(Node *) * stack_capacity);
+        }
+        if (*nodes == NULL || stack == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        CachedNode *cached = *nodes + (*node_count)++;
+        cached->first_token = *token_count;
+        cached->token_count = 0;
+        cached->children = (current->left != NULL ? 1 : 0) + (current->right != NULL ? 2 : 0);
+        Token *token;
+        for (token = current->token; token != NULL; token = token->next)
+        {
+            int length = strlen(token->data);
+            if (*token_count == token_capacity)
+            {
+                token_capacity = token_capacity == 0 ? 64 : token_capacity * 2;
+                *tokens = (CachedToken *)realloc(*tokens, sizeof(CachedToken) * token_capacity);
+            }
+            while (*string_size + length > string_capacity)
+            {
+                string_capacity = string_capacity == 0 ? 256 : string_capacity * 2;
+                *strings = (char *)realloc(*strings, string_capacity);
+            }
+            if (*tokens == NULL || *strings == NULL)
+            {
+                perror("メモリ確保エラー");
+                exit(-1);
+            }
+            CachedToken *cached_token = *tokens + (*token_count)++;
+            cached_token->type = token->type;
+            cached_token->data_offset = *string_size;
+            cached_token->data_length = length;
+            memcpy(*strings + *string_size, token->data, length);
+            *string_size += length;
+            cached->token_count++;
+        }
+        if (current->right != NULL)
+        {
+            stack[stack_count++] = current->right;
+        }
+        if (current->left != NULL)
+        {
+            stack[stack_count++] = current->left;
+        }
+    }
+    free(stack);
+}
+
+void count_cache_access(ExpressionCache *cache, bool is_store)
+{
+    pthread_mutex_lock(&cache->mutex);
+    if (is_store)
+    {
+        cache->store_count++;
+    }
+    else
+    {
+        cache->load_count++;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+void get_expression_cache_counts(ExpressionCache *cache, int *load_count, int *store_count)
+{
+    pthread_mutex_lock(&cache->mutex);
+    *load_count = cache->load_count;
+    *store_count = cache->store_count;
+    pthread_mutex_unlock(&cache->mutex);
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef EXPRESSION_CACHE
+#define EXPRESSION_CACHE
+#include <stdbool.h>
+#include "parser.h"
+#include "program.h"
+
+// キャッシュの形式と、式の変換方法の版(構文解析やコンパイルの結果が変わる変更をしたら上げる。版が違うキャッシュは使わない)
+#define EXPRESSION_CACHE_VERSION 1
+
+// 式の構文木とコンパイルしたプログラムを、ディレクトリ内のファイルに保存するキャッシュ
+// ファイル名は式の文字列と版のハッシュ値で、次回以降の起動ではメモリにマップして読み込み、字句解析・構文解析・コンパイルを省く。
+// 複数のスレッド・プロセスから同時に使える。(書き込みは一時ファイルに書いてから名前を変える)
+typedef struct expression_cache ExpressionCache;
+
+// ディレクトリ(なければ作る)をキャッシュとして開く。(作れなければNULL)
+ExpressionCache *open_expression_cache(const char *directory);
+// キャッシュを閉じる。
+void close_expression_cache(ExpressionCache *cache);
+// 式の構文木とプログラムをキャッシュから読み込む。(キャッシュにないか、壊れていればfalse)
+bool load_cached_expression(ExpressionCache *cache, const char *expression, Node **node, Program **program);
+// 式の構文木とプログラム(compile_program()で変換したもの)をキャッシュに書き込む。
+void store_cached_expression(ExpressionCache *cache, const char *expression, Node *node, Program *program);
+// これまでにキャッシュから読み込んだ式と、書き込んだ式の数を求める。
+void get_expression_cache_counts(ExpressionCache *cache, int *load_count, int *store_count);
+
+#endif
\ No newline at end of file
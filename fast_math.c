@@ -0,0 +1,562 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <stdbool.h>
+#include "fast_math.h"
+
+// 多項式近似の関数は分岐や関数呼び出しを含まないので、ループがSIMD化されやすい。
+// 近似できない範囲の値も一度計算してから(結果は使えない値になる)、後でlibmで計算し直す。
+
+// 多項式近似で計算するsin, cos, tanの引数の絶対値の上限(これより大きい値はπ/2での剰余の誤差が大きくなる)
+#define TRIGONOMETRIC_LIMIT 1.0e5
+// 多項式近似で計算するexpの引数の範囲(結果が正規化数になる範囲)
+#define EXP_MIN -708.0
+#define EXP_MAX 709.0
+// 丸めに使う定数(この値を足して引くと、最も近い整数に丸められる)
+#define ROUNDING_MAGIC 6755399441055744.0
+
+// π/2とln2を上位と下位に分けた値(上位の桁は整数倍しても丸め誤差が出ない)
+#define PI_2_HIGH 1.57079632673412561417e+00
+#define PI_2_LOW 6.07710050650619224932e-11
+#define LN2_HIGH 6.93147180369123816490e-01
+#define LN2_LOW 1.90821492927058770002e-10
+
+// float版の定数
+#define TRIGONOMETRIC_LIMIT_FLOAT 1.0e4f
+#define EXP_MIN_FLOAT -87.0f
+#define EXP_MAX_FLOAT 88.0f
+#define ROUNDING_MAGIC_FLOAT 12582912.0f
+#define PI_2_HIGH_FLOAT 1.5703125f
+#define PI_2_MIDDLE_FLOAT 4.837512969970703125e-4f
+#define PI_2_LOW_FLOAT 7.54978995489188216e-8f
+#define LN2_HIGH_FLOAT 0.693359375f
+#define LN2_LOW_FLOAT -2.12194440e-4f
+
+// doubleのビット列を整数として取り出す。(浮動小数点数と整数の変換命令を使わないようにするため)
+static inline unsigned long long to_bits(double x)
+{
+    unsigned long long bits;
+    memcpy(&bits, &x, sizeof(double));
+    return bits;
+}
+
+static inline double from_bits(unsigned long long bits)
+{
+    double x;
+    memcpy(&x, &bits, sizeof(double));
+    return x;
+}
+
+// xをπ/2で割った商の最も近い整数qと、余りr(|r| <= π/4)を求める。
+// ROUNDING_MAGICを足した値のビット列の下位には、丸めた整数がそのまま入っている。
+static inline double reduce_pi_2(double x, unsigned long long *q)
+{
+    double shifted = x * (2 / M_PI) + ROUNDING_MAGIC;
+    double k = shifted - ROUNDING_MAGIC;
+    *q = to_bits(shifted);
+    return (x - k * PI_2_HIGH) - k * PI_2_LOW;
+}
+
+// |r| <= π/4でのsin(r)の近似
+static inline double sin_polynomial(double r)
+{
+    double r2 = r * r;
+    return r + r * r2 * (-1.0 / 6 + r2 * (1.0 / 120 + r2 * (-1.0 / 5040 + r2 * (1.0 / 362880))));
+}
+
+// |r| <= π/4でのcos(r)の近似
+static inline double cos_polynomial(double r)
+{
+    double r2 = r * r;
+    return 1 + r2 * (-1.0 / 2 + r2 * (1.0 / 24 + r2 * (-1.0 / 720 + r2 * (1.0 / 40320 + r2 * (-1.0 / 3628800)))));
+}
+
+// maskのビットが立っている値(全ビット1)ならa、そうでなければ(0)bを選ぶ。
+static inline double select_bits(unsigned long long mask, double a, double b)
+{
+    return from_bits((to_bits(a) & mask) | (to_bits(b) & ~mask));
+}
+
+static inline double fast_sin(double x)
+{
+    unsigned long long q;
+    double r = reduce_pi_2(x, &q);
+    // 商を4で割った余りで、sinとcosのどちらを使うかと符号が決まる。
+    double value = select_bits(-(q & 1), cos_polynomial(r), sin_polynomial(r));
+    return from_bits(to_bits(value) ^ ((q & 2) << 62));
+}
+
+static inline double fast_cos(double x)
+{
+    unsigned long long q;
+    double r = reduce_pi_2(x, &q);
+    double value = select_bits(-(q & 1), sin_polynomial(r), cos_polynomial(r));
+    return from_bits(to_bits(value) ^ (((q + 1) & 2) << 62));
+}
+
+static inline double fast_tan(double x)
+{
+    unsigned long long q;
+    double r = reduce_pi_2(x, &q);
+    double s = sin_polynomial(r);
+    double c = cos_polynomial(r);
+    // 商が奇数なら tan(r + π/2) = -cos(r) / sin(r)
+    return select_bits(-(q & 1), -c, s) / select_bits(-(q & 1), s, c);
+}
+
+// EXP_MIN <= x <= EXP_MAXでのexp(x)の近似
+static inline double fast_exp(double x)
+{
+    // x = n * ln2 + r (|r| <= ln2 / 2)として、exp(x) = 2^n * exp(r)
+    double shifted = x * M_LOG2E + ROUNDING_MAGIC;
+    double n = shifted - ROUNDING_MAGIC;
+    double r = (x - n * LN2_HIGH) - n * LN2_LOW;
+    double p = 1 + r * (1 + r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120 + r * (1.0 / 720 + r * (1.0 / 5040 + r * (1.0 / 40320))))))));
+    // 2^nは指数部にn + 1023を入れて作る。
+    return p * from_bits((to_bits(shifted) + 1023) << 52);
+}
+
+// 正の正規化数xでのlog(x)の近似
+static inline double fast_log(double x)
+{
+    // x = m * 2^e (√2/2 <= m < √2)として、log(x) = e * ln2 + log(m)
+    unsigned long long bits = to_bits(x);
+    double m = from_bits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+    // 指数部(0〜2047)をROUNDING_MAGICの仮数部に入れて、整数から浮動小数点数への変換命令を使わずにeを求める。
+    double e = from_bits((bits >> 52 & 0x7ff) | 0x4330000000000000ULL) - (4503599627370496.0 + 1023);
+    bool is_large = m > M_SQRT2;
+    m = is_large ? m * 0.5 : m;
+    e = is_large ? e + 1 : e;
+    // log(m) = 2 * artanh(t) (t = (m - 1) / (m + 1))
+    double t = (m - 1) / (m + 1);
+    double t2 = t * t;
+    double log_m = 2 * t * (1 + t2 * (1.0 / 3 + t2 * (1.0 / 5 + t2 * (1.0 / 7 + t2 * (1.0 / 9 + t2 * (1.0 / 11))))));
+    return e * LN2_HIGH + (log_m + e * LN2_LOW);
+}
+
+void sin_kernel(const double *xs, double *ys, int count, Accuracy accuracy)
+{
+    int i;
+    if (accuracy == accuracy_full)
+    {
+        for (i = 0; i < count; i++)
+        {
+            ys[i] = sin(xs[i]);
+        }
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ys[i] = fast_sin(xs[i]);
+    }
+    for (i = 0; i < count; i++)
+    {
+        // 近似できない範囲(NaNを含む)はlibmで計算する。
+        if (!(fabs(xs[i]) <= TRIGONOMETRIC_LIMIT))
+        {
+            ys[i] = sin(xs[i]);
+        }
+    }
+}
+
+void cos_kernel(const double *xs, double *ys, int count, Accuracy accuracy)
+{
+    int i;
+    if (accuracy == accuracy_full)
+    {
+        for (i = 0; i < count; i++)
+        {
+            ys[i] = cos(xs[i]);
+        }
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ys[i] = fast_cos(xs[i]);
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (!(fabs(xs[i]) <= TRIGONOMETRIC_LIMIT))
+        {
+            ys[i] = cos(xs[i]);
+        }
+    }
+}
+
+void tan_kernel(const double *xs, double *ys, int count, Accuracy accuracy)
+{
+    int i;
+    if (accuracy == accuracy_full)
+    {
+        for (i = 0; i < count; i++)
+        {
+            ys[i] = tan(xs[i]);
+        }
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ys[i] = fast_tan(xs[i]);
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (!(fabs(xs[i]) <= TRIGONOMETRIC_LIMIT))
+        {
+            ys[i] = tan(xs[i]);
+        }
+    }
+}
+
+void exp_kernel(const double *xs, double *ys, int count, Accuracy accuracy)
+{
+    int i;
+    if (accuracy == accuracy_full)
+    {
+        for (i = 0; i < count; i++)
+        {
+            ys[i] = exp(xs[i]);
+        }
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ys[i] = fast_exp(xs[i]);
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (!(xs[i] >= EXP_MIN && xs[i] <= EXP_MAX))
+        {
+            ys[i] = exp(xs[i]);
+        }
+    }
+}
+
+void log_kernel(const double *xs, double *ys, int count, Accuracy accuracy)
+{
+    int i;
+    if (accuracy == accuracy_full)
+    {
+        for (i = 0; i < count; i++)
+        {
+            ys[i] = log(xs[i]);
+        }
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ys[i] = fast_log(xs[i]);
+    }
+    for (i = 0; i < count; i++)
+    {
+        // 0以下、非正規化数、無限大、NaN
+        if (!(xs[i] >= DBL_MIN && xs[i] <= DBL_MAX))
+        {
+            ys[i] = log(xs[i]);
+        }
+    }
+}
+
+void pow_kernel(const double *bases, const double *exponents, double *ys, int count, Accuracy accuracy)
+{
+    int i;
+    if (accuracy == accuracy_full)
+    {
+        for (i = 0; i < count; i++)
+        {
+            ys[i] = pow(bases[i], exponents[i]);
+        }
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ys[i] = fast_exp(exponents[i] * fast_log(bases[i]));
+    }
+    for (i = 0; i < count; i++)
+    {
+        // 底が正の場合は a^b = exp(b * log(a))。負の底や0などと、結果が正規化数にならない場合はlibmで計算する。
+        double a = bases[i];
+        double y = exponents[i] * fast_log(a);
+        if (!(a >= DBL_MIN && a <= DBL_MAX && y >= EXP_MIN && y <= EXP_MAX))
+        {
+            ys[i] = pow(a, exponents[i]);
+        }
+    }
+}
+
+void powi_kernel(const double *xs, double *ys, int exponent, int count)
+{
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        // 2進数の桁ごとに2乗していく。
+        double base = xs[i];
+        double result = 1;
+        int n;
+        for (n = exponent; n > 0; n >>= 1)
+        {
+            if (n & 1)
+            {
+                result *= base;
+            }
+            base *= base;
+        }
+        ys[i] = result;
+    }
+}
+
+// 以下はfloat版。(多項式の次数を下げ、ビット列の操作は32ビットで行う)
+
+static inline unsigned int to_bits_float(float x)
+{
+    unsigned int bits;
+    memcpy(&bits, &x, sizeof(float));
+    return bits;
+}
+
+static inline float from_bits_float(unsigned int bits)
+{
+    float x;
+    memcpy(&x, &bits, sizeof(float));
+    return x;
+}
+
+static inline float select_bits_float(unsigned int mask, float a, float b)
+{
+    return from_bits_float((to_bits_float(a) & mask) | (to_bits_float(b) & ~mask));
+}
+
+// π/2は3つに分けて引く。
+static inline float reduce_pi_2_float(float x, unsigned int *q)
+{
+    float shifted = x * (float)(2 / M_PI) + ROUNDING_MAGIC_FLOAT;
+    float k = shifted - ROUNDING_MAGIC_FLOAT;
+    *q = to_bits_float(shifted);
+    return ((x - k * PI_2_HIGH_FLOAT) - k * PI_2_MIDDLE_FLOAT) - k * PI_2_LOW_FLOAT;
+}
+
+static inline float sin_polynomial_float(float r)
+{
+    float r2 = r * r;
+    return r + r * r2 * (-1.0f / 6 + r2 * (1.0f / 120 + r2 * (-1.0f / 5040 + r2 * (1.0f / 362880))));
+}
+
+static inline float cos_polynomial_float(float r)
+{
+    float r2 = r * r;
+    return 1 + r2 * (-1.0f / 2 + r2 * (1.0f / 24 + r2 * (-1.0f / 720 + r2 * (1.0f / 40320))));
+}
+
+static inline float fast_sin_float(float x)
+{
+    unsigned int q;
+    float r = reduce_pi_2_float(x, &q);
+    float value = select_bits_float(-(q & 1), cos_polynomial_float(r), sin_polynomial_float(r));
+    return from_bits_float(to_bits_float(value) ^ ((q & 2) << 30));
+}
+
+static inline float fast_cos_float(float x)
+{
+    unsigned int q;
+    float r = reduce_pi_2_float(x, &q);
+    float value = select_bits_float(-(q & 1), sin_polynomial_float(r), cos_polynomial_float(r));
+    return from_bits_float(to_bits_float(value) ^ (((q + 1) & 2) << 30));
+}
+
+static inline float fast_tan_float(float x)
+{
+    unsigned int q;
+    float r = reduce_pi_2_float(x, &q);
+    float s = sin_polynomial_float(r);
+    float c = cos_polynomial_float(r);
+    return select_bits_float(-(q & 1), -c, s) / select_bits_float(-(q & 1), s, c);
+}
+
+static inline float fast_exp_float(float x)
+{
+    float shifted = x * (float)M_LOG2E + ROUNDING_MAGIC_FLOAT;
+    float n = shifted - ROUNDING_MAGIC_FLOAT;
+    float r = (x - n * LN2_HIGH_FLOAT) - n * LN2_LOW_FLOAT;
+    float p = 1 + r * (1 + r * (1.0f / 2 + r * (1.0f / 6 + r * (1.0f / 24 + r * (1.0f / 120 + r * (1.0f / 720 + r * (1.0f / 5040)))))));
+    return p * from_bits_float((to_bits_float(shifted) + 127) << 23);
+}
+
+static inline float fast_log_float(float x)
+{
+    unsigned int bits = to_bits_float(x);
+    float m = from_bits_float((bits & 0x007fffff) | 0x3f800000);
+    float e = from_bits_float((bits >> 23 & 0xff) | 0x4b000000) - (8388608.0f + 127);
+    bool is_large = m > (float)M_SQRT2;
+    m = is_large ? m * 0.5f : m;
+    e = is_large ? e + 1 : e;
+    float t = (m - 1) / (m + 1);
+    float t2 = t * t;
+    float log_m = 2 * t * (1 + t2 * (1.0f / 3 + t2 * (1.0f / 5 + t2 * (1.0f / 7 + t2 * (1.0f / 9)))));
+    return e * LN2_HIGH_FLOAT + (log_m + e * LN2_LOW_FLOAT);
+}
+
+void sin_kernel_float(const float *xs, float *ys, int count, Accuracy accuracy)
+{
+    int i;
+    if (accuracy == accuracy_full)
+    {
+        for (i = 0; i < count; i++)
+        {
+            ys[i] = sinf(xs[i]);
+        }
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ys[i] = fast_sin_float(xs[i]);
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (!(fabsf(xs[i]) <= TRIGONOMETRIC_LIMIT_FLOAT))
+        {
+            ys[i] = sinf(xs[i]);
+        }
+    }
+}
+
+void cos_kernel_float(const float *xs, float *ys, int count, Accuracy accuracy)
+{
+    int i;
+    if (accuracy == accuracy_full)
+    {
+        for (i = 0; i < count; i++)
+        {
+            ys[i] = cosf(xs[i]);
+        }
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ys[i] = fast_cos_float(xs[i]);
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (!(fabsf(xs[i]) <= TRIGONOMETRIC_LIMIT_FLOAT))
+        {
+            ys[i] = cosf(xs[i]);
+        }
+    }
+}
+
+void tan_kernel_float(const float *xs, float *ys, int count, Accuracy accuracy)
+{
+    int i;
+    if (accuracy == accuracy_full)
+    {
+        for (i = 0; i < count; i++)
+        {
+            ys[i] = tanf(xs[i]);
+        }
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ys[i] = fast_tan_float(xs[i]);
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (!(fabsf(xs[i]) <= TRIGONOMETRIC_LIMIT_FLOAT))
+        {
+            ys[i] = tanf(xs[i]);
+        }
+    }
+}
+
+void exp_kernel_float(const float *xs, float *ys, int count, Accuracy accuracy)
+{
+    int i;
+    if (accuracy == accuracy_full)
+    {
+        for (i = 0; i < count; i++)
+        {
+            ys[i] = expf(xs[i]);
+        }
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ys[i] = fast_exp_float(xs[i]);
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (!(xs[i] >= EXP_MIN_FLOAT && xs[i] <= EXP_MAX_FLOAT))
+        {
+            ys[i] = expf(xs[i]);
+        }
+    }
+}
+
+void log_kernel_float(const float *xs, float *ys, int count, Accuracy accuracy)
+{
+    int i;
+    if (accuracy == accuracy_full)
+    {
+        for (i = 0; i < count; i++)
+        {
+            ys[i] = logf(xs[i]);
+        }
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ys[i] = fast_log_float(xs[i]);
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (!(xs[i] >= FLT_MIN && xs[i] <= FLT_MAX))
+        {
+            ys[i] = logf(xs[i]);
+        }
+    }
+}
+
+void pow_kernel_float(const float *bases, const float *exponents, float *ys, int count, Accuracy accuracy)
+{
+    int i;
+    if (accuracy == accuracy_full)
+    {
+        for (i = 0; i < count; i++)
+        {
+            ys[i] = powf(bases[i], exponents[i]);
+        }
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ys[i] = fast_exp_float(exponents[i] * fast_log_float(bases[i]));
+    }
+    for (i = 0; i < count; i++)
+    {
+        float a = bases[i];
+        float y = exponents[i] * fast_log_float(a);
+        if (!(a >= FLT_MIN && a <= FLT_MAX && y >= EXP_MIN_FLOAT && y <= EXP_MAX_FLOAT))
+        {
+            ys[i] = powf(a, exponents[i]);
+        }
+    }
+}
+
+void powi_kernel_float(const float *xs, float *ys, int exponent, int count)
+{
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        float base = xs[i];
+        float result = 1;
+        int n;
+        for (n = exponent; n > 0; n >>= 1)
+        {
+            if (n & 1)
+            {
+                result *= base;
+            }
+            base *= base;
+        }
+        ys[i] = result;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef FAST_MATH
+#define FAST_MATH
+
+// 超越関数の計算精度
+typedef enum accuracy
+{
+    accuracy_full, // libmと同じ精度
+    accuracy_fast, // 相対誤差1e-7程度の多項式近似(グラフの描画には十分な精度)
+} Accuracy;
+
+// count個の値について一括で計算し、ysに書き込む。(xsとysは別の配列であること)
+void sin_kernel(const double *xs, double *ys, int count, Accuracy accuracy);
+void cos_kernel(const double *xs, double *ys, int count, Accuracy accuracy);
+void tan_kernel(const double *xs, double *ys, int count, Accuracy accuracy);
+void exp_kernel(const double *xs, double *ys, int count, Accuracy accuracy);
+void log_kernel(const double *xs, double *ys, int count, Accuracy accuracy);
+// bases[i]^exponents[i]を一括で計算する。
+void pow_kernel(const double *bases, const double *exponents, double *ys, int count, Accuracy accuracy);
+// xs[i]^exponentを掛け算の繰り返しで一括で計算する。(exponentは1以上)
+void powi_kernel(const double *xs, double *ys, int exponent, int count);
+
+// 上の関数のfloat版。(libmのfloat版の関数、またはfloatの精度に合わせた多項式近似で計算する)
+void sin_kernel_float(const float *xs, float *ys, int count, Accuracy accuracy);
+void cos_kernel_float(const float *xs, float *ys, int count, Accuracy accuracy);
+void tan_kernel_float(const float *xs, float *ys, int count, Accuracy accuracy);
+void exp_kernel_float(const float *xs, float *ys, int count, Accuracy accuracy);
+void log_kernel_float(const float *xs, float *ys, int count, Accuracy accuracy);
+void pow_kernel_float(const float *bases, const float *exponents, float *ys, int count, Accuracy accuracy);
+void powi_kernel_float(const float *xs, float *ys, int exponent, int count);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "lexer.h"
+#include "parser.h"
+#include "program.h"
+#include "jit.h"
+#include "graph_writer.h"
+#include "graph_library.h"
+
+struct graph_context
+{
+    // 描画先の画像(グラフの点の集合を求める作業領域も画像ごとに持つ)
+    GraphImage *image;
+};
+
+struct graph_expression
+{
+    // 区間演算用の構文木
+    Node *node;
+    // 各点の値の計算用の命令列と、それを変換した機械語(変換できない環境ではNULL)
+    Program *program;
+    JitFunction *jit;
+};
+
+GraphContext *create_graph_context()
+{
+    GraphContext *context = (GraphContext *)calloc(1, sizeof(GraphContext));
+    if (context == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    context->image = init_graph_image();
+    return context;
+}
+
+void dispose_graph_context(GraphContext *context)
+{
+    dispose_image(context->image);
+    free(context);
+}
+
+void clear_graph_context(GraphContext *context)
+{
+    fill_white(context->image);
+}
+
+void set_graph_context_accuracy(GraphContext *context, Accuracy accuracy)
+{
+    context->image->accuracy = accuracy;
+}
+
+GraphExpression *compile_graph_expression(const char *expression, Accuracy accuracy)
+{
+    return compile_graph_expression_cached(expression, accuracy, NULL);
+}
+
+// 機械語は実行する環境のアドレスに依存するので保存せず、読み込んだ命令の列から毎回生成する。
+GraphExpression *compile_graph_expression_cached(const char *expression, Accuracy accuracy, ExpressionCache *cache)
+{
+    GraphExpression *compiled = (GraphExpression *)calloc(1, sizeof(GraphExpression));
+    if (compiled == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    if (cache == NULL || !load_cached_expression(cache, expression, &compiled->node, &compiled->program))
+    {
+        compiled->node = parse(lexical(expression));
+        compiled->program = compile_program(compiled->node);
+        if (cache != NULL)
+        {
+            store_cached_expression(cache, expression, compiled->node, compiled->program);
+        }
+    }
+    compiled->program->accuracy = accuracy;
+    compiled->jit = NULL;
+#ifndef NO_JIT
+    compiled->jit = compile_jit(compiled->program);
+#endif
+    return compiled;
+}
+
+void evaluate_graph_expression(GraphExpression *expression, const double *xs, double *ys, int count)
+{
+    if (expression->jit != NULL)
+    {
+        run_jit(expression->jit, xs, ys, count);
+    }
+    else
+    {
+        run_program(expression->program, xs, ys, count);
+    }
+}
+
+void dispose_graph_expression(GraphExpression *expression)
+{
+    if (expression->jit != NULL)
+    {
+        dispose_jit(expression->jit);
+    }
+    dispose_program(expression->program);
+    dispose_tree(expression->node);
+    free(expression);
+}
+
+void render_axis(GraphContext *context)
+{
+    draw_axis(context->image);
+}
+
+void render_graph_expression(GraphContext *context, GraphExpression *expression, Pixel color)
+{
+    draw_graph_compiled(context->image, color, expression->node, expression->program, expression->jit);
+}
+
+void render_graph_family(GraphContext *context, GraphFamily *family, const char *expression)
+{
+    draw_graph_family(context->image, family, expression);
+}
+
+// 複数のコンテキストを別々のスレッドで描画することを想定して、格子の計算はスレッドに分けない。
+void render_graph_implicit(GraphContext *context, Pixel color, const char *expression)
+{
+    draw_graph_implicit(context->image, color, expression, 1);
+}
+
+void render_graph_progressive(GraphContext *context, char **expressions, Pixel *colors, int count,
+                              void (*on_pass)(GraphContext *context, int pass, int pass_count, void *userdata), void *userdata)
+{
+    ProgressiveGraph *progressive_graph = init_progressive_graph(expressions, colors, count, context->image->accuracy);
+    int pass_count = get_progressive_pass_count(progressive_graph);
+    int pass;
+    for (pass = 0; refine_progressive_graph(progressive_graph, context->image); pass++)
+    {
+        if (on_pass != NULL)
+        {
+            on_pass(context, pass, pass_count, userdata);
+        }
+    }
+    dispose_progressive_graph(progressive_graph);
+}
+
+const unsigned char *get_graph_context_pixels(GraphContext *context, int *width, int *height, int *row_size)
+{
+    get_graph_image_layout(width, height, row_size);
+    return context->image->data;
+}
+
+void render_graph_callback(GraphContext *context, Pixel color, double (*f)(double x, void *userdata), void *userdata)
+{
+    draw_graph_func(context->image, color, userdata, f);
+}
+
+void render_graph_linear(GraphContext *context, Pixel color, double slope, double intercept)
+{
+    draw_graph_linear(context->image, color, slope, intercept);
+}
+
+void export_graph_context(GraphContext *context, const char *file_name)
+{
+    export_to_bmp(context->image, file_name);
+}
+
+bool export_graph_context_to_fd(GraphContext *context, int fd)
+{
+    ExportTarget *target = init_fd_target(fd);
+    if (target == NULL)
+    {
+        return false;
+    }
+    export_bmp_to_target(context->image, target);
+    return close_export_target(target);
+}
+
+long long export_graph_context_to_memory(GraphContext *context, unsigned char *buffer, long long capacity)
+{
+    ExportTarget *target = init_memory_target(buffer, capacity);
+    export_bmp_to_target(context->image, target);
+    long long size = get_export_target_size(target);
+    return close_export_target(target) ? size : -1;
+}
+
+long long get_graph_bmp_size()
+{
+    return get_bmp_file_size();
+}
\ No newline at end of file
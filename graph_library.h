@@ -0,0 +1,63 @@
+#ifndef GRAPH_LIBRARY
+#define GRAPH_LIBRARY
+#include "graph_writer.h"
+#include "fast_math.h"
+#include "expression_cache.h"
+
+// ライブラリとして組み込む場合の入口(対話的な入力を使わずに、式のコンパイル・計算・描画・出力を行う)
+// 大域変数を使わないので、異なるコンテキストや式は別々のスレッドから同時に使える。
+// 1つのコンテキストへの描画は、同時に1つのスレッドから行うこと。
+
+// 描画先の画像と描画の設定(中身は公開しない)
+typedef struct graph_context GraphContext;
+// コンパイル済みの式(中身は公開しない)。計算中に内容を書き換えないので、複数のスレッドから同時に計算・描画に使える。
+typedef struct graph_expression GraphExpression;
+
+// 白で塗りつぶした画像を持つコンテキストを生成する。
+GraphContext *create_graph_context();
+// コンテキストを開放する。
+void dispose_graph_context(GraphContext *context);
+// 画像を白で塗りつぶす。(同じコンテキストで次の画像を描画する場合に使う)
+void clear_graph_context(GraphContext *context);
+// render_graph_family()で描画する式の、超越関数の計算精度を設定する。(初期値はaccuracy_full)
+void set_graph_context_accuracy(GraphContext *context, Accuracy accuracy);
+
+// 式をコンパイルする。(超越関数はaccuracyの精度で計算する)
+GraphExpression *compile_graph_expression(const char *expression, Accuracy accuracy);
+// 式をコンパイルする。cacheに保存されていれば構文木と命令の列を読み込み、なければコンパイルした結果を保存する。(cacheはNULLでもよい)
+GraphExpression *compile_graph_expression_cached(const char *expression, Accuracy accuracy, ExpressionCache *cache);
+// count個のxについて式の値を一括で計算し、ysに書き込む。
+void evaluate_graph_expression(GraphExpression *expression, const double *xs, double *ys, int count);
+// コンパイル済みの式を開放する。
+void dispose_graph_expression(GraphExpression *expression);
+
+// 座標軸を描画する。
+void render_axis(GraphContext *context);
+// コンパイル済みの式のグラフを指定色で描画する。
+void render_graph_expression(GraphContext *context, GraphExpression *expression, Pixel color);
+// パラメータを含む式のグラフの族を描画する。
+void render_graph_family(GraphContext *context, GraphFamily *family, const char *expression);
+// 「左辺=右辺」の形の陰関数の曲線を指定色で描画する。(式中のyはxと別の変数として扱う。1つのスレッドで描画する)
+void render_graph_implicit(GraphContext *context, Pixel color, const char *expression);
+// 関数fのグラフを指定色で描画する。(userdataはfにそのまま渡す)
+void render_graph_callback(GraphContext *context, Pixel color, double (*f)(double x, void *userdata), void *userdata);
+// 直線 y = slope * x + intercept を指定色で描画する。(接線など、傾きと切片が分かっている場合はrender_graph_callback()より速い)
+void render_graph_linear(GraphContext *context, Pixel color, double slope, double intercept);
+// 複数の式のグラフを、粗い点の集合から段階ごとに点を増やして描き直す。(画像は段階ごとに白で塗りつぶし、座標軸から描き直す)
+// 各段階を描き終わるたびにon_pass(context, 段階の番号(0から), 段階の数, userdata)を呼ぶので、途中の画像を表示や出力に使える。
+// 最後の段階の画像は、render_axis()と各式のrender_graph_expression()で描画したものと同じになる。(on_passはNULLでもよい)
+void render_graph_progressive(GraphContext *context, char **expressions, Pixel *colors, int count,
+                              void (*on_pass)(GraphContext *context, int pass, int pass_count, void *userdata), void *userdata);
+// 画像データ(BMPと同じ並び。下の行から順に、1画素をB,G,Rの順で格納し、各行は4バイトの倍数まで0で埋める)を返す。
+// 幅と高さ[ピクセル]、1行のサイズ[バイト]をwidth, height, row_sizeに書き込む。(次に描画するまで有効)
+const unsigned char *get_graph_context_pixels(GraphContext *context, int *width, int *height, int *row_size);
+// 画像をBMPとして出力する。(file_nameに拡張子.bmpを付けたファイルに書き込む)
+void export_graph_context(GraphContext *context, const char *file_name);
+// 画像をBMPとして、開いているファイル記述子(標準出力やパイプなど)に出力する。(閉じるのは呼び出し元。書き出しに失敗したらfalse)
+bool export_graph_context_to_fd(GraphContext *context, int fd);
+// 画像をBMPとして、呼び出し元のcapacityバイトの領域に出力し、書き込んだバイト数を返す。(入りきらない場合は-1)
+long long export_graph_context_to_memory(GraphContext *context, unsigned char *buffer, long long capacity);
+// BMPとして出力した場合の大きさ[バイト]を返す。(export_graph_context_to_memory()に渡す領域の大きさ)
+long long get_graph_bmp_size();
+
+#endif
\ No newline at end of file
@@ -14,15 +14,29 @@
  * - https://qiita.com/spc_ehara/items/03d179f4901faeadb184
  */
 
+// 2GBを超えるファイルを扱えるようにする。
+#define _FILE_OFFSET_BITS 64
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <stdbool.h>
 #include <string.h>
+#include <float.h>
+// 出力ファイルをメモリにマップできる環境か
+#if defined(__unix__) || defined(__APPLE__)
+#define USE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 #include "parser.h"
 #include "lexer.h"
 #include "graph_writer.h"
 #include "calclator.h"
+#include "program.h"
+#include "jit.h"
+#include "implicit_curve.h"
+#include "export_target.h"
 
 // 画像の幅[ピクセル] 制約: 奇数
 #define WIDTH 1001
@@ -32,6 +46,14 @@
 #define MAGNIFICATION 100
 // サンプリング数
 #define SAMPLING_RATE 1001
+// 区間演算で範囲を分割していく時の、最小の範囲に含まれる線分の数
+#define INTERVAL_BLOCK_SIZE 16
+// floatで計算した時の丸め誤差として許容する大きさ[ピクセル]
+#define FLOAT_PIXEL_TOLERANCE (1.0 / 64)
+// 段階的に描画する時の、最初の段階の点の間隔(2のべき乗。段階ごとに半分にする)
+#define PROGRESSIVE_FIRST_STRIDE 64
+// 交点などの印の円の半径[ピクセル]
+#define MARKER_RADIUS 6
 // グラフ画像の中心X
 #define CENTER_X 0 * MAGNIFICATION
 // グラフ画像の中心Y
@@ -63,6 +85,23 @@ typedef struct point
     bool IsContinue;
 } Point;
 
+// グラフの点の集合
+// x座標は点の番号から求められるので持たず、y座標の配列と、次の点と連続かを表すビット列だけを持つ。
+typedef struct sample_buffer
+{
+    // 点の数
+    int count;
+    // 0番目の点のx座標と、点の間隔
+    double x_min;
+    double step;
+    // 各点のy座標
+    double *ys;
+    // i番目のビットが1なら、i番目の点と次の点は連続
+    unsigned int *continuity;
+    // 確保している点の数
+    int capacity;
+} SampleBuffer;
+
 // 線の太さを表す列挙型
 typedef enum thickness
 {
@@ -70,67 +109,676 @@ typedef enum thickness
     normal, // 普通
 } Thickness;
 
-// 方向を表す列挙型
-typedef enum direction
+// 分割描画で描画する要素(座標軸または1本のグラフ)を表現する構造体
+typedef struct graph_layer
+{
+    // グラフの点の集合(座標軸と直線の場合はNULL)
+    SampleBuffer *samples;
+    // グラフの色
+    Pixel color;
+    // 直線の場合はその傾きと切片(それ以外はline.is_affineがfalse)
+    Affine line;
+    // 陰関数の曲線の場合はそれを近似する線分(それ以外はNULL)
+    Contour *contour;
+} GraphLayer;
+
+// 分割描画用のグラフ
+struct tiled_graph
+{
+    // 描画する要素の配列(追加した順に描画する)
+    GraphLayer *layers;
+    int layer_count;
+    int layer_capacity;
+    // 1つの帯の行数
+    int strip_height;
+    // 式のグラフの超越関数の計算精度
+    Accuracy accuracy;
+};
+
+// 段階的に描画するグラフ
+struct progressive_graph
+{
+    Node **nodes;
+    Pixel *colors;
+    int count;
+    // 各式が1次式ならその傾きと切片(1次式は点を求めずに毎回直線として描画する)
+    Affine *lines;
+    // 1次式でない式と、それらを1つにまとめたプログラム
+    Node **curves;
+    int curve_count;
+    Program *program;
+    // 点のx座標と、描画用の作業領域
+    SampleBuffer *samples;
+    double *xs;
+    // 求めた点のy座標(グラフの座標系。c番目の曲線のi番目の点はys[c * samples->count + i])
+    double *ys;
+    // i番目の点を計算済みか
+    bool *is_computed;
+    // 次の段階の点の間隔(すべての段階を終えたら0)
+    int stride;
+    int pass;
+};
+
+// 式の値を計算する方法(機械語に変換できればjit、できなければprogramで計算する)
+typedef struct evaluator
 {
-    top,
-    bottom,
-    right,
-    left,
-} Direction;
+    Program *program;
+    JitFunction *jit;
+    // floatで計算してよいか(-DNO_FLOAT_RENDERではfalse。実際に使うかは範囲ごとの途中の値の大きさで決める)
+    bool use_float;
+} Evaluator;
 
 /* アプリケーションのライフサイクルに関する関数郡 */
+// 描画する要素を追加する。
+void add_layer(TiledGraph *tiled_graph, SampleBuffer *samples, Pixel color);
+// 直線を描画する要素として追加する。
+void add_linear_layer(TiledGraph *tiled_graph, Affine line, Pixel color);
+// 各式が1次式かを調べてaffinesに入れ、1次式でない式(点を求めて描画する式)をcurvesに並べて、その数を返す。
+int select_curves(Node **nodes, int count, Affine *affines, Node **curves);
+// 族のグラフがすべて1次式かを調べ、そうであればaffinesに各グラフの傾きと切片を入れてtrueを返す。
+bool is_linear_family(Node *node, GraphFamily *family, Affine *affines);
+
+// 段階的に描画するグラフで、間隔strideの点だけを結んで描画する。
+void draw_coarse_points(GraphImage *graph_image, ProgressiveGraph *progressive_graph, int curve, Pixel color, int stride);
+// 線分のうち、画面の上下(太線の分、余裕を持たせる)の間にある部分だけを描画する。
+void draw_clipped_line(GraphImage *graph_image, Point p1, Point p2, Pixel color);
+
+/* 点の集合関連の関数群 */
+// 空の点の集合を生成する。
+SampleBuffer *init_sample_buffer();
+// 点の集合を開放する。
+void dispose_sample_buffer(SampleBuffer *samples);
+// 画面の両側の外の点を含めてSAMPLING_RATE + 2個の点を保持できるようにし、x座標を設定する。(足りる場合は確保し直さない)
+void reset_sample_buffer(SampleBuffer *samples);
+// i番目の点と次の点が連続かを設定する。
+void set_continuity(SampleBuffer *samples, int i, bool is_continuous);
+// i番目の点を返す。
+Point get_sample_point(SampleBuffer *samples, int i);
+// graph_imageの作業領域の点の集合を返す。
+SampleBuffer *get_image_samples(GraphImage *graph_image);
 
 /* 画像データ生成関連の関数郡 */
 // 点を描画する。
-void plot(Pixel *graph_image, Point, Pixel, Thickness);
+void plot(GraphImage *graph_image, Point, Pixel, Thickness);
 // 2点間を結ぶ直線を指定したピクセルで描画する。
-void draw_line(Pixel *graph_image, Point, Point, Pixel pixel, Thickness);
+void draw_line(GraphImage *graph_image, Point, Point, Pixel pixel, Thickness);
 // 座標軸を描画する。
-void draw_axis(Pixel *graph_image);
-// 与えられた関数を用いて、点の集合をつくり、その先頭アドレスを返す。
-Point *get_points(Node *node, double (*f)(double x, Node *node));
-// 座標に対応する画像データのピクセルのポインタを返す。
-Pixel *get_pixel(Pixel *graph_image, Point);
-// 隣接したピクセルを取得する。
-Pixel *get_adjacent_pixel(Pixel *graph_image, Pixel *base, Direction direction);
+void draw_axis(GraphImage *graph_image);
+// 点の集合を線で結んで描画する。
+void draw_points(GraphImage *graph_image, SampleBuffer *samples, Pixel color);
+// 陰関数の曲線を近似する線分を描画する。
+void draw_contour(GraphImage *graph_image, Contour *contour, Pixel color);
+// 画像の各ピクセルを格子点とする格子で、陰関数の曲線を求める。
+Contour *trace_image_contour(const char *expression, Accuracy accuracy, int thread_count);
+// 与えられた関数を用いて、点の集合をsamplesに求める。
+void get_points(SampleBuffer *samples, void *userdata, double (*f)(double x, void *userdata));
+// 与えられた式の構文木を用いて、区間演算で画面外の範囲を飛ばしながら点の集合をsamplesに求める。
+void get_expression_points(SampleBuffer *samples, Node *node, Accuracy accuracy);
+// get_expression_points()と同じ点の集合を、コンパイル済みのプログラムで求める。(jitはNULLでもよい)
+void get_compiled_points(SampleBuffer *samples, Node *node, Program *program, JitFunction *jit);
+// 点の集合のうちfirst番目からlast番目までを求める。
+void sample_range(Node *node, Evaluator *evaluator, SampleBuffer *samples, int first, int last);
+// count個(INTERVAL_BLOCK_SIZE + 1個以下)のxについて式の値をまとめて計算する。(max_absは範囲内の途中の値の絶対値の上限)
+void evaluate_points(Evaluator *evaluator, const double *xs, double *ys, int count, double max_abs);
+// 途中の値の絶対値がmax_abs以下の計算をfloatで行った時の丸め誤差が、FLOAT_PIXEL_TOLERANCE以下かを調べる。
+bool is_float_precise_enough(double max_abs);
+// 族のmember番目のグラフのパラメータの値を返す。
+double get_family_parameter(GraphFamily *family, int member);
+// 族のmember番目のグラフの色を返す。
+Pixel get_family_color(GraphFamily *family, int member);
+// 族のすべてのグラフについて、samplesと同じx座標の点の値を一括で計算する。(member番目のグラフのi番目の点はys[member * samples->count + i])
+double *evaluate_family(Node *node, GraphFamily *family, Accuracy accuracy, SampleBuffer *samples);
+// 複数の式について、samplesと同じx座標の点の値を1つのプログラムで一括で計算する。(r番目の式のi番目の点はys[r * samples->count + i])
+double *evaluate_expressions(Node **nodes, int count, Accuracy accuracy, SampleBuffer *samples);
+// 式の配列を構文木の配列に変換する。
+Node **parse_expressions(char **expressions, int count);
+// 構文木の配列を開放する。
+void dispose_trees(Node **nodes, int count);
+// samplesと同じx座標の点の値(拡大率をかける前)をまとめて計算したysから、点の集合をsamplesに求める。(parameter_nameは、パラメータがなければNULL)
+void get_evaluated_points(SampleBuffer *samples, Node *node, const char *parameter_name, double parameter, const double *ys);
+// first番目からlast番目までの点の連続性を、区間演算で判定する。(各点の値は計算済み)
+void set_range_continuity(Node *node, const char *parameter_name, double parameter, SampleBuffer *samples, int first, int last);
+// samplesと同じx座標の点の、拡大率をかける前のxを求める。
+double *get_sample_xs(SampleBuffer *samples);
+// 座標に対応するピクセルの位置を求める。画像外の場合はfalseを返す。
+bool get_index(Point, int *x_index, int *y_index);
+// 画像データが保持している範囲のy座標を求める。
+void get_y_range(GraphImage *graph_image, int *y_min, int *y_max);
+// 指定した位置のピクセルの先頭アドレスを返す。保持していない位置の場合はNULLを返す。
+unsigned char *get_pixel(GraphImage *graph_image, int x_index, int y_index);
+// 指定した位置のピクセルに色を付ける。保持していない位置の場合は何もしない。
+void set_pixel(GraphImage *graph_image, int x_index, int y_index, Pixel color);
 
 /* BMP画像関連の関数群 */
-// BMP画像のファイルヘッダをファイルに書き込む。
-void write_bmp_file_header(FILE *);
-// BMP画像の情報ヘッダをファイルに書き込む。
-void write_bmp_info_header(FILE *);
-// BMP画像の画像データをファイルに書き込む。
-void write_bmp_graph_image(FILE *, Pixel *graph_image);
+// 出力ファイル名に拡張子.bmpを付けたパスを返す。(使い終わったらfreeする)
+char *get_bmp_path(const char *file_name);
+// BMP画像のファイルヘッダと情報ヘッダをメモリに書き込む。
+void write_bmp_header(unsigned char *);
+// BMP画像のファイルヘッダをメモリに書き込む。
+void write_bmp_file_header(unsigned char *);
+// BMP画像の情報ヘッダをメモリに書き込む。
+void write_bmp_info_header(unsigned char *);
+// 書き出す領域として、画像データが保持している行を返す。
+ExportVector get_image_vector(GraphImage *graph_image);
+// 画像データの1行のサイズ[バイト]を計算する関数。
+long long calc_row_size();
 // 画像データのサイズ[バイト]を計算する関数。
-int calc_image_size();
+long long calc_image_size();
 // ファイルのサイズを計算する関数。
-int calc_file_size();
+long long calc_file_size();
+// ヘッダのサイズ欄(32ビット)に書き込む値を求める関数。
+unsigned int to_header_size(long long size);
 
-// 与えられた二次元配列をすべて0で埋めます。
-Pixel *init_graph_image()
+// 画像全体を保持する画像データを生成して、白で塗りつぶす。
+GraphImage *init_graph_image()
 {
+    GraphImage *graph_image = (GraphImage *)calloc(1, sizeof(GraphImage));
     // ヒープ領域上に画像データを生成する。(auto変数はスタック領域に生成されるため)
-    Pixel *graph_image = (Pixel *)calloc(HEIGHT * WIDTH, sizeof(Pixel));
+    graph_image->data = (unsigned char *)calloc(calc_image_size(), 1);
+    if (graph_image->data == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    graph_image->first_row = 0;
+    graph_image->row_count = HEIGHT;
+    graph_image->accuracy = accuracy_full;
 
     // 背景を白くする
-    int i;
-    Pixel *current = graph_image;
-    for (i = 0; i < WIDTH * HEIGHT; i++)
+    fill_white(graph_image);
+    return graph_image;
+}
+
+// 出力ファイルを最終的な大きさで作成してメモリにマップし、マップした画像データの領域をそのまま描画先にする。
+// ファイルの内容がそのまま画像データなので、出力時にヘッダを書き込むだけでよい。
+GraphImage *init_mapped_graph_image(const char *file_name)
+{
+#ifdef USE_MMAP
+    char *path = get_bmp_path(file_name);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    free(path);
+    if (fd < 0)
+    {
+        perror("ファイルを開けませんでした。\n");
+        return NULL;
+    }
+    // 伸ばした部分は0で埋まるので、行末の埋め合わせ部分を書き込む必要はない。
+    long long file_size = calc_file_size();
+    if (ftruncate(fd, file_size) != 0)
+    {
+        perror("ファイルの大きさを変更できませんでした。\n");
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // マップした後はファイルディスクリプタが不要になる。
+    close(fd);
+    if (map == MAP_FAILED)
     {
-        current->R = 255;
-        current->G = 255;
-        current->B = 255;
-        current++;
+        perror("ファイルをメモリにマップできませんでした。\n");
+        return NULL;
     }
+
+    GraphImage *graph_image = (GraphImage *)calloc(1, sizeof(GraphImage));
+    graph_image->map = map;
+    graph_image->map_size = file_size;
+    graph_image->data = (unsigned char *)map + FILE_HEADER_SIZE + INFO_HEADER_SIZE;
+    graph_image->first_row = 0;
+    graph_image->row_count = HEIGHT;
+    graph_image->accuracy = accuracy_full;
+
+    // 背景を白くする
+    fill_white(graph_image);
     return graph_image;
+#else
+    return NULL;
+#endif
 }
 
-void dispose_image(Pixel *graph_image)
+void dispose_image(GraphImage *graph_image)
 {
+    if (graph_image->samples != NULL)
+    {
+        dispose_sample_buffer(graph_image->samples);
+    }
+#ifdef USE_MMAP
+    if (graph_image->map != NULL)
+    {
+        munmap(graph_image->map, graph_image->map_size);
+        free(graph_image);
+        return;
+    }
+#endif
+    free(graph_image->data);
     free(graph_image);
 }
 
+// 同じ行を保持している画像データの内容をコピーする。
+void copy_graph_image(GraphImage *destination, GraphImage *source)
+{
+    memcpy(destination->data, source->data, calc_row_size() * source->row_count);
+}
+
+// 保持している行の画素をすべて白にする。(行末の埋め合わせ部分は0のまま)
+void fill_white(GraphImage *graph_image)
+{
+    int i;
+    long long row_size = calc_row_size();
+    for (i = 0; i < graph_image->row_count; i++)
+    {
+        memset(graph_image->data + i * row_size, 255, WIDTH * (BIT_PER_PIXEL / 8));
+    }
+}
+
+// 帯の行数を指定して分割描画用のグラフを生成する。
+TiledGraph *init_tiled_graph(int strip_height)
+{
+    TiledGraph *tiled_graph = (TiledGraph *)calloc(1, sizeof(TiledGraph));
+    if (tiled_graph == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    // 帯は1行以上、画像の高さ以下にする。
+    if (strip_height < 1)
+    {
+        strip_height = 1;
+    }
+    if (strip_height > HEIGHT)
+    {
+        strip_height = HEIGHT;
+    }
+    tiled_graph->strip_height = strip_height;
+    tiled_graph->accuracy = accuracy_full;
+    tiled_graph->layers = NULL;
+    tiled_graph->layer_count = 0;
+    tiled_graph->layer_capacity = 0;
+    return tiled_graph;
+}
+
+void dispose_tiled_graph(TiledGraph *tiled_graph)
+{
+    int i;
+    for (i = 0; i < tiled_graph->layer_count; i++)
+    {
+        if (tiled_graph->layers[i].samples != NULL)
+        {
+            dispose_sample_buffer(tiled_graph->layers[i].samples);
+        }
+        if (tiled_graph->layers[i].contour != NULL)
+        {
+            dispose_contour(tiled_graph->layers[i].contour);
+        }
+    }
+    free(tiled_graph->layers);
+    free(tiled_graph);
+}
+
+void add_layer(TiledGraph *tiled_graph, SampleBuffer *samples, Pixel color)
+{
+    // 足りなくなったら倍の大きさにする。
+    if (tiled_graph->layer_count == tiled_graph->layer_capacity)
+    {
+        int capacity = tiled_graph->layer_capacity == 0 ? 8 : tiled_graph->layer_capacity * 2;
+        GraphLayer *layers = (GraphLayer *)realloc(tiled_graph->layers, capacity * sizeof(GraphLayer));
+        if (layers == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        tiled_graph->layers = layers;
+        tiled_graph->layer_capacity = capacity;
+    }
+    GraphLayer *layer = tiled_graph->layers + tiled_graph->layer_count;
+    layer->samples = samples;
+    layer->color = color;
+    layer->line.is_affine = false;
+    layer->contour = NULL;
+    tiled_graph->layer_count++;
+}
+
+void add_linear_layer(TiledGraph *tiled_graph, Affine line, Pixel color)
+{
+    add_layer(tiled_graph, NULL, color);
+    tiled_graph->layers[tiled_graph->layer_count - 1].line = line;
+}
+
+void set_tiled_graph_accuracy(TiledGraph *tiled_graph, Accuracy accuracy)
+{
+    tiled_graph->accuracy = accuracy;
+}
+
+void add_axis(TiledGraph *tiled_graph)
+{
+    Pixel color = {0, 0, 0};
+    add_layer(tiled_graph, NULL, color);
+}
+
+// 与えられた式の点の集合だけを先に計算しておく。(帯ごとに計算し直さないため)
+// 1次式は点を求めず、傾きと切片だけを持つ。
+void add_graph_expression(TiledGraph *tiled_graph, Pixel color, const char *expression)
+{
+    Token *token = lexical(expression);
+    Node *node = parse(token);
+    Affine line = calclate_affine(node, NULL, 0);
+    if (line.is_affine)
+    {
+        add_linear_layer(tiled_graph, line, color);
+        dispose_tree(node);
+        return;
+    }
+    SampleBuffer *samples = init_sample_buffer();
+    get_expression_points(samples, node, tiled_graph->accuracy);
+    add_layer(tiled_graph, samples, color);
+    dispose_tree(node);
+}
+
+// 族のグラフごとに点の集合を持つ。
+void add_graph_family(TiledGraph *tiled_graph, GraphFamily *family, const char *expression)
+{
+    Token *token = lexical(expression);
+    Node *node = parse(token);
+    Affine *lines = (Affine *)malloc(sizeof(Affine) * family->count);
+    if (lines == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int i;
+    if (is_linear_family(node, family, lines))
+    {
+        for (i = 0; i < family->count; i++)
+        {
+            add_linear_layer(tiled_graph, lines[i], get_family_color(family, i));
+        }
+        free(lines);
+        dispose_tree(node);
+        return;
+    }
+    free(lines);
+    SampleBuffer *samples = init_sample_buffer();
+    reset_sample_buffer(samples);
+    double *ys = evaluate_family(node, family, tiled_graph->accuracy, samples);
+    int point_count = samples->count;
+    for (i = 0; i < family->count; i++)
+    {
+        if (i > 0)
+        {
+            samples = init_sample_buffer();
+        }
+        get_evaluated_points(samples, node, family->parameter_name, get_family_parameter(family, i), ys + (long long)i * point_count);
+        add_layer(tiled_graph, samples, get_family_color(family, i));
+    }
+    free(ys);
+    dispose_tree(node);
+}
+
+// 式ごとに点の集合(1次式は傾きと切片)を持つ。
+void add_graph_expressions(TiledGraph *tiled_graph, Pixel *colors, char **expressions, int count)
+{
+    Node **nodes = parse_expressions(expressions, count);
+    Affine *lines = (Affine *)malloc(sizeof(Affine) * count);
+    Node **curves = (Node **)malloc(sizeof(Node *) * count);
+    if (lines == NULL || curves == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int curve_count = select_curves(nodes, count, lines, curves);
+    SampleBuffer *samples = init_sample_buffer();
+    reset_sample_buffer(samples);
+    double *ys = curve_count > 0 ? evaluate_expressions(curves, curve_count, tiled_graph->accuracy, samples) : NULL;
+    int point_count = samples->count;
+    int i, curve = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (lines[i].is_affine)
+        {
+            add_linear_layer(tiled_graph, lines[i], colors[i]);
+            continue;
+        }
+        if (curve > 0)
+        {
+            samples = init_sample_buffer();
+        }
+        get_evaluated_points(samples, nodes[i], NULL, 0, ys + (long long)curve * point_count);
+        add_layer(tiled_graph, samples, colors[i]);
+        curve++;
+    }
+    // 点の集合を1つも使わなかった場合
+    if (curve_count == 0)
+    {
+        dispose_sample_buffer(samples);
+    }
+    free(ys);
+    free(lines);
+    free(curves);
+    dispose_trees(nodes, count);
+}
+
+void add_graph_linear(TiledGraph *tiled_graph, Pixel color, double slope, double intercept)
+{
+    Affine line = {slope, intercept, true};
+    add_linear_layer(tiled_graph, line, color);
+}
+
+// 線分の集合だけを先に求めておく。
+void add_graph_implicit(TiledGraph *tiled_graph, Pixel color, const char *expression)
+{
+    add_layer(tiled_graph, NULL, color);
+    tiled_graph->layers[tiled_graph->layer_count - 1].contour = trace_image_contour(expression, tiled_graph->accuracy, 0);
+}
+
+void add_graph_func(TiledGraph *tiled_graph, Pixel color, void *userdata, double (*f)(double x, void *userdata))
+{
+    SampleBuffer *samples = init_sample_buffer();
+    get_points(samples, userdata, f);
+    add_layer(tiled_graph, samples, color);
+}
+
+// 1次式かどうかの判定と、すべての曲線をまとめたプログラムへの変換は最初に1回だけ行う。
+ProgressiveGraph *init_progressive_graph(char **expressions, Pixel *colors, int count, Accuracy accuracy)
+{
+    ProgressiveGraph *progressive_graph = (ProgressiveGraph *)calloc(1, sizeof(ProgressiveGraph));
+    if (progressive_graph == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    progressive_graph->nodes = parse_expressions(expressions, count);
+    progressive_graph->count = count;
+    progressive_graph->colors = (Pixel *)malloc(sizeof(Pixel) * (count + 1));
+    progressive_graph->lines = (Affine *)malloc(sizeof(Affine) * (count + 1));
+    progressive_graph->curves = (Node **)malloc(sizeof(Node *) * (count + 1));
+    if (progressive_graph->colors == NULL || progressive_graph->lines == NULL || progressive_graph->curves == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        progressive_graph->colors[i] = colors[i];
+    }
+    progressive_graph->curve_count = select_curves(progressive_graph->nodes, count, progressive_graph->lines, progressive_graph->curves);
+    progressive_graph->program = compile_programs(progressive_graph->curves, progressive_graph->curve_count);
+    progressive_graph->program->accuracy = accuracy;
+    progressive_graph->samples = init_sample_buffer();
+    reset_sample_buffer(progressive_graph->samples);
+    int point_count = progressive_graph->samples->count;
+    progressive_graph->xs = get_sample_xs(progressive_graph->samples);
+    progressive_graph->ys = (double *)malloc(sizeof(double) * point_count * (progressive_graph->curve_count + 1));
+    progressive_graph->is_computed = (bool *)calloc(point_count, sizeof(bool));
+    if (progressive_graph->ys == NULL || progressive_graph->is_computed == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    progressive_graph->stride = PROGRESSIVE_FIRST_STRIDE;
+    progressive_graph->pass = 0;
+    return progressive_graph;
+}
+
+// 終えた段階の数に、残りの段階(間隔が1になるまで半分にしていく)の数を足す。
+int get_progressive_pass_count(ProgressiveGraph *progressive_graph)
+{
+    int count = progressive_graph->pass, stride;
+    for (stride = progressive_graph->stride; stride >= 1; stride /= 2)
+    {
+        count++;
+    }
+    return count;
+}
+
+// 間隔strideの番号の点(最初の段階では最後の点も)のうち、まだ計算していない点だけをまとめて計算する。
+bool refine_progressive_graph(ProgressiveGraph *progressive_graph, GraphImage *graph_image)
+{
+    int stride = progressive_graph->stride;
+    if (stride == 0)
+    {
+        return false;
+    }
+    SampleBuffer *samples = progressive_graph->samples;
+    int point_count = samples->count;
+    int curve_count = progressive_graph->curve_count;
+    double *xs = (double *)malloc(sizeof(double) * point_count);
+    int *indices = (int *)malloc(sizeof(int) * point_count);
+    if (xs == NULL || indices == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int i, c, n = 0;
+    for (i = 0; i < point_count; i++)
+    {
+        if (!progressive_graph->is_computed[i] && (i % stride == 0 || i == point_count - 1))
+        {
+            indices[n] = i;
+            xs[n] = progressive_graph->xs[i];
+            progressive_graph->is_computed[i] = true;
+            n++;
+        }
+    }
+    if (n > 0 && curve_count > 0)
+    {
+        double *ys = (double *)malloc(sizeof(double) * n * curve_count);
+        if (ys == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        run_program_multi(progressive_graph->program, xs, ys, n);
+        for (c = 0; c < curve_count; c++)
+        {
+            for (i = 0; i < n; i++)
+            {
+                progressive_graph->ys[(long long)c * point_count + indices[i]] = ys[(long long)c * n + i];
+            }
+        }
+        free(ys);
+    }
+    free(xs);
+    free(indices);
+
+    fill_white(graph_image);
+    draw_axis(graph_image);
+    int curve = 0;
+    for (i = 0; i < progressive_graph->count; i++)
+    {
+        Affine *line = progressive_graph->lines + i;
+        Pixel color = progressive_graph->colors[i];
+        if (line->is_affine)
+        {
+            draw_graph_linear(graph_image, color, line->slope, line->intercept);
+            continue;
+        }
+        // 最後の段階は、すべての点を計算してから描画する場合と同じ方法で連続性を判定して描画する。
+        if (stride == 1)
+        {
+            get_evaluated_points(samples, progressive_graph->nodes[i], NULL, 0, progressive_graph->ys + (long long)curve * point_count);
+            draw_points(graph_image, samples, color);
+        }
+        else
+        {
+            draw_coarse_points(graph_image, progressive_graph, curve, color, stride);
+        }
+        curve++;
+    }
+    progressive_graph->stride = stride / 2;
+    progressive_graph->pass++;
+    return true;
+}
+
+// 隣り合う計算済みの点の間で、区間演算で連続と確かめられた場合だけ線で結ぶ。
+void draw_coarse_points(GraphImage *graph_image, ProgressiveGraph *progressive_graph, int curve, Pixel color, int stride)
+{
+    SampleBuffer *samples = progressive_graph->samples;
+    int point_count = samples->count;
+    double *ys = progressive_graph->ys + (long long)curve * point_count;
+    Node *node = progressive_graph->curves[curve];
+    int i, next;
+    for (i = 0; i < point_count - 1; i = next)
+    {
+        next = i + stride < point_count - 1 ? i + stride : point_count - 1;
+        Interval x = {progressive_graph->xs[i], progressive_graph->xs[next], true};
+        if (!calclate_interval(x, node).is_continuous)
+        {
+            continue;
+        }
+        Point p1 = {samples->x_min + samples->step * i, ys[i] * MAGNIFICATION, true};
+        Point p2 = {samples->x_min + samples->step * next, ys[next] * MAGNIFICATION, true};
+        draw_clipped_line(graph_image, p1, p2, color);
+    }
+}
+
+// 画面外の遠い点をそのまま渡すと、draw_line()で座標を整数にする時に範囲を超えるので、画面の上下の少し外で切り取る。
+void draw_clipped_line(GraphImage *graph_image, Point p1, Point p2, Pixel color)
+{
+    if (!isfinite(p1.Y) || !isfinite(p2.Y))
+    {
+        return;
+    }
+    double low = (BOTTOM)-2, high = (TOP) + 2;
+    if ((p1.Y < low && p2.Y < low) || (p1.Y > high && p2.Y > high))
+    {
+        return;
+    }
+    Point a = p1, b = p2;
+    if (p1.Y != p2.Y)
+    {
+        double t_low = (low - p1.Y) / (p2.Y - p1.Y);
+        double t_high = (high - p1.Y) / (p2.Y - p1.Y);
+        double t_min = fmax(0, fmin(t_low, t_high));
+        double t_max = fmin(1, fmax(t_low, t_high));
+        a.X = p1.X + (p2.X - p1.X) * t_min;
+        a.Y = p1.Y + (p2.Y - p1.Y) * t_min;
+        b.X = p1.X + (p2.X - p1.X) * t_max;
+        b.Y = p1.Y + (p2.Y - p1.Y) * t_max;
+    }
+    draw_line(graph_image, a, b, color, bold);
+}
+
+void dispose_progressive_graph(ProgressiveGraph *progressive_graph)
+{
+    dispose_program(progressive_graph->program);
+    dispose_sample_buffer(progressive_graph->samples);
+    dispose_trees(progressive_graph->nodes, progressive_graph->count);
+    free(progressive_graph->colors);
+    free(progressive_graph->lines);
+    free(progressive_graph->curves);
+    free(progressive_graph->xs);
+    free(progressive_graph->ys);
+    free(progressive_graph->is_computed);
+    free(progressive_graph);
+}
+
+void get_graph_image_layout(int *width, int *height, int *row_size)
+{
+    *width = WIDTH;
+    *height = HEIGHT;
+    *row_size = (int)calc_row_size();
+}
+
 /**
  * ==================================================================
  *
@@ -141,7 +789,7 @@ void dispose_image(Pixel *graph_image)
  */
 
 // 座標軸を描画します。
-void draw_axis(Pixel *graph_image)
+void draw_axis(GraphImage *graph_image)
 {
     Pixel pixel = {192, 192, 192};
     Point west = {LEFT, 0};
@@ -183,9 +831,68 @@ void draw_axis(Pixel *graph_image)
     draw_line(graph_image, south, north, pixel, bold);
 }
 
+// 列ごとに色を求めて、保持している行をすべて塗りつぶします。
+void paint_columns(GraphImage *graph_image, Pixel (*color_of)(double x, void *context), void *context)
+{
+    int originXIndex = (WIDTH - 1) / 2 - CENTER_X;
+    int x_index, row;
+    for (x_index = 0; x_index < WIDTH; x_index++)
+    {
+        // グラフの座標系では拡大率で割る必要がある。
+        Pixel color = color_of((x_index - originXIndex) / (double)MAGNIFICATION, context);
+        for (row = graph_image->first_row; row < graph_image->first_row + graph_image->row_count; row++)
+        {
+            set_pixel(graph_image, x_index, row, color);
+        }
+    }
+}
+
+void get_graph_x_range(double *x_min, double *x_max)
+{
+    *x_min = (LEFT) / (double)MAGNIFICATION;
+    *x_max = (RIGHT) / (double)MAGNIFICATION;
+}
+
+void get_graph_y_range(double *y_min, double *y_max)
+{
+    *y_min = (BOTTOM) / (double)MAGNIFICATION;
+    *y_max = (TOP) / (double)MAGNIFICATION;
+}
+
+// 中心からの距離が半径に最も近いピクセルを塗って、円を描く。
+void draw_marker(GraphImage *graph_image, Pixel color, double x, double y)
+{
+    if (!isfinite(x) || !isfinite(y))
+    {
+        return;
+    }
+    Point point;
+    int dx, dy;
+    for (dy = -MARKER_RADIUS - 1; dy <= MARKER_RADIUS + 1; dy++)
+    {
+        for (dx = -MARKER_RADIUS - 1; dx <= MARKER_RADIUS + 1; dx++)
+        {
+            if (fabs(sqrt(dx * dx + dy * dy) - MARKER_RADIUS) < 0.75)
+            {
+                point.X = round(x * MAGNIFICATION) + dx;
+                point.Y = round(y * MAGNIFICATION) + dy;
+                plot(graph_image, point, color, normal);
+            }
+        }
+    }
+}
+
 // 与えられた2点p1, p2間の直線を描画します。
-void draw_line(Pixel *graph_image, Point p1, Point p2, Pixel pixel, Thickness thickness)
+void draw_line(GraphImage *graph_image, Point p1, Point p2, Pixel pixel, Thickness thickness)
 {
+    // 画像データが保持している行と交わらない線分は描画しない。(太線の分、1ピクセル余裕を持たせる)
+    int y_min, y_max;
+    get_y_range(graph_image, &y_min, &y_max);
+    if ((p1.Y > p2.Y ? p1.Y : p2.Y) < y_min - 2 || (p1.Y > p2.Y ? p2.Y : p1.Y) > y_max + 2)
+    {
+        return;
+    }
+
     // 差を求める
     int dx = p2.X - p1.X;
     int dy = p2.Y - p1.Y;
@@ -211,11 +918,12 @@ void draw_line(Pixel *graph_image, Point p1, Point p2, Pixel pixel, Thickness th
     else
     {
         count = dy_abs;
-        // もし、始点のy座標が負の画面外の場合、始点を画面内にする。
-        if (y < BOTTOM)
+        // もし、始点のy座標が画像データの保持している範囲より下の場合、始点を範囲内にする。
+        int lowest = y_min - 1 > BOTTOM ? y_min - 1 : BOTTOM;
+        if (y < lowest)
         {
-            count -= abs(y - BOTTOM);
-            y = BOTTOM;
+            count -= abs(y - lowest);
+            y = lowest;
         }
     }
 
@@ -232,13 +940,18 @@ void draw_line(Pixel *graph_image, Point p1, Point p2, Pixel pixel, Thickness th
             {
                 break;
             }
+            // 画像データが保持している範囲から外れている点は飛ばす
+            if (round(point.Y) < y_min - 1 || round(point.Y) > y_max + 1)
+            {
+                continue;
+            }
         }
         else
         {
             point.Y = y + i;
             point.X = (double)dx / (double)dy * (point.Y - p1.Y) + p1.X;
-            // 線が画面外に達した場合は処理を打ち切る
-            if (point.Y > TOP || point.Y < BOTTOM)
+            // 線が画面外(または画像データが保持している範囲外)に達した場合は処理を打ち切る
+            if (point.Y > TOP || point.Y < BOTTOM || point.Y > y_max + 1)
             {
                 break;
             }
@@ -249,143 +962,732 @@ void draw_line(Pixel *graph_image, Point p1, Point p2, Pixel pixel, Thickness th
 }
 
 // 点を描画します。
-void plot(Pixel *graph_image, Point point, Pixel color, Thickness thickness)
+void plot(GraphImage *graph_image, Point point, Pixel color, Thickness thickness)
 {
-    Pixel *pixel = get_pixel(graph_image, point);
-    // 与えられた座標に対応するピクセルが存在場合はリターンする。
-    if (pixel == NULL)
+    int x_index, y_index;
+    // 与えられた座標に対応するピクセルが画像内に存在しない場合はリターンする。
+    if (!get_index(point, &x_index, &y_index))
     {
         return;
     }
-    *pixel = color;
+    set_pixel(graph_image, x_index, y_index, color);
     if (thickness == bold)
     {
-        *(get_adjacent_pixel(graph_image, pixel, top)) = color;
-        *(get_adjacent_pixel(graph_image, pixel, bottom)) = color;
-        *(get_adjacent_pixel(graph_image, pixel, left)) = color;
-        *(get_adjacent_pixel(graph_image, pixel, right)) = color;
+        set_pixel(graph_image, x_index, y_index - 1, color);
+        set_pixel(graph_image, x_index, y_index + 1, color);
+        set_pixel(graph_image, x_index - 1, y_index, color);
+        set_pixel(graph_image, x_index + 1, y_index, color);
     }
 }
 
 // 与えられた式のグラフを描画する関数。
-void draw_graph_expression(Pixel *graph_image, Pixel color, char *expression)
+void draw_graph_expression(GraphImage *graph_image, Pixel color, const char *expression)
 {
     Token *token = lexical(expression);
     Node *node = parse(token);
-    draw_graph_func(graph_image, color, node, calclate);
+    // 1次式は点を求めずに直線として描画する。
+    Affine line = calclate_affine(node, NULL, 0);
+    if (line.is_affine)
+    {
+        draw_graph_linear(graph_image, color, line.slope, line.intercept);
+        dispose_tree(node);
+        return;
+    }
+    SampleBuffer *samples = get_image_samples(graph_image);
+    get_expression_points(samples, node, graph_image->accuracy);
+    draw_points(graph_image, samples, color);
     dispose_tree(node);
 }
 
-// 数学的な関数を表現する関数を受け取り、グラフを描画する
-void draw_graph_func(Pixel *graph_image, Pixel color, Node *node, double (*f)(double x, Node *node))
+// コンパイル済みの式のグラフを描画する関数。
+void draw_graph_compiled(GraphImage *graph_image, Pixel color, Node *node, Program *program, JitFunction *jit)
 {
-    Point *points = get_points(node, f);
-    // メモリ解放用に、先頭アドレスを記憶する。
-    Point *start = points;
-    int i;
-    // サンプリング数 + 左右両側(画面外)の点の数
-    int count = SAMPLING_RATE + 2;
-    Pixel pointPixel = {255, 255, 0};
+    Affine line = calclate_affine(node, NULL, 0);
+    if (line.is_affine)
+    {
+        draw_graph_linear(graph_image, color, line.slope, line.intercept);
+        return;
+    }
+    SampleBuffer *samples = get_image_samples(graph_image);
+    get_compiled_points(samples, node, program, jit);
+    draw_points(graph_image, samples, color);
+}
+
+// 与えられた複数の式のグラフを描画する関数。
+// 1次式は直線として描画し、それ以外の式だけをまとめて計算する。(描画する順番は式の順番のまま)
+void draw_graph_expressions(GraphImage *graph_image, Pixel *colors, char **expressions, int count)
+{
+    Node **nodes = parse_expressions(expressions, count);
+    Affine *lines = (Affine *)malloc(sizeof(Affine) * count);
+    Node **curves = (Node **)malloc(sizeof(Node *) * count);
+    if (lines == NULL || curves == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int curve_count = select_curves(nodes, count, lines, curves);
+    SampleBuffer *samples = get_image_samples(graph_image);
+    reset_sample_buffer(samples);
+    double *ys = curve_count > 0 ? evaluate_expressions(curves, curve_count, graph_image->accuracy, samples) : NULL;
+    int i, curve = 0;
     for (i = 0; i < count; i++)
     {
-        if (i < count - 1 && points->IsContinue)
+        if (lines[i].is_affine)
         {
-            draw_line(graph_image, *points, *(points + 1), color, bold);
+            draw_graph_linear(graph_image, colors[i], lines[i].slope, lines[i].intercept);
+            continue;
         }
-        points++;
+        get_evaluated_points(samples, nodes[i], NULL, 0, ys + (long long)curve * samples->count);
+        draw_points(graph_image, samples, colors[i]);
+        curve++;
     }
-    // メモリを開放する。
-    free(start);
+    free(ys);
+    free(lines);
+    free(curves);
+    dispose_trees(nodes, count);
 }
 
-// 与えられた関数を用いて値を計算し、サンプリングレート+2個の座標配列を返します。(グラフが左右両側で途切れないようにするために、範囲外の点が２つ必要)
-// nodeは与える関数によっては必須ではない。
-// 注意：ヒープ領域上に配列を生成するので、使用後は必ずfree()でメモリを開放すること。
-Point *get_points(Node *node, double (*f)(double x, Node *node))
+// 与えられた式のグラフの族を描画する関数。
+void draw_graph_family(GraphImage *graph_image, GraphFamily *family, const char *expression)
 {
-
-    Point *points = (Point *)calloc(SAMPLING_RATE + 2, sizeof(Point));
-    // 戻り値は先頭アドレスにしたいので、作業用ポインタ変数を生成している。
-    Point *p = points;
-    // 幅をレートで分割する
-    double rate = WIDTH / (double)SAMPLING_RATE;
-    // 外の点も計算したいので、レートを加算している。
-    double x_max = RIGHT + rate;
-    double x_min = LEFT - rate;
+    Token *token = lexical(expression);
+    Node *node = parse(token);
+    Affine *lines = (Affine *)malloc(sizeof(Affine) * family->count);
+    if (lines == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
     int i;
-    double x;
-    for (i = 0; i < SAMPLING_RATE + 2; i++)
+    // a*x+bなどの直線の族は、点を求めずに描画する。
+    if (is_linear_family(node, family, lines))
     {
-        // x = Xの最小値 + 分割後一つ一つの幅 * i
-        x = (x_min + rate * i);
-        double next_x = x + rate;
-
-        // xには、拡大率^-1を乗ずる必要がある。
-        // y = f(x)をx軸方向、y軸方向にn倍拡大するには、
-        // y = nf(x/n)として計算する必要があるから。
-        double y = f(x / MAGNIFICATION, node);
-        double next_y = f(next_x / MAGNIFICATION, node);
+        for (i = 0; i < family->count; i++)
+        {
+            draw_graph_linear(graph_image, get_family_color(family, i), lines[i].slope, lines[i].intercept);
+        }
+        free(lines);
+        dispose_tree(node);
+        return;
+    }
+    free(lines);
+    SampleBuffer *samples = get_image_samples(graph_image);
+    reset_sample_buffer(samples);
+    double *ys = evaluate_family(node, family, graph_image->accuracy, samples);
+    for (i = 0; i < family->count; i++)
+    {
+        get_evaluated_points(samples, node, family->parameter_name, get_family_parameter(family, i), ys + (long long)i * samples->count);
+        draw_points(graph_image, samples, get_family_color(family, i));
+    }
+    free(ys);
+    dispose_tree(node);
+}
 
-        // 次の点との高さの差が画像の高さより大きかった場合は不連続点として扱う。(暫定処理)
-        bool is_continue = fabs(next_y * MAGNIFICATION - y * MAGNIFICATION) < HEIGHT;
+// 画像に写る部分だけを求めて描画するので、点の集合を求めて線分を結ぶより少ない計算で済む。
+// 傾きの絶対値が1以下なら列ごとに、1より大きければ行ごとに1点ずつ、直線上の点に最も近いピクセルを描画する。
+void draw_graph_linear(GraphImage *graph_image, Pixel color, double slope, double intercept)
+{
+    if (!isfinite(slope) || !isfinite(intercept))
+    {
+        return;
+    }
+    // 拡大率をかけた座標系では y = slope * x + offset になる。(get_points()を参照)
+    double offset = intercept * MAGNIFICATION;
+    // 画面と、画像データが保持している行(太線の分、1ピクセル余裕を持たせる)に写る範囲に切り取る。
+    int y_min, y_max;
+    get_y_range(graph_image, &y_min, &y_max);
+    double low = y_min - 1 > BOTTOM ? y_min - 1 : BOTTOM;
+    double high = y_max + 1 < TOP ? y_max + 1 : TOP;
+    Point point;
+    point.IsContinue = true;
+    if (fabs(slope) <= 1)
+    {
+        double left = LEFT, right = RIGHT;
+        // 丸めで画面に入る点を落とさないように、0.5ピクセル広く取る。
+        if (slope != 0)
+        {
+            double a = (low - 0.5 - offset) / slope, b = (high + 0.5 - offset) / slope;
+            left = fmax(left, fmin(a, b));
+            right = fmin(right, fmax(a, b));
+        }
+        int x;
+        for (x = (int)ceil(left); x <= right; x++)
+        {
+            point.X = x;
+            point.Y = slope * x + offset;
+            plot(graph_image, point, color, bold);
+        }
+        return;
+    }
+    // 画面の外側の点(get_points()の左右両端の点)まで伸ばした線分と交わる行だけを描画する。
+    double a = slope * (LEFT - 1) + offset, b = slope * (RIGHT + 1) + offset;
+    low = fmax(low, fmin(a, b));
+    high = fmin(high, fmax(a, b));
+    int y;
+    for (y = (int)ceil(low); y <= high; y++)
+    {
+        point.Y = y;
+        point.X = (y - offset) / slope;
+        plot(graph_image, point, color, bold);
+    }
+}
+
+void draw_graph_implicit(GraphImage *graph_image, Pixel color, const char *expression, int thread_count)
+{
+    Contour *contour = trace_image_contour(expression, graph_image->accuracy, thread_count);
+    draw_contour(graph_image, contour, color);
+    dispose_contour(contour);
+}
+
+Contour *trace_image_contour(const char *expression, Accuracy accuracy, int thread_count)
+{
+    Node *node = parse_implicit_expression(expression);
+    ContourGrid grid;
+    grid.x_min = (LEFT) / (double)MAGNIFICATION;
+    grid.y_min = (BOTTOM) / (double)MAGNIFICATION;
+    grid.step = 1.0 / MAGNIFICATION;
+    grid.width = WIDTH;
+    grid.height = HEIGHT;
+    Contour *contour = trace_contour(node, &grid, accuracy, thread_count);
+    dispose_tree(node);
+    return contour;
+}
+
+// 線分は1マス(1ピクセル)の中に収まるほど短いので、両端の点も描画する。(隣のマスの線分と端の点を共有するので、曲線はつながる)
+void draw_contour(GraphImage *graph_image, Contour *contour, Pixel color)
+{
+    // 画像データが保持している行と交わらない線分は描画しない。(太線の分、1ピクセル余裕を持たせる)
+    int y_min, y_max;
+    get_y_range(graph_image, &y_min, &y_max);
+    int i;
+    for (i = 0; i < contour->count; i++)
+    {
+        ContourSegment *segment = contour->segments + i;
+        Point p1 = {segment->x1 * MAGNIFICATION, segment->y1 * MAGNIFICATION, true};
+        Point p2 = {segment->x2 * MAGNIFICATION, segment->y2 * MAGNIFICATION, true};
+        if (fmax(p1.Y, p2.Y) < y_min - 2 || fmin(p1.Y, p2.Y) > y_max + 2)
+        {
+            continue;
+        }
+        plot(graph_image, p1, color, bold);
+        plot(graph_image, p2, color, bold);
+        draw_line(graph_image, p1, p2, color, bold);
+    }
+}
+
+// 数学的な関数を表現する関数を受け取り、グラフを描画する
+void draw_graph_func(GraphImage *graph_image, Pixel color, void *userdata, double (*f)(double x, void *userdata))
+{
+    SampleBuffer *samples = get_image_samples(graph_image);
+    get_points(samples, userdata, f);
+    draw_points(graph_image, samples, color);
+}
+
+// get_points()で求めた点の集合を、連続な点同士を線で結んで描画する。
+SampleBuffer *init_sample_buffer()
+{
+    SampleBuffer *samples = (SampleBuffer *)calloc(1, sizeof(SampleBuffer));
+    if (samples == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    return samples;
+}
+
+void dispose_sample_buffer(SampleBuffer *samples)
+{
+    free(samples->ys);
+    free(samples->continuity);
+    free(samples);
+}
+
+void reset_sample_buffer(SampleBuffer *samples)
+{
+    // サンプリング数 + 左右両側(画面外)の点の数
+    int count = SAMPLING_RATE + 2;
+    if (samples->capacity < count)
+    {
+        free(samples->ys);
+        free(samples->continuity);
+        samples->ys = (double *)malloc(sizeof(double) * count);
+        samples->continuity = (unsigned int *)malloc(sizeof(unsigned int) * ((count + 31) / 32));
+        if (samples->ys == NULL || samples->continuity == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        samples->capacity = count;
+    }
+    samples->count = count;
+    // 幅をレートで分割する。外の点も計算したいので、左端から1つ分外側の点から始める。
+    samples->step = WIDTH / (double)SAMPLING_RATE;
+    samples->x_min = LEFT - samples->step;
+    memset(samples->continuity, 0, sizeof(unsigned int) * ((count + 31) / 32));
+}
+
+void set_continuity(SampleBuffer *samples, int i, bool is_continuous)
+{
+    if (is_continuous)
+    {
+        samples->continuity[i / 32] |= 1u << (i % 32);
+    }
+    else
+    {
+        samples->continuity[i / 32] &= ~(1u << (i % 32));
+    }
+}
+
+Point get_sample_point(SampleBuffer *samples, int i)
+{
+    Point point = {samples->x_min + samples->step * i, samples->ys[i], (samples->continuity[i / 32] >> (i % 32) & 1) != 0};
+    return point;
+}
+
+SampleBuffer *get_image_samples(GraphImage *graph_image)
+{
+    if (graph_image->samples == NULL)
+    {
+        graph_image->samples = init_sample_buffer();
+    }
+    return graph_image->samples;
+}
+
+void draw_points(GraphImage *graph_image, SampleBuffer *samples, Pixel color)
+{
+    int i;
+    for (i = 0; i < samples->count - 1; i++)
+    {
+        Point point = get_sample_point(samples, i);
+        if (point.IsContinue)
+        {
+            draw_line(graph_image, point, get_sample_point(samples, i + 1), color, bold);
+        }
+    }
+}
+
+// 与えられた関数を用いて値を計算し、サンプリングレート+2個の点をsamplesに求めます。(グラフが左右両側で途切れないようにするために、範囲外の点が２つ必要)
+// userdataはfにそのまま渡す。(関数によっては必須ではない)
+// samplesの領域は足りていれば使い回すので、グラフごとに確保し直す必要はない。
+void get_points(SampleBuffer *samples, void *userdata, double (*f)(double x, void *userdata))
+{
+    reset_sample_buffer(samples);
+    int i;
+    for (i = 0; i < samples->count; i++)
+    {
+        // xには、拡大率^-1を乗ずる必要がある。
+        // y = f(x)をx軸方向、y軸方向にn倍拡大するには、
+        // y = nf(x/n)として計算する必要があるから。
         // 描画用に拡大して座標を保存する。描画時のx座標は拡大率をかけていない状態である必要がある。(あくまで、yの計算時の話だから)
-        Point point = {x, y * MAGNIFICATION, is_continue};
-        *p = point;
-        p++;
+        double x = samples->x_min + samples->step * i;
+        samples->ys[i] = f(x / MAGNIFICATION, userdata) * MAGNIFICATION;
+    }
+    for (i = 0; i < samples->count - 1; i++)
+    {
+        // 次の点との高さの差が画像の高さより大きかった場合は不連続点として扱う。(暫定処理)
+        set_continuity(samples, i, fabs(samples->ys[i + 1] - samples->ys[i]) < HEIGHT);
     }
-    return points;
+    // 最後の点の次の点はない。
+    set_continuity(samples, samples->count - 1, false);
 }
 
-// 与えられた点を表すピクセルを返します。もし存在していなければNULLを返します。
-Pixel *get_pixel(Pixel *graph_image, Point point)
+// get_points()と同じ点の集合を、区間演算を使って求めます。
+// 画面外にあることが確かめられた範囲は各点の値を計算せず、不連続点は区間内に極などを含むかで判定します。
+void get_expression_points(SampleBuffer *samples, Node *node, Accuracy accuracy)
 {
-    // 指針：原点のインデクスを求めてから、引数pointの各座標を加算(yは-)し、それをもとにアドレスを計算する。
-    int originXIndex = (WIDTH - 1) / 2 - CENTER_X;
-    int originYIndex = (HEIGHT - 1) / 2 + CENTER_Y;
-    int x_index = originXIndex + round(point.X);
-    int y_index = originYIndex - round(point.Y);
-    if (x_index >= WIDTH || y_index >= HEIGHT || x_index < 0 || y_index < 0)
+    // 各点の値は、機械語にコンパイルできればその関数で、できなければ命令列で計算する。(-DNO_JITで機械語は使わない)
+    Program *program = compile_program(node);
+    program->accuracy = accuracy;
+    JitFunction *jit = NULL;
+#ifndef NO_JIT
+    jit = compile_jit(program);
+#endif
+    get_compiled_points(samples, node, program, jit);
+    if (jit != NULL)
     {
-        return NULL;
+        dispose_jit(jit);
     }
+    dispose_program(program);
+}
 
-    return graph_image + x_index + y_index * WIDTH;
+void get_compiled_points(SampleBuffer *samples, Node *node, Program *program, JitFunction *jit)
+{
+    reset_sample_buffer(samples);
+    Evaluator evaluator;
+    evaluator.program = program;
+    evaluator.jit = jit;
+    evaluator.use_float = true;
+#ifdef NO_FLOAT_RENDER
+    evaluator.use_float = false;
+#endif
+    sample_range(node, &evaluator, samples, 0, samples->count - 1);
+    // 最後の点の次の点はない。
+    set_continuity(samples, samples->count - 1, false);
 }
 
-// 隣接したピクセルを取得する。
-Pixel *get_adjacent_pixel(Pixel *graph_image, Pixel *base, Direction direction)
+void evaluate_points(Evaluator *evaluator, const double *xs, double *ys, int count, double max_abs)
 {
-    Pixel *result = base;
-    switch (direction)
+    if (evaluator->use_float && is_float_precise_enough(max_abs))
     {
-    case top:
-        result = base - WIDTH;
-        break;
-    case bottom:
-        result = base + WIDTH;
-        break;
-    case right:
-        result = base + 1;
-        break;
-    case left:
-        result = base - 1;
-        break;
-    default:
-        break;
+        float xs_float[INTERVAL_BLOCK_SIZE + 1];
+        float ys_float[INTERVAL_BLOCK_SIZE + 1];
+        int i;
+        for (i = 0; i < count; i++)
+        {
+            xs_float[i] = (float)xs[i];
+        }
+        if (evaluator->jit != NULL)
+        {
+            run_jit_float(evaluator->jit, xs_float, ys_float, count);
+        }
+        else
+        {
+            run_program_float(evaluator->program, xs_float, ys_float, count);
+        }
+        // 途中でfloatの範囲を超えたり、定義域の端の丸め誤差でNaNになった可能性がある場合はdoubleで計算し直す。
+        bool is_finite = true;
+        for (i = 0; i < count; i++)
+        {
+            ys[i] = ys_float[i];
+            is_finite = is_finite && isfinite(ys_float[i]);
+        }
+        if (is_finite)
+        {
+            return;
+        }
+    }
+    if (evaluator->jit != NULL)
+    {
+        run_jit(evaluator->jit, xs, ys, count);
+    }
+    else
+    {
+        run_program(evaluator->program, xs, ys, count);
     }
+}
+
+bool is_float_precise_enough(double max_abs)
+{
+    // 途中の値の丸め誤差は絶対値のFLT_EPSILON倍程度で、結果には拡大率を乗じて写る。(区間が無限大やNaNならdoubleで計算する)
+    return max_abs * FLT_EPSILON * MAGNIFICATION <= FLOAT_PIXEL_TOLERANCE;
+}
 
-    // baseが端だった場合取得できない場合がある。
-    int diff = base - graph_image;
-    // 左端かつ左を選択した場合baseを返す
-    // 右端かつ右を選択した場合はbaseを返す... という条件でbaseを返す
-    if ((diff % WIDTH == 0 && direction == left) ||
-        diff % (WIDTH - 1) == 0 && direction == right ||
-        diff / WIDTH == 0 && direction == top ||
-        (WIDTH - 1) * HEIGHT <= diff && diff < WIDTH * HEIGHT)
+// first番目からlast番目までの点のxの範囲で式の値の範囲を求め、
+// 範囲全体が画面外なら両端以外の点の計算を省き、不連続点を含む可能性があるか画面に写る場合は半分に分けて調べる。
+void sample_range(Node *node, Evaluator *evaluator, SampleBuffer *samples, int first, int last)
+{
+    int i;
+    double x_min = samples->x_min;
+    double rate = samples->step;
+    // xには拡大率^-1を乗ずる。(get_points()を参照)
+    Interval x = {(x_min + rate * first) / MAGNIFICATION, (x_min + rate * last) / MAGNIFICATION, true};
+    double max_abs;
+    Interval y = calclate_interval_magnitude(x, node, &max_abs);
+    bool is_outside = y.low * MAGNIFICATION > (TOP) + 2 || y.high * MAGNIFICATION < (BOTTOM)-2;
+    if (y.is_continuous && is_outside)
+    {
+        // 両端の点は画面内の点と結ばれることがあるので計算する。間の点は画面外のどこかに置いておく。
+        double outside_y = y.low * MAGNIFICATION > (TOP) + 2 ? y.low * MAGNIFICATION : y.high * MAGNIFICATION;
+        double ends_x[2] = {x.low, x.high};
+        double ends_y[2];
+        evaluate_points(evaluator, ends_x, ends_y, 2, max_abs);
+        for (i = first; i <= last; i++)
+        {
+            samples->ys[i] = outside_y;
+            set_continuity(samples, i, true);
+        }
+        samples->ys[first] = ends_y[0] * MAGNIFICATION;
+        samples->ys[last] = ends_y[1] * MAGNIFICATION;
+        return;
+    }
+    // 範囲全体で定義されていない場合
+    if (isnan(y.low) && isnan(y.high))
+    {
+        for (i = first; i <= last; i++)
+        {
+            samples->ys[i] = NAN;
+            set_continuity(samples, i, false);
+        }
+        return;
+    }
+    // 連続で、それ以上分けても画面外の範囲を見つけにくい場合は、各点をまとめて計算する。
+    // 1つの線分だけの範囲で連続でない場合は、その線分は描画しない。
+    if ((y.is_continuous && last - first <= INTERVAL_BLOCK_SIZE) || last - first == 1)
+    {
+        double xs[INTERVAL_BLOCK_SIZE + 1];
+        for (i = first; i <= last; i++)
+        {
+            xs[i - first] = (x_min + rate * i) / MAGNIFICATION;
+        }
+        evaluate_points(evaluator, xs, samples->ys + first, last - first + 1, max_abs);
+        for (i = first; i <= last; i++)
+        {
+            samples->ys[i] *= MAGNIFICATION;
+            set_continuity(samples, i, y.is_continuous);
+        }
+        return;
+    }
+    // 半分に分けて調べる。(真ん中の点は両方で計算されるが、その連続性は後半の結果で決まる)
+    int middle = (first + last) / 2;
+    sample_range(node, evaluator, samples, first, middle);
+    sample_range(node, evaluator, samples, middle, last);
+}
+
+int select_curves(Node **nodes, int count, Affine *affines, Node **curves)
+{
+    int curve_count = 0;
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        affines[i] = calclate_affine(nodes[i], NULL, 0);
+        if (!affines[i].is_affine)
+        {
+            curves[curve_count++] = nodes[i];
+        }
+    }
+    return curve_count;
+}
+
+// x^aのように、パラメータの値によって1次式かが変わる式もあるので、グラフごとに調べる。
+bool is_linear_family(Node *node, GraphFamily *family, Affine *affines)
+{
+    int i;
+    for (i = 0; i < family->count; i++)
+    {
+        affines[i] = calclate_affine(node, family->parameter_name, get_family_parameter(family, i));
+        if (!affines[i].is_affine)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+double get_family_parameter(GraphFamily *family, int member)
+{
+    if (family->count <= 1)
     {
-        return base;
+        return family->start;
     }
-    return result;
+    return family->start + (family->end - family->start) * member / (family->count - 1);
+}
+
+Pixel get_family_color(GraphFamily *family, int member)
+{
+    double t = family->count <= 1 ? 0 : member / (double)(family->count - 1);
+    Pixel color;
+    color.R = (unsigned char)lround(family->start_color.R + (family->end_color.R - family->start_color.R) * t);
+    color.G = (unsigned char)lround(family->start_color.G + (family->end_color.G - family->start_color.G) * t);
+    color.B = (unsigned char)lround(family->start_color.B + (family->end_color.B - family->start_color.B) * t);
+    return color;
+}
+
+// 式は1つのプログラムにコンパイルし、パラメータ×xの格子点を1回で計算する。
+// xだけで決まる部分式(sin(x)など)は、族のすべてのグラフで共通に計算される。
+double *evaluate_family(Node *node, GraphFamily *family, Accuracy accuracy, SampleBuffer *samples)
+{
+    double *xs = get_sample_xs(samples);
+    double *parameters = (double *)malloc(sizeof(double) * family->count);
+    double *ys = (double *)malloc(sizeof(double) * samples->count * family->count);
+    if (parameters == NULL || ys == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int i;
+    for (i = 0; i < family->count; i++)
+    {
+        parameters[i] = get_family_parameter(family, i);
+    }
+    Program *program = compile_program_with_parameter(node, family->parameter_name);
+    program->accuracy = accuracy;
+    run_program_family(program, parameters, family->count, xs, ys, samples->count);
+    dispose_program(program);
+    free(parameters);
+    free(xs);
+    return ys;
+}
+
+// すべての式を1つのプログラムにまとめるので、式の間で共通の部分式(sin(x)など)は1回だけ計算される。
+double *evaluate_expressions(Node **nodes, int count, Accuracy accuracy, SampleBuffer *samples)
+{
+    double *xs = get_sample_xs(samples);
+    double *ys = (double *)malloc(sizeof(double) * samples->count * (count + 1));
+    if (ys == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    Program *program = compile_programs(nodes, count);
+    program->accuracy = accuracy;
+    run_program_multi(program, xs, ys, samples->count);
+    dispose_program(program);
+    free(xs);
+    return ys;
+}
+
+Node **parse_expressions(char **expressions, int count)
+{
+    Node **nodes = (Node **)malloc(sizeof(Node *) * (count + 1));
+    if (nodes == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        nodes[i] = parse(lexical(expressions[i]));
+    }
+    return nodes;
+}
+
+void dispose_trees(Node **nodes, int count)
+{
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        dispose_tree(nodes[i]);
+    }
+    free(nodes);
+}
+
+// 描画と同じ点の集合を式ごとに求め、y座標と連続性を取り出す。
+GraphSamples *sample_graph_expressions(Node **nodes, int count, Accuracy accuracy)
+{
+    GraphSamples *graph_samples = (GraphSamples *)malloc(sizeof(GraphSamples));
+    SampleBuffer *samples = init_sample_buffer();
+    reset_sample_buffer(samples);
+    if (graph_samples == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int point_count = samples->count;
+    graph_samples->count = point_count;
+    graph_samples->xs = get_sample_xs(samples);
+    graph_samples->ys = count > 0 ? evaluate_expressions(nodes, count, accuracy, samples) : NULL;
+    graph_samples->is_continuous = (bool *)malloc(sizeof(bool) * point_count * (count + 1));
+    if (graph_samples->is_continuous == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int r, i;
+    for (r = 0; r < count; r++)
+    {
+        get_evaluated_points(samples, nodes[r], NULL, 0, graph_samples->ys + (long long)r * point_count);
+        for (i = 0; i < point_count; i++)
+        {
+            graph_samples->is_continuous[(long long)r * point_count + i] = get_sample_point(samples, i).IsContinue;
+        }
+    }
+    dispose_sample_buffer(samples);
+    return graph_samples;
+}
+
+void dispose_graph_samples(GraphSamples *graph_samples)
+{
+    free(graph_samples->xs);
+    free(graph_samples->ys);
+    free(graph_samples->is_continuous);
+    free(graph_samples);
+}
+
+double *get_sample_xs(SampleBuffer *samples)
+{
+    double *xs = (double *)malloc(sizeof(double) * samples->count);
+    if (xs == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int i;
+    for (i = 0; i < samples->count; i++)
+    {
+        // xには拡大率^-1を乗ずる。(get_points()を参照)
+        xs[i] = (samples->x_min + samples->step * i) / MAGNIFICATION;
+    }
+    return xs;
+}
+
+void get_evaluated_points(SampleBuffer *samples, Node *node, const char *parameter_name, double parameter, const double *ys)
+{
+    reset_sample_buffer(samples);
+    int i;
+    for (i = 0; i < samples->count; i++)
+    {
+        samples->ys[i] = ys[i] * MAGNIFICATION;
+    }
+    set_range_continuity(node, parameter_name, parameter, samples, 0, samples->count - 1);
+    // 最後の点の次の点はない。
+    set_continuity(samples, samples->count - 1, false);
+}
+
+// sample_range()と同じ基準で判定する。
+void set_range_continuity(Node *node, const char *parameter_name, double parameter, SampleBuffer *samples, int first, int last)
+{
+    int i;
+    Interval x = {(samples->x_min + samples->step * first) / MAGNIFICATION, (samples->x_min + samples->step * last) / MAGNIFICATION, true};
+    Interval y = calclate_interval_with_parameter(x, node, parameter_name, parameter);
+    bool is_outside = y.low * MAGNIFICATION > (TOP) + 2 || y.high * MAGNIFICATION < (BOTTOM)-2;
+    bool is_undefined = isnan(y.low) && isnan(y.high);
+    if ((y.is_continuous && (is_outside || last - first <= INTERVAL_BLOCK_SIZE)) || is_undefined || last - first == 1)
+    {
+        for (i = first; i <= last; i++)
+        {
+            set_continuity(samples, i, y.is_continuous && !is_undefined);
+        }
+        return;
+    }
+    int middle = (first + last) / 2;
+    set_range_continuity(node, parameter_name, parameter, samples, first, middle);
+    set_range_continuity(node, parameter_name, parameter, samples, middle, last);
+}
+
+// 与えられた点を表すピクセルの位置を求めます。もし画像内に存在していなければfalseを返します。
+bool get_index(Point point, int *x_index, int *y_index)
+{
+    // 指針：原点のインデクスを求めてから、引数pointの各座標を加算(yは-)する。
+    int originXIndex = (WIDTH - 1) / 2 - CENTER_X;
+    int originYIndex = (HEIGHT - 1) / 2 + CENTER_Y;
+    *x_index = originXIndex + round(point.X);
+    *y_index = originYIndex - round(point.Y);
+    return !(*x_index >= WIDTH || *y_index >= HEIGHT || *x_index < 0 || *y_index < 0);
+}
+
+// 画像データが保持している行の範囲を、y座標の範囲に変換します。
+void get_y_range(GraphImage *graph_image, int *y_min, int *y_max)
+{
+    int originYIndex = (HEIGHT - 1) / 2 + CENTER_Y;
+    *y_max = originYIndex - graph_image->first_row;
+    *y_min = originYIndex - (graph_image->first_row + graph_image->row_count - 1);
+}
+
+// 指定した位置のピクセルを返します。画像データが保持していない位置であればNULLを返します。
+unsigned char *get_pixel(GraphImage *graph_image, int x_index, int y_index)
+{
+    int row = y_index - graph_image->first_row;
+    if (x_index < 0 || x_index >= WIDTH || row < 0 || row >= graph_image->row_count)
+    {
+        return NULL;
+    }
+    // BMPの並びでは下の行ほど先頭に近いので、保持している一番下の行から数える。
+    long long offset = (long long)(graph_image->row_count - 1 - row) * calc_row_size();
+    return graph_image->data + offset + x_index * (BIT_PER_PIXEL / 8);
+}
+
+void set_pixel(GraphImage *graph_image, int x_index, int y_index, Pixel color)
+{
+    unsigned char *pixel = get_pixel(graph_image, x_index, y_index);
+    if (pixel == NULL)
+    {
+        return;
+    }
+    // BMPの画素はB, G, Rの順に並んでいる。
+    pixel[0] = color.B;
+    pixel[1] = color.G;
+    pixel[2] = color.R;
 }
 
 /**
@@ -397,30 +1699,160 @@ Pixel *get_adjacent_pixel(Pixel *graph_image, Pixel *base, Direction direction)
  */
 
 // 与えられた二次元データをもとに画像を出力します。
-void export_to_bmp(Pixel *graph_image, char *file_name)
+void export_to_bmp(GraphImage *graph_image, const char *file_name)
+{
+    char *path = get_bmp_path(file_name);
+    ExportTarget *target = open_file_target(path);
+    free(path);
+    if (target == NULL)
+    {
+        perror("ファイルを開けませんでした。\n");
+        return;
+    }
+    export_bmp_to_target(graph_image, target);
+    if (!close_export_target(target))
+    {
+        perror("ファイルに書き込めませんでした。\n");
+    }
+}
+
+// ヘッダと画像データを1回の書き込みで書き出す。(画像データはコピーしない)
+bool export_bmp_to_target(GraphImage *graph_image, ExportTarget *target)
+{
+    unsigned char header[FILE_HEADER_SIZE + INFO_HEADER_SIZE];
+    write_bmp_header(header);
+    ExportVector vectors[2] = {{header, sizeof(header)}, get_image_vector(graph_image)};
+    return write_export_vectors(target, vectors, 2);
+}
+
+long long get_bmp_file_size()
+{
+    return calc_file_size();
+}
+
+// マップしたファイルにヘッダを書き込み、描画した内容をファイルに反映します。
+void export_mapped_graph_image(GraphImage *graph_image)
+{
+#ifdef USE_MMAP
+    write_bmp_header((unsigned char *)graph_image->map);
+    msync(graph_image->map, graph_image->map_size, MS_SYNC);
+#endif
+}
+
+// 画像の下側の帯から順に描画し、描画し終えた帯をそのままファイルに書き込みます。
+// BMP画像データは下の行から格納されているので、下の帯から書き込めばファイルの先頭から順に書ける。
+void export_tiled_graph_to_bmp(TiledGraph *tiled_graph, const char *file_name)
+{
+    char *path = get_bmp_path(file_name);
+    ExportTarget *target = open_file_target(path);
+    free(path);
+    if (target == NULL)
+    {
+        perror("ファイルを開けませんでした。\n");
+        return;
+    }
+    export_tiled_graph_to_target(tiled_graph, target);
+    if (!close_export_target(target))
+    {
+        perror("ファイルに書き込めませんでした。\n");
+    }
+}
+
+// ヘッダは最初の帯と一緒に書き出す。
+bool export_tiled_graph_to_target(TiledGraph *tiled_graph, ExportTarget *target)
+{
+    unsigned char header[FILE_HEADER_SIZE + INFO_HEADER_SIZE];
+    write_bmp_header(header);
+    bool is_written = true;
+
+    // 帯1つ分の画像データ(すべての帯で使い回す)
+    GraphImage strip;
+    strip.map = NULL;
+    strip.samples = NULL;
+    strip.data = (unsigned char *)calloc(calc_row_size() * tiled_graph->strip_height, 1);
+    if (strip.data == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int end_row;
+    for (end_row = HEIGHT; end_row > 0 && is_written; end_row -= tiled_graph->strip_height)
+    {
+        strip.first_row = end_row - tiled_graph->strip_height > 0 ? end_row - tiled_graph->strip_height : 0;
+        strip.row_count = end_row - strip.first_row;
+        fill_white(&strip);
+
+        // 追加された順に描画する。(帯と交わらない線分はdraw_line()で読み飛ばされる)
+        int i;
+        for (i = 0; i < tiled_graph->layer_count; i++)
+        {
+            GraphLayer *layer = tiled_graph->layers + i;
+            if (layer->line.is_affine)
+            {
+                draw_graph_linear(&strip, layer->color, layer->line.slope, layer->line.intercept);
+            }
+            else if (layer->contour != NULL)
+            {
+                draw_contour(&strip, layer->contour, layer->color);
+            }
+            else if (layer->samples == NULL)
+            {
+                draw_axis(&strip);
+            }
+            else
+            {
+                draw_points(&strip, layer->samples, layer->color);
+            }
+        }
+        ExportVector vectors[2] = {{header, sizeof(header)}, get_image_vector(&strip)};
+        if (end_row == HEIGHT)
+        {
+            is_written = write_export_vectors(target, vectors, 2);
+        }
+        else
+        {
+            is_written = write_export_vectors(target, vectors + 1, 1);
+        }
+    }
+    free(strip.data);
+    return is_written;
+}
+
+// 呼び出し元のファイル名は書き換えず、新しく確保した領域に作る。
+char *get_bmp_path(const char *file_name)
+{
+    char *path = (char *)malloc(strlen(file_name) + 5);
+    if (path == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    strcpy(path, file_name);
+    strcat(path, ".bmp");
+    return path;
+}
+
+// BMP画像のヘッダ(ファイルヘッダ + 情報ヘッダ)をbufferに書き込みます。
+void write_bmp_header(unsigned char *buffer)
 {
-    strcat(file_name, ".bmp");
-    FILE *fp = fopen(file_name, "wb");
-    write_bmp_file_header(fp);
-    write_bmp_info_header(fp);
-    write_bmp_graph_image(fp, graph_image);
-    fclose(fp);
+    write_bmp_file_header(buffer);
+    write_bmp_info_header(buffer + FILE_HEADER_SIZE);
 }
 
-// BMP画像のファイルヘッダを書き込みます。
-void write_bmp_file_header(FILE *fp)
+// BMP画像のファイルヘッダをbufferに書き込みます。
+void write_bmp_file_header(unsigned char *buffer)
 {
     // ファイルタイプ ("BM" = 0x42, 0x4d)
     char fileType[] = {0x42, 0x4d};
-    fwrite(fileType, 1, 2, fp);
+    memcpy(buffer, fileType, 2);
 
     // ファイルサイズ, 予約領域(常に0), 画像データまでのオフセット
-    int header[] = {calc_file_size(), 0, FILE_HEADER_SIZE + INFO_HEADER_SIZE};
-    fwrite(header, 4, 3, fp);
+    unsigned int header[] = {to_header_size(calc_file_size()), 0, FILE_HEADER_SIZE + INFO_HEADER_SIZE};
+    memcpy(buffer + 2, header, 4 * 3);
 }
 
-// BMP画像の情報ヘッダを書き込みます。
-void write_bmp_info_header(FILE *fp)
+// BMP画像の情報ヘッダをbufferに書き込みます。
+void write_bmp_info_header(unsigned char *buffer)
 {
     // ヘッダサイズ(常に0x28)、幅、高さ[ピクセル]
     int header0[] = {0x28, WIDTH, HEIGHT};
@@ -429,57 +1861,45 @@ void write_bmp_info_header(FILE *fp)
     short header1[] = {1, 0x18};
 
     // 圧縮タイプ(無圧縮なので0)、イメージデータサイズ、水平解像度[ppm]、垂直解像度[ppm]、カラーインデックス数、重要インデックス
-    int header2[] = {0, calc_image_size(), 1, 1, 0, 0};
+    unsigned int header2[] = {0, to_header_size(calc_image_size()), 1, 1, 0, 0};
 
-    fwrite(header0, 4, 3, fp);
-    fwrite(header1, 2, 2, fp);
-    fwrite(header2, 4, 6, fp);
+    memcpy(buffer, header0, 4 * 3);
+    memcpy(buffer + 4 * 3, header1, 2 * 2);
+    memcpy(buffer + 4 * 3 + 2 * 2, header2, 4 * 6);
 }
 
-void write_bmp_graph_image(FILE *fp, Pixel *graph_image)
+// 画像データはBMPと同じ並びで保持しているので、保持している行をそのまま書き出せる。
+ExportVector get_image_vector(GraphImage *graph_image)
 {
-    // BMP画像データは左下の画素から右上の画素に向かって格納されている
-    //   ∴  二重ループでポインタ演算をする必要がある
-    int i, j;
-    for (i = HEIGHT - 1; i >= 0; i--)
-    {
-        for (j = 0; j < WIDTH; j++)
-        {
-            // 二次元配列は、メモリ上では一次元のベクトルなので、先頭アドレス + i * 幅 * j
-            Pixel *pixel = graph_image + i * WIDTH + j;
-            fwrite(&pixel->B, 1, 1, fp);
-            fwrite(&pixel->G, 1, 1, fp);
-            fwrite(&pixel->R, 1, 1, fp);
-        }
-
-        // 不足分を0で埋める。
+    ExportVector vector = {graph_image->data, (size_t)(calc_row_size() * graph_image->row_count)};
+    return vector;
+}
 
-        int byte = BIT_PER_PIXEL / 8;
-        // 4の倍数になるための不足分を計算する。
-        // 例) 幅が33、フルカラー画像とする。 33[ピクセル] * 3[バイト] = 99では、99以上の4の倍数(100)になるためには1不足している。
-        // この1を求めるには、4から99を4で割った余り(3)を引けば求められる。
-        // よって、不足分の計算は、4 - 99 * 3 % 4 = 1
-        // 変数で一般化すると、　4 - 幅 * 1ピクセルあたりのバイト数 % 4
-        int shortage = 4 - WIDTH * byte % 4;
-        if (shortage != 0)
-        {
-            char pad = 0;
-            fwrite(&pad, 1, shortage, fp);
-        }
-    }
+// 画像データの1行のサイズ[バイト]を返します。
+long long calc_row_size()
+{
+    // 幅 * 1ピクセルあたりのバイト数が4の倍数でない場合、4の倍数になるように0で埋まる。
+    // 例) 幅が33、フルカラー画像とする。 33[ピクセル] * 3[バイト] = 99では、99以上の4の倍数(100)になるためには1不足している。
+    // よって、幅 * 1ピクセルあたりのバイト数以上かつ最小の4の倍数を求める。
+    long long byte = BIT_PER_PIXEL / 8;
+    return (WIDTH * byte + 3) / 4 * 4;
 }
 
 // 画像データそのもの(ヘッダなどを除く)のサイズ[バイト]を返します。
-int calc_image_size()
+// 巨大な画像ではintに収まらないので、64ビットで計算する。
+long long calc_image_size()
 {
-    // 幅 * 1ピクセルあたりのバイト数が4の倍数でない場合、4の倍数になるように0で埋まるので、サイズの計算が単純でない。
-    // よって、幅 * 1ピクセルあたりのバイト数 + 幅 * 1ピクセルあたりのバイト数以上かつ最小の4の倍数までの差 * 高さ * バイト数
-    int byte = BIT_PER_PIXEL / 8;
-    return (WIDTH * byte + 4 - WIDTH * byte % 4) * HEIGHT * byte;
+    return calc_row_size() * HEIGHT;
 }
 
 // 画像「ファイル」のサイズを返します。
-int calc_file_size()
+long long calc_file_size()
 {
     return FILE_HEADER_SIZE + INFO_HEADER_SIZE + calc_image_size();
+}
+
+// BMPのヘッダのサイズ欄は32ビットなので、収まらない場合は0(不明)を書き込む。
+unsigned int to_header_size(long long size)
+{
+    return size > 0xffffffffLL ? 0 : (unsigned int)size;
 }
\ No newline at end of file
@@ -1,6 +1,11 @@
 #ifndef GRAPH_WRITER
 #define GRAPH_WRITER
+#include <stdbool.h>
 #include "parser.h"
+#include "fast_math.h"
+#include "program.h"
+#include "jit.h"
+#include "export_target.h"
 
 // 画像の1ピクセルあたりの情報を表現する構造体
 typedef struct pixel
@@ -13,19 +18,147 @@ typedef struct pixel
     unsigned char B;
 } Pixel;
 
+// パラメータを含む式のグラフの族(パラメータの値を等間隔に変えた複数のグラフ)
+typedef struct graph_family
+{
+    // パラメータの名前(式中のx以外の変数)
+    char *parameter_name;
+    // 最初と最後のグラフのパラメータの値
+    double start;
+    double end;
+    // グラフの数
+    int count;
+    // 最初と最後のグラフの色(間のグラフの色は線形補間する)
+    Pixel start_color;
+    Pixel end_color;
+} GraphFamily;
+
+// 描画と同じx座標(画面の両側の外の点を含む)で求めた、複数の式のグラフの点
+typedef struct graph_samples
+{
+    // 1つのグラフの点の数
+    int count;
+    // 各点のx座標(グラフの座標系)
+    double *xs;
+    // r番目の式のi番目の点のy座標(グラフの座標系)はys[r * count + i]
+    double *ys;
+    // r番目の式のi番目の点と次の点が連続ならis_continuous[r * count + i]がtrue(描画で線を結ぶかと同じ判定)
+    bool *is_continuous;
+} GraphSamples;
+
+// 描画先の画像データを表現する構造体
+// 画素はBMPの画像データと同じ並び(下の行から順に、1画素をB,G,Rの順で格納し、各行は4バイトの倍数まで0で埋める)で保持する。
+// 画像全体ではなく、連続した一部の行(帯)だけを保持することもある。
+typedef struct graph_image
+{
+    // 画素データの先頭アドレス(保持している行のうち、一番下の行の左端)
+    unsigned char *data;
+    // 保持している一番上の行(画像全体での行番号。画像の上端が0)
+    int first_row;
+    // 保持している行数
+    int row_count;
+    // 出力ファイルをメモリにマップしている場合は、マップした領域(ヘッダを含むファイル全体)。そうでなければNULL
+    void *map;
+    // マップした領域の大きさ[バイト]
+    long long map_size;
+    // 式のグラフを描画する時の超越関数の計算精度(初期値はaccuracy_full)
+    Accuracy accuracy;
+    // グラフの点の集合を求める作業領域(描画するグラフごとに使い回す。最初に描画するまではNULL)
+    struct sample_buffer *samples;
+} GraphImage;
+
 // graph_imageを初期化して返す
-Pixel *init_graph_image();
+GraphImage *init_graph_image();
+// 出力ファイルをメモリにマップし、その画像データの領域に直接描画するgraph_imageを返す。(マップできない場合はNULL)
+GraphImage *init_mapped_graph_image(const char *file_name);
+// 画像の内容をコピーする。(destinationはsourceと同じ行を保持していること)
+void copy_graph_image(GraphImage *destination, GraphImage *source);
 // graph_imageを開放する。
-void dispose_image(Pixel *graph_image);
+void dispose_image(GraphImage *graph_image);
+// 画像データを白で塗りつぶす。
+void fill_white(GraphImage *graph_image);
 
 // 与えられた式のグラフを指定色で描画する。
-void draw_graph_expression(Pixel *graph_image, Pixel color, char *expression);
+void draw_graph_expression(GraphImage *graph_image, Pixel color, const char *expression);
+// コンパイル済みの式(nodeをコンパイルしたprogramと、それを機械語にしたjit。jitはNULLでもよい)のグラフを指定色で描画する。
+void draw_graph_compiled(GraphImage *graph_image, Pixel color, Node *node, Program *program, JitFunction *jit);
+// 与えられた複数の式のグラフを、それぞれの色で描画する。(すべての式を1つのプログラムにまとめ、式の間で共通の部分式は1回だけ計算する)
+void draw_graph_expressions(GraphImage *graph_image, Pixel *colors, char **expressions, int count);
+// 与えられた式のグラフの族を描画する。(式は1回だけ解析し、すべてのグラフの点をまとめて計算する)
+void draw_graph_family(GraphImage *graph_image, GraphFamily *family, const char *expression);
+// 直線 y = slope * x + intercept を指定色で描画する。(式が1次式のグラフも、これで描画される)
+void draw_graph_linear(GraphImage *graph_image, Pixel color, double slope, double intercept);
+// 「左辺=右辺」の形の陰関数の曲線を指定色で描画する。(式中のyはxと別の変数として扱う。thread_countが0以下の場合はCPUの数だけスレッドを使う)
+void draw_graph_implicit(GraphImage *graph_image, Pixel color, const char *expression, int thread_count);
 // 与えられた関数のグラフを指定色で描画する。
-void draw_graph_func(Pixel *graph_image, Pixel color, Node *node, double (*f)(double x, Node *node));
+void draw_graph_func(GraphImage *graph_image, Pixel color, void *userdata, double (*f)(double x, void *userdata));
+// 点(x, y)に指定色の円の印を描画する。
+void draw_marker(GraphImage *graph_image, Pixel color, double x, double y);
 // 座標軸を描画します。
-void draw_axis(Pixel *graph_image);
+void draw_axis(GraphImage *graph_image);
+// 画像の各列を、その列のx座標(グラフの座標系)に応じた色で塗りつぶす。
+void paint_columns(GraphImage *graph_image, Pixel (*color_of)(double x, void *context), void *context);
+// 画像に写るxの範囲(グラフの座標系)を求める。
+void get_graph_x_range(double *x_min, double *x_max);
+// 画像に写るyの範囲(グラフの座標系)を求める。
+void get_graph_y_range(double *y_min, double *y_max);
+// 複数の式のグラフの点を、描画と同じように1つのプログラムで一括で計算して求める。
+GraphSamples *sample_graph_expressions(Node **nodes, int count, Accuracy accuracy);
+// グラフの点を開放する。
+void dispose_graph_samples(GraphSamples *graph_samples);
 
 // bmpとしてグラフを出力する。
-void export_to_bmp(Pixel *graph_image, char *file_name);
+void export_to_bmp(GraphImage *graph_image, const char *file_name);
+// bmpとしてグラフを書き出し先(標準出力やパイプ、メモリなど)に出力する。(書き出しに失敗したらfalse)
+bool export_bmp_to_target(GraphImage *graph_image, ExportTarget *target);
+// bmpとして出力した場合の大きさ[バイト]を返す。(メモリに出力する場合の領域の大きさ)
+long long get_bmp_file_size();
+// init_mapped_graph_image()で生成したgraph_imageのヘッダを書き込み、ファイルに反映する。
+void export_mapped_graph_image(GraphImage *graph_image);
+
+// 粗い点の集合から描画し始め、段階ごとに点を増やして描き直すグラフ。(全体を描画し終わる前に、荒いプレビューを表示するため)
+// 前の段階で計算した点はそのまま使い、各段階では間の点だけを計算する。
+typedef struct progressive_graph ProgressiveGraph;
+
+// 複数の式のグラフを段階的に描画する準備をする。(まだ点は計算しない)
+ProgressiveGraph *init_progressive_graph(char **expressions, Pixel *colors, int count, Accuracy accuracy);
+// 段階の数を返す。
+int get_progressive_pass_count(ProgressiveGraph *progressive_graph);
+// 次の段階の点を計算し、画像を白で塗りつぶしてから、それまでに求めた点で座標軸とグラフを描き直す。
+// 最後の段階の画像は、draw_axis()とdraw_graph_expressions()で描画したものと同じになる。(すべての段階を終えていればfalseを返して何もしない)
+bool refine_progressive_graph(ProgressiveGraph *progressive_graph, GraphImage *graph_image);
+// 段階的に描画するグラフを開放する。
+void dispose_progressive_graph(ProgressiveGraph *progressive_graph);
+// 画像の幅と高さ[ピクセル]、1行のサイズ[バイト]を求める。
+void get_graph_image_layout(int *width, int *height, int *row_size);
+
+// 画像を帯(ストリップ)に分けて描画し、描画し終えた帯から順にBMPへ書き出すグラフ。
+// 画像全体をメモリ上に持たないので、巨大な画像でも使用メモリは帯の大きさで決まる。
+typedef struct tiled_graph TiledGraph;
+
+// 1つの帯の行数を指定して、分割描画用のグラフを初期化する。
+TiledGraph *init_tiled_graph(int strip_height);
+// 以降に追加する式のグラフの、超越関数の計算精度を設定する。(初期値はaccuracy_full)
+void set_tiled_graph_accuracy(TiledGraph *tiled_graph, Accuracy accuracy);
+// 分割描画用のグラフを開放する。
+void dispose_tiled_graph(TiledGraph *tiled_graph);
+// 座標軸を描画対象に追加する。
+void add_axis(TiledGraph *tiled_graph);
+// 与えられた式のグラフを描画対象に追加する。
+void add_graph_expression(TiledGraph *tiled_graph, Pixel color, const char *expression);
+// 与えられた複数の式のグラフを描画対象に追加する。(draw_graph_expressions()と同様に一括で計算する)
+void add_graph_expressions(TiledGraph *tiled_graph, Pixel *colors, char **expressions, int count);
+// 与えられた式のグラフの族を描画対象に追加する。
+void add_graph_family(TiledGraph *tiled_graph, GraphFamily *family, const char *expression);
+// 直線 y = slope * x + intercept を描画対象に追加する。
+void add_graph_linear(TiledGraph *tiled_graph, Pixel color, double slope, double intercept);
+// 陰関数の曲線を描画対象に追加する。
+void add_graph_implicit(TiledGraph *tiled_graph, Pixel color, const char *expression);
+// 与えられた関数のグラフを描画対象に追加する。
+void add_graph_func(TiledGraph *tiled_graph, Pixel color, void *userdata, double (*f)(double x, void *userdata));
+// 帯ごとに描画しながらbmpとして出力する。
+void export_tiled_graph_to_bmp(TiledGraph *tiled_graph, const char *file_name);
+// 帯ごとに描画しながらbmpとして書き出し先に出力する。(書き出しに失敗したらfalse)
+bool export_tiled_graph_to_target(TiledGraph *tiled_graph, ExportTarget *target);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,288 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdbool.h>
+#include "lexer.h"
+#include "parser.h"
+#include "calclator.h"
+#include "program.h"
+#include "parallel.h"
+#include "implicit_curve.h"
+
+// 1つのスレッドがまとめて処理するタイルの1辺のマスの数
+#define CONTOUR_TILE_SIZE 64
+// 区間演算で範囲を分割していく時の、値をまとめて計算する範囲の1辺のマスの数
+#define CONTOUR_BLOCK_SIZE 16
+
+// スレッド間で共有する情報
+typedef struct contour_work
+{
+    Node *node;
+    // yをパラメータとしてコンパイルしたプログラム(スレッドごとに構造体をコピーして使う)
+    Program *program;
+    ContourGrid *grid;
+    int tile_columns;
+    // タイルごとに求めた線分(タイルの順に連結するので、スレッドの数によらず同じ結果になる)
+    Contour *contours;
+} ContourWork;
+
+// タイルの曲線を求める。
+void trace_tile(int tile_index, void *context);
+// 格子点i0からi1まで、j0からj1までの範囲の曲線を求める。
+void trace_range(ContourWork *work, Program *program, Contour *contour, int i0, int i1, int j0, int j1);
+// 範囲の格子点の値を計算し、各マスの線分を求める。
+void march_range(ContourWork *work, Program *program, Contour *contour, int i0, int i1, int j0, int j1);
+// 1つのマスの線分を求める。(値は左下、右下、右上、左上の順)
+void march_cell(Contour *contour, double x, double y, double step, double *values);
+// 辺の上で値が0になる点を、両端の値から線形補間で求める。
+void interpolate_edge(double x, double y, double step, double *values, int edge, double *point_x, double *point_y);
+// 線分を追加する。
+void add_segment(Contour *contour, double x1, double y1, double x2, double y2);
+
+bool is_implicit_expression(const char *expression)
+{
+    return strchr(expression, '=') != NULL;
+}
+
+// 左辺-(右辺)の文字列を作ってから解析する。
+Node *parse_implicit_expression(const char *expression)
+{
+    const char *equal = strchr(expression, '=');
+    int left_length = equal - expression;
+    char *difference = (char *)malloc(strlen(expression) + 5);
+    if (difference == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    sprintf(difference, "(%.*s)-(%s)", left_length, expression, equal + 1);
+    Node *node = parse(lexical(difference));
+    free(difference);
+    return node;
+}
+
+Contour *trace_contour(Node *node, ContourGrid *grid, Accuracy accuracy, int thread_count)
+{
+    ContourWork work;
+    work.node = node;
+    work.grid = grid;
+    work.program = compile_program_with_parameter(node, IMPLICIT_Y_NAME);
+    work.program->accuracy = accuracy;
+    work.tile_columns = (grid->width - 1 + CONTOUR_TILE_SIZE - 1) / CONTOUR_TILE_SIZE;
+    int tile_rows = (grid->height - 1 + CONTOUR_TILE_SIZE - 1) / CONTOUR_TILE_SIZE;
+    int tile_count = work.tile_columns * tile_rows;
+    work.contours = (Contour *)calloc(tile_count + 1, sizeof(Contour));
+    if (work.contours == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    parallel_for(tile_count, trace_tile, &work, thread_count);
+
+    Contour *contour = (Contour *)calloc(1, sizeof(Contour));
+    if (contour == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int i, j;
+    for (i = 0; i < tile_count; i++)
+    {
+        for (j = 0; j < work.contours[i].count; j++)
+        {
+            ContourSegment *segment = work.contours[i].segments + j;
+            add_segment(contour, segment->x1, segment->y1, segment->x2, segment->y2);
+        }
+        free(work.contours[i].segments);
+    }
+    free(work.contours);
+    dispose_program(work.program);
+    return contour;
+}
+
+void dispose_contour(Contour *contour)
+{
+    free(contour->segments);
+    free(contour);
+}
+
+void trace_tile(int tile_index, void *context)
+{
+    ContourWork *work = (ContourWork *)context;
+    // run_program_family()はパラメータの値を書き換えるので、スレッドごとにコピーする。(命令列は共有する)
+    Program program = *work->program;
+    int i0 = tile_index % work->tile_columns * CONTOUR_TILE_SIZE;
+    int j0 = tile_index / work->tile_columns * CONTOUR_TILE_SIZE;
+    int i1 = i0 + CONTOUR_TILE_SIZE < work->grid->width - 1 ? i0 + CONTOUR_TILE_SIZE : work->grid->width - 1;
+    int j1 = j0 + CONTOUR_TILE_SIZE < work->grid->height - 1 ? j0 + CONTOUR_TILE_SIZE : work->grid->height - 1;
+    trace_range(work, &program, work->contours + tile_index, i0, i1, j0, j1);
+}
+
+// 範囲全体で値が0にならなければ何もせず、不連続点を含む可能性があるか広すぎる場合は長い方の辺を半分に分けて調べる。
+// (sample_range()と同じ考え方)
+void trace_range(ContourWork *work, Program *program, Contour *contour, int i0, int i1, int j0, int j1)
+{
+    ContourGrid *grid = work->grid;
+    Interval x = {grid->x_min + grid->step * i0, grid->x_min + grid->step * i1, true};
+    Interval y = {grid->y_min + grid->step * j0, grid->y_min + grid->step * j1, true};
+    Interval value = calclate_interval_xy(x, y, work->node, IMPLICIT_Y_NAME);
+    // 値の範囲に0を含まない場合や、範囲全体で定義されていない場合
+    if (value.low > 0 || value.high < 0 || (isnan(value.low) && isnan(value.high)))
+    {
+        return;
+    }
+    bool is_small = i1 - i0 <= CONTOUR_BLOCK_SIZE && j1 - j0 <= CONTOUR_BLOCK_SIZE;
+    if (value.is_continuous && is_small)
+    {
+        march_range(work, program, contour, i0, i1, j0, j1);
+        return;
+    }
+    // 1つのマスだけの範囲で連続でない場合は、そのマスは描画しない。
+    if (i1 - i0 == 1 && j1 - j0 == 1)
+    {
+        return;
+    }
+    if (i1 - i0 >= j1 - j0)
+    {
+        int middle = (i0 + i1) / 2;
+        trace_range(work, program, contour, i0, middle, j0, j1);
+        trace_range(work, program, contour, middle, i1, j0, j1);
+    }
+    else
+    {
+        int middle = (j0 + j1) / 2;
+        trace_range(work, program, contour, i0, i1, j0, middle);
+        trace_range(work, program, contour, i0, i1, middle, j1);
+    }
+}
+
+// 各行のyをパラメータの値として、行ごとの値を一括で計算する。
+void march_range(ContourWork *work, Program *program, Contour *contour, int i0, int i1, int j0, int j1)
+{
+    ContourGrid *grid = work->grid;
+    double xs[CONTOUR_BLOCK_SIZE + 1];
+    double ys[CONTOUR_BLOCK_SIZE + 1] = {0};
+    double values[(CONTOUR_BLOCK_SIZE + 1) * (CONTOUR_BLOCK_SIZE + 1)];
+    int columns = i1 - i0 + 1;
+    int rows = j1 - j0 + 1;
+    int i, j;
+    for (i = 0; i < columns; i++)
+    {
+        xs[i] = grid->x_min + grid->step * (i0 + i);
+    }
+    for (j = 0; j < rows; j++)
+    {
+        ys[j] = grid->y_min + grid->step * (j0 + j);
+    }
+    run_program_family(program, ys, rows, xs, values, columns);
+    for (j = 0; j < rows - 1; j++)
+    {
+        for (i = 0; i < columns - 1; i++)
+        {
+            double corners[4] = {values[j * columns + i], values[j * columns + i + 1],
+                                 values[(j + 1) * columns + i + 1], values[(j + 1) * columns + i]};
+            march_cell(contour, xs[i], ys[j], grid->step, corners);
+        }
+    }
+}
+
+// 角の値が正かどうかの組み合わせから、値が0になる点を通る辺を決めて結ぶ。
+// 辺の番号は、0: 下, 1: 右, 2: 上, 3: 左
+void march_cell(Contour *contour, double x, double y, double step, double *values)
+{
+    int k;
+    for (k = 0; k < 4; k++)
+    {
+        if (isnan(values[k]))
+        {
+            return;
+        }
+    }
+    bool is_positive[4];
+    for (k = 0; k < 4; k++)
+    {
+        is_positive[k] = values[k] > 0;
+    }
+    // 両端の符号が異なる辺
+    int edges[4];
+    int edge_count = 0;
+    for (k = 0; k < 4; k++)
+    {
+        if (is_positive[k] != is_positive[(k + 1) % 4])
+        {
+            edges[edge_count++] = k;
+        }
+    }
+    double x1, y1, x2, y2;
+    if (edge_count == 2)
+    {
+        interpolate_edge(x, y, step, values, edges[0], &x1, &y1);
+        interpolate_edge(x, y, step, values, edges[1], &x2, &y2);
+        add_segment(contour, x1, y1, x2, y2);
+        return;
+    }
+    if (edge_count != 4)
+    {
+        return;
+    }
+    // 対角の角の符号が同じ場合は、中心の値で、どちらの対角がつながっているかを決める。
+    bool is_center_positive = (values[0] + values[1] + values[2] + values[3]) / 4 > 0;
+    int pairs[2][2];
+    if (is_center_positive == is_positive[0])
+    {
+        // 左下の角と同じ符号の領域が中央でつながっているので、右下と左上の角を切り離す。
+        pairs[0][0] = 0;
+        pairs[0][1] = 1;
+        pairs[1][0] = 2;
+        pairs[1][1] = 3;
+    }
+    else
+    {
+        // 左下と右上の角を切り離す。
+        pairs[0][0] = 3;
+        pairs[0][1] = 0;
+        pairs[1][0] = 1;
+        pairs[1][1] = 2;
+    }
+    for (k = 0; k < 2; k++)
+    {
+        interpolate_edge(x, y, step, values, pairs[k][0], &x1, &y1);
+        interpolate_edge(x, y, step, values, pairs[k][1], &x2, &y2);
+        add_segment(contour, x1, y1, x2, y2);
+    }
+}
+
+void interpolate_edge(double x, double y, double step, double *values, int edge, double *point_x, double *point_y)
+{
+    // 角の位置(左下からのマス数)
+    int corner_x[4] = {0, 1, 1, 0};
+    int corner_y[4] = {0, 0, 1, 1};
+    int a = edge, b = (edge + 1) % 4;
+    double t = values[a] / (values[a] - values[b]);
+    *point_x = x + step * (corner_x[a] + t * (corner_x[b] - corner_x[a]));
+    *point_y = y + step * (corner_y[a] + t * (corner_y[b] - corner_y[a]));
+}
+
+void add_segment(Contour *contour, double x1, double y1, double x2, double y2)
+{
+    // 足りなくなったら倍の大きさにする。
+    if (contour->count == contour->capacity)
+    {
+        int capacity = contour->capacity == 0 ? 64 : contour->capacity * 2;
+        ContourSegment *segments = (ContourSegment *)realloc(contour->segments, sizeof(ContourSegment) * capacity);
+        if (segments == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        contour->segments = segments;
+        contour->capacity = capacity;
+    }
+    ContourSegment *segment = contour->segments + contour->count;
+    segment->x1 = x1;
+    segment->y1 = y1;
+    segment->x2 = x2;
+    segment->y2 = y2;
+    contour->count++;
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#ifndef IMPLICIT_CURVE
+#define IMPLICIT_CURVE
+#include <stdbool.h>
+#include "parser.h"
+#include "fast_math.h"
+
+// 陰関数の式で、xと別の変数として扱う変数の名前
+#define IMPLICIT_Y_NAME "y"
+
+// 曲線を近似する線分(グラフの座標系)
+typedef struct contour_segment
+{
+    double x1;
+    double y1;
+    double x2;
+    double y2;
+} ContourSegment;
+
+// 曲線を近似する線分の集合
+typedef struct contour
+{
+    ContourSegment *segments;
+    int count;
+    int capacity;
+} Contour;
+
+// 曲線を求める格子(グラフの座標系で、x_min + step * i, y_min + step * j の点を並べたもの)
+typedef struct contour_grid
+{
+    double x_min;
+    double y_min;
+    double step;
+    // 格子点の数
+    int width;
+    int height;
+} ContourGrid;
+
+// 「左辺=右辺」の形の陰関数の式かを調べる。
+bool is_implicit_expression(const char *expression);
+// 「左辺=右辺」の式を、左辺-(右辺)の構文木に変換する。
+Node *parse_implicit_expression(const char *expression);
+// 式の値が0になる曲線(式がxとyの2変数の関数f(x, y)として、f(x, y) = 0の曲線)を、格子の各マスで線分に近似して求める。
+// 格子をタイルに分けてthread_count個のスレッドで並列に処理する。(0以下の場合はCPUの数)
+// 区間演算で値が0にならないと分かった範囲は計算を省き、値を計算した範囲はマーチングスクエア法で線分を求める。
+Contour *trace_contour(Node *node, ContourGrid *grid, Accuracy accuracy, int thread_count);
+// 線分の集合を開放する。
+void dispose_contour(Contour *contour);
+
+#endif
\ No newline at end of file
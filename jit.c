@@ -0,0 +1,538 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdbool.h>
+#include "parser.h"
+#include "program.h"
+#include "fast_math.h"
+#include "jit.h"
+
+// 機械語を生成できる環境か(System V ABIのx86-64で、実行可能な領域をmmapで確保できる)
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+// JITコンパイルするプログラムの最大命令数(命令ごとにスタック上の領域を使うため)
+#define MAX_JIT_INSTRUCTION_COUNT 32768
+// floatの一括計算の幅の最大値(AVXで8つ)
+#define MAX_BATCH_WIDTH_FLOAT 8
+
+#ifdef JIT_SUPPORTED
+
+// 生成する命令の種類
+typedef enum vector_kind
+{
+    jit_scalar, // SSE2のスカラー命令(1つずつ)
+    jit_sse2,   // SSE2のパックド命令(2つずつ)
+    jit_avx,    // AVXのパックド命令(4つずつ)
+    jit_sse_float, // SSEのfloatのパックド命令(4つずつ)
+    jit_avx_float, // AVXのfloatのパックド命令(8つずつ)
+} VectorKind;
+
+// 生成中の機械語
+typedef struct code_buffer
+{
+    unsigned char *bytes;
+    int size;
+    int capacity;
+} CodeBuffer;
+
+// 機械語を書き込む関数群
+void emit_byte(CodeBuffer *code, unsigned char byte);
+void emit_bytes(CodeBuffer *code, const unsigned char *bytes, int count);
+void emit_int32(CodeBuffer *code, int value);
+void emit_int64(CodeBuffer *code, long long value);
+// 命令の種類に応じたプレフィックスと0x0f(AVXの場合はVEXプレフィックス)を書き込む。
+void emit_prefix(CodeBuffer *code, VectorKind kind);
+// 「命令 xmm(reg), [rbp + disp]」の形の命令を書き込む。
+void emit_rbp_op(CodeBuffer *code, VectorKind kind, unsigned char opcode, int reg, int disp);
+// 一度に計算する値の数を返す。
+int get_lane_count(VectorKind kind);
+// floatの命令ならtrueを返す。
+bool is_float_kind(VectorKind kind);
+// 1つの関数を書き込む。(jit_scalarならdouble f(double x, void *userdata)、それ以外は一括計算の関数)
+void emit_function(CodeBuffer *code, Program *program, VectorKind kind);
+// 命令の結果を置くスタック上の位置(rbpからの相対位置)を返す。
+int get_slot(int index, int slot_size);
+// 超越関数や整数乗の命令を、fast_math.cの一括計算の関数の呼び出しとして書き込む。
+void emit_kernel_call(CodeBuffer *code, Program *program, Instruction *instruction, VectorKind kind, int left, int right, int out);
+// 「lea reg, [rbp + disp]」を書き込む。(reg: 7=rdi, 6=rsi, 2=rdx)
+void emit_lea(CodeBuffer *code, int reg, int disp);
+// 定数として書き込む命令(op_constまたはop_param)の値を返す。
+double get_constant_value(Program *program, int index);
+
+#endif
+
+JitFunction *compile_jit(Program *program)
+{
+#ifdef JIT_SUPPORTED
+    if (program->instruction_count > MAX_JIT_INSTRUCTION_COUNT)
+    {
+        return NULL;
+    }
+    // AVXが使えるCPUなら4つずつ(floatは8つずつ)、そうでなければSSE2で2つずつ(floatは4つずつ)一括計算する。
+    bool has_avx = __builtin_cpu_supports("avx");
+    VectorKind batch_kind = has_avx ? jit_avx : jit_sse2;
+    VectorKind float_kind = has_avx ? jit_avx_float : jit_sse_float;
+
+    CodeBuffer code = {NULL, 0, 0};
+    emit_function(&code, program, jit_scalar);
+    // 関数の先頭を16バイト境界に揃える。(int3で埋める)
+    while (code.size % 16 != 0)
+    {
+        emit_byte(&code, 0xcc);
+    }
+    int batch_offset = code.size;
+    emit_function(&code, program, batch_kind);
+    while (code.size % 16 != 0)
+    {
+        emit_byte(&code, 0xcc);
+    }
+    int float_offset = code.size;
+    emit_function(&code, program, float_kind);
+
+    // 書き込み可能な領域に機械語を置いてから、実行可能(書き込み不可)に切り替える。
+    void *memory = mmap(NULL, code.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        free(code.bytes);
+        return NULL;
+    }
+    memcpy(memory, code.bytes, code.size);
+    free(code.bytes);
+    if (mprotect(memory, code.size, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(memory, code.size);
+        return NULL;
+    }
+
+    JitFunction *jit = (JitFunction *)calloc(1, sizeof(JitFunction));
+    jit->code = memory;
+    jit->code_size = code.size;
+    jit->function = (double (*)(double, void *))memory;
+    jit->batch_function = (void (*)(const double *, double *, long))((unsigned char *)memory + batch_offset);
+    jit->batch_width = get_lane_count(batch_kind);
+    jit->batch_function_float = (void (*)(const float *, float *, long))((unsigned char *)memory + float_offset);
+    jit->batch_width_float = get_lane_count(float_kind);
+    return jit;
+#else
+    return NULL;
+#endif
+}
+
+void run_jit(JitFunction *jit, const double *xs, double *ys, int count)
+{
+    // 一括計算の幅で割り切れる分は一括計算の関数、残りは1つずつ計算する。
+    int batch_count = count - count % jit->batch_width;
+    jit->batch_function(xs, ys, batch_count);
+    int i;
+    for (i = batch_count; i < count; i++)
+    {
+        ys[i] = jit->function(xs[i], NULL);
+    }
+}
+
+void run_jit_float(JitFunction *jit, const float *xs, float *ys, int count)
+{
+    // 一括計算の幅で割り切れない残りは、最後の値で埋めた幅分の配列で計算する。
+    int batch_count = count - count % jit->batch_width_float;
+    jit->batch_function_float(xs, ys, batch_count);
+    if (batch_count < count)
+    {
+        float rest_xs[MAX_BATCH_WIDTH_FLOAT];
+        float rest_ys[MAX_BATCH_WIDTH_FLOAT];
+        int i;
+        for (i = 0; i < jit->batch_width_float; i++)
+        {
+            rest_xs[i] = xs[batch_count + i < count ? batch_count + i : count - 1];
+        }
+        jit->batch_function_float(rest_xs, rest_ys, jit->batch_width_float);
+        memcpy(ys + batch_count, rest_ys, sizeof(float) * (count - batch_count));
+    }
+}
+
+void dispose_jit(JitFunction *jit)
+{
+#ifdef JIT_SUPPORTED
+    munmap(jit->code, jit->code_size);
+#endif
+    free(jit);
+}
+
+#ifdef JIT_SUPPORTED
+
+void emit_byte(CodeBuffer *code, unsigned char byte)
+{
+    // 足りなくなったら倍の大きさにする。
+    if (code->size == code->capacity)
+    {
+        int capacity = code->capacity == 0 ? 1024 : code->capacity * 2;
+        unsigned char *bytes = (unsigned char *)realloc(code->bytes, capacity);
+        if (bytes == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        code->bytes = bytes;
+        code->capacity = capacity;
+    }
+    code->bytes[code->size++] = byte;
+}
+
+void emit_bytes(CodeBuffer *code, const unsigned char *bytes, int count)
+{
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        emit_byte(code, bytes[i]);
+    }
+}
+
+// x86-64はリトルエンディアン
+void emit_int32(CodeBuffer *code, int value)
+{
+    int i;
+    for (i = 0; i < 4; i++)
+    {
+        emit_byte(code, (unsigned char)((unsigned int)value >> (8 * i)));
+    }
+}
+
+void emit_int64(CodeBuffer *code, long long value)
+{
+    int i;
+    for (i = 0; i < 8; i++)
+    {
+        emit_byte(code, (unsigned char)((unsigned long long)value >> (8 * i)));
+    }
+}
+
+void emit_prefix(CodeBuffer *code, VectorKind kind)
+{
+    switch (kind)
+    {
+    case jit_scalar:
+        emit_byte(code, 0xf2);
+        emit_byte(code, 0x0f);
+        break;
+    case jit_sse2:
+        emit_byte(code, 0x66);
+        emit_byte(code, 0x0f);
+        break;
+    case jit_sse_float:
+        emit_byte(code, 0x0f);
+        break;
+    case jit_avx:
+        // 2バイトのVEXプレフィックス(256ビット, 66相当, 第1ソースはymm0)
+        emit_byte(code, 0xc5);
+        emit_byte(code, 0xfd);
+        break;
+    case jit_avx_float:
+        // 2バイトのVEXプレフィックス(256ビット, プレフィックスなし相当, 第1ソースはymm0)
+        emit_byte(code, 0xc5);
+        emit_byte(code, 0xfc);
+        break;
+    }
+}
+
+// opcode: 0x10(読み込み), 0x11(書き込み), 0x58(加算), 0x5c(減算), 0x59(乗算), 0x5e(除算), 0x57(排他的論理和)
+void emit_rbp_op(CodeBuffer *code, VectorKind kind, unsigned char opcode, int reg, int disp)
+{
+    emit_prefix(code, kind);
+    emit_byte(code, opcode);
+    // ModR/M: [rbp + disp32]
+    emit_byte(code, 0x80 | (reg << 3) | 5);
+    emit_int32(code, disp);
+}
+
+int get_lane_count(VectorKind kind)
+{
+    switch (kind)
+    {
+    case jit_scalar:
+        return 1;
+    case jit_sse2:
+        return 2;
+    case jit_avx:
+    case jit_sse_float:
+        return 4;
+    default:
+        return 8;
+    }
+}
+
+bool is_float_kind(VectorKind kind)
+{
+    return kind == jit_sse_float || kind == jit_avx_float;
+}
+
+// スタックの構成(rbpからの相対位置)
+// -8: rbx, -16: x(スカラー)または結果の書き込み先(一括計算), -24: 残りの個数(一括計算), -32以降: 各命令の結果
+int get_slot(int index, int slot_size)
+{
+    return -32 - (index + 1) * slot_size;
+}
+
+void emit_lea(CodeBuffer *code, int reg, int disp)
+{
+    emit_byte(code, 0x48);
+    emit_byte(code, 0x8d);
+    emit_byte(code, 0x80 | (reg << 3) | 5);
+    emit_int32(code, disp);
+}
+
+// パラメータは、コンパイルした時の値の定数として埋め込む。
+double get_constant_value(Program *program, int index)
+{
+    Instruction *instruction = program->instructions + index;
+    return instruction->opcode == op_param ? program->parameter : instruction->value;
+}
+
+void emit_kernel_call(CodeBuffer *code, Program *program, Instruction *instruction, VectorKind kind, int left, int right, int out)
+{
+    int lane_count = get_lane_count(kind);
+    bool is_float = is_float_kind(kind);
+    void *function = NULL;
+    // 引数はSystem V ABIに従って rdi, rsi, rdx, ecx, r8d の順に入れる。(配列はスタック上の命令の結果を指す)
+    if (instruction->opcode == op_pow)
+    {
+        // pow_kernel(bases, exponents, ys, count, accuracy)
+        function = is_float ? (void *)pow_kernel_float : (void *)pow_kernel;
+        emit_lea(code, 7, left);
+        emit_lea(code, 6, right);
+        emit_lea(code, 2, out);
+        emit_byte(code, 0xb9);
+        emit_int32(code, lane_count);
+        emit_bytes(code, (const unsigned char[]){0x41, 0xb8}, 2);
+        emit_int32(code, program->accuracy);
+    }
+    else if (instruction->opcode == op_powi)
+    {
+        // powi_kernel(xs, ys, exponent, count)
+        function = is_float ? (void *)powi_kernel_float : (void *)powi_kernel;
+        emit_lea(code, 7, left);
+        emit_lea(code, 6, out);
+        emit_byte(code, 0xba);
+        emit_int32(code, (int)instruction->value);
+        emit_byte(code, 0xb9);
+        emit_int32(code, lane_count);
+    }
+    else
+    {
+        // sin_kernel(xs, ys, count, accuracy) など
+        switch (instruction->opcode)
+        {
+        case op_sin:
+            function = is_float ? (void *)sin_kernel_float : (void *)sin_kernel;
+            break;
+        case op_cos:
+            function = is_float ? (void *)cos_kernel_float : (void *)cos_kernel;
+            break;
+        case op_tan:
+            function = is_float ? (void *)tan_kernel_float : (void *)tan_kernel;
+            break;
+        case op_log:
+            function = is_float ? (void *)log_kernel_float : (void *)log_kernel;
+            break;
+        default:
+            function = is_float ? (void *)exp_kernel_float : (void *)exp_kernel;
+            break;
+        }
+        emit_lea(code, 7, right);
+        emit_lea(code, 6, out);
+        emit_byte(code, 0xba);
+        emit_int32(code, lane_count);
+        emit_byte(code, 0xb9);
+        emit_int32(code, program->accuracy);
+    }
+    // mov rax, 関数のアドレス; call rax
+    emit_bytes(code, (const unsigned char[]){0x48, 0xb8}, 2);
+    emit_int64(code, (long long)function);
+    emit_bytes(code, (const unsigned char[]){0xff, 0xd0}, 2);
+}
+
+void emit_function(CodeBuffer *code, Program *program, VectorKind kind)
+{
+    int lane_count = get_lane_count(kind);
+    bool is_float = is_float_kind(kind);
+    // 一度に計算する値の大きさ[バイト]
+    int lane_size = lane_count * (is_float ? 4 : 8);
+    // パックド命令のメモリオペランドが16バイト境界に揃うように、最低16バイトずつ確保する。
+    int slot_size = lane_size < 16 ? 16 : lane_size;
+    int n = program->instruction_count;
+    // 符号反転用のマスクは命令の結果の後ろに置く。
+    int sign_slot = get_slot(n, slot_size);
+    // push rbp, push rbxの後にスタックが16バイト境界に揃うようにする。
+    int frame_size = (24 + (n + 1) * slot_size + 15) / 16 * 16 + 8;
+    int i, k;
+
+    // push rbp; mov rbp, rsp; push rbx; sub rsp, frame_size
+    emit_bytes(code, (const unsigned char[]){0x55, 0x48, 0x89, 0xe5, 0x53, 0x48, 0x81, 0xec}, 8);
+    emit_int32(code, frame_size);
+    if (kind == jit_scalar)
+    {
+        // movsd [rbp-16], xmm0
+        emit_rbp_op(code, jit_scalar, 0x11, 0, -16);
+    }
+    else
+    {
+        // mov rbx, rdi(xs); mov [rbp-16], rsi(ys); mov [rbp-24], rdx(count)
+        emit_bytes(code, (const unsigned char[]){0x48, 0x89, 0xfb, 0x48, 0x89, 0xb5}, 6);
+        emit_int32(code, -16);
+        emit_bytes(code, (const unsigned char[]){0x48, 0x89, 0x95}, 3);
+        emit_int32(code, -24);
+    }
+
+    // 定数はループの外で一度だけ書き込む。(mov rax, 値; mov [rbp+disp], rax)
+    // floatの場合は、8バイトに同じ値を2つ並べて書き込む。
+    for (i = 0; i <= n; i++)
+    {
+        long long bits;
+        if (i == n)
+        {
+            bits = (long long)(is_float ? 0x8000000080000000ULL : 0x8000000000000000ULL);
+        }
+        else if ((program->instructions[i].opcode == op_const || program->instructions[i].opcode == op_param) && is_float)
+        {
+            float value = (float)get_constant_value(program, i);
+            unsigned int float_bits;
+            memcpy(&float_bits, &value, sizeof(float));
+            bits = (long long)((unsigned long long)float_bits << 32 | float_bits);
+        }
+        else if (program->instructions[i].opcode == op_const || program->instructions[i].opcode == op_param)
+        {
+            double value = get_constant_value(program, i);
+            memcpy(&bits, &value, sizeof(double));
+        }
+        else
+        {
+            continue;
+        }
+        int slot = i == n ? sign_slot : get_slot(i, slot_size);
+        for (k = 0; k < (lane_size + 7) / 8; k++)
+        {
+            emit_bytes(code, (const unsigned char[]){0x48, 0xb8}, 2);
+            emit_int64(code, bits);
+            emit_bytes(code, (const unsigned char[]){0x48, 0x89, 0x85}, 3);
+            emit_int32(code, slot + 8 * k);
+        }
+    }
+
+    int loop_start = code->size;
+    int exit_jump = 0;
+    if (kind != jit_scalar)
+    {
+        // cmp qword [rbp-24], 0; jle 終了
+        emit_bytes(code, (const unsigned char[]){0x48, 0x83, 0xbd}, 3);
+        emit_int32(code, -24);
+        emit_byte(code, 0x00);
+        emit_bytes(code, (const unsigned char[]){0x0f, 0x8e}, 2);
+        exit_jump = code->size;
+        emit_int32(code, 0);
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        Instruction *instruction = program->instructions + i;
+        int out = get_slot(i, slot_size);
+        int left = instruction->left < 0 ? 0 : get_slot(instruction->left, slot_size);
+        int right = instruction->right < 0 ? 0 : get_slot(instruction->right, slot_size);
+        unsigned char arithmetic = 0;
+        bool is_kernel = false;
+        switch (instruction->opcode)
+        {
+        case op_const:
+        case op_param:
+            break;
+        case op_x:
+            if (kind == jit_scalar)
+            {
+                emit_rbp_op(code, jit_scalar, 0x10, 0, -16);
+            }
+            else
+            {
+                // movupd xmm0, [rbx] (float, AVXの場合も同様)
+                emit_prefix(code, kind);
+                emit_bytes(code, (const unsigned char[]){0x10, 0x03}, 2);
+            }
+            emit_rbp_op(code, kind, 0x11, 0, out);
+            break;
+        case op_neg:
+            // 符号ビットを反転する。
+            emit_rbp_op(code, kind == jit_scalar ? jit_sse2 : kind, 0x10, 0, right);
+            emit_rbp_op(code, kind == jit_scalar ? jit_sse2 : kind, 0x57, 0, sign_slot);
+            emit_rbp_op(code, kind, 0x11, 0, out);
+            break;
+        case op_add:
+            arithmetic = 0x58;
+            break;
+        case op_sub:
+            arithmetic = 0x5c;
+            break;
+        case op_mul:
+            arithmetic = 0x59;
+            break;
+        case op_div:
+            arithmetic = 0x5e;
+            break;
+        case op_sin:
+        case op_cos:
+        case op_tan:
+        case op_log:
+        case op_pow:
+        case op_exp:
+        case op_powi:
+            is_kernel = true;
+            break;
+        }
+        if (arithmetic != 0)
+        {
+            emit_rbp_op(code, kind, 0x10, 0, left);
+            emit_rbp_op(code, kind, arithmetic, 0, right);
+            emit_rbp_op(code, kind, 0x11, 0, out);
+        }
+        if (is_kernel)
+        {
+            // 一括計算の関数にまとめて渡す。(AVXの上位ビットを先にクリアしておく)
+            if (kind == jit_avx || kind == jit_avx_float)
+            {
+                emit_bytes(code, (const unsigned char[]){0xc5, 0xf8, 0x77}, 3);
+            }
+            emit_kernel_call(code, program, instruction, kind, left, right, out);
+        }
+    }
+
+    emit_rbp_op(code, kind, 0x10, 0, get_slot(program->result, slot_size));
+    if (kind != jit_scalar)
+    {
+        // mov rax, [rbp-16]; 結果を[rax]に書き込む
+        emit_bytes(code, (const unsigned char[]){0x48, 0x8b, 0x85}, 3);
+        emit_int32(code, -16);
+        emit_prefix(code, kind);
+        emit_bytes(code, (const unsigned char[]){0x11, 0x00}, 2);
+        // add rbx, 大きさ; add qword [rbp-16], 大きさ; sub qword [rbp-24], 幅; jmp ループの先頭
+        emit_bytes(code, (const unsigned char[]){0x48, 0x83, 0xc3, (unsigned char)lane_size}, 4);
+        emit_bytes(code, (const unsigned char[]){0x48, 0x83, 0x85}, 3);
+        emit_int32(code, -16);
+        emit_byte(code, (unsigned char)lane_size);
+        emit_bytes(code, (const unsigned char[]){0x48, 0x83, 0xad}, 3);
+        emit_int32(code, -24);
+        emit_byte(code, (unsigned char)lane_count);
+        emit_byte(code, 0xe9);
+        emit_int32(code, loop_start - (code->size + 4));
+
+        // ループを抜けた先(jleの飛び先)
+        int exit_offset = code->size - (exit_jump + 4);
+        memcpy(code->bytes + exit_jump, &exit_offset, 4);
+        if (kind == jit_avx || kind == jit_avx_float)
+        {
+            emit_bytes(code, (const unsigned char[]){0xc5, 0xf8, 0x77}, 3);
+        }
+    }
+    // lea rsp, [rbp-8]; pop rbx; pop rbp; ret
+    emit_bytes(code, (const unsigned char[]){0x48, 0x8d, 0x65, 0xf8, 0x5b, 0x5d, 0xc3}, 7);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef JIT
+#define JIT
+#include "parser.h"
+#include "program.h"
+
+// プログラムから生成した機械語の関数
+typedef struct jit_function
+{
+    // xについて計算する関数。draw_graph_func()のfと同じ形なので、そのまま渡せる。(userdataは使わない)
+    double (*function)(double x, void *userdata);
+    // count個のxについて一括で計算し、ysに書き込む関数。(countは一括計算の幅の倍数であること)
+    void (*batch_function)(const double *xs, double *ys, long count);
+    // 一括計算の幅(一度に計算する値の数)
+    int batch_width;
+    // batch_functionのfloat版とその幅(グラフの描画用)
+    void (*batch_function_float)(const float *xs, float *ys, long count);
+    int batch_width_float;
+    // 機械語を置いている実行可能な領域
+    void *code;
+    long long code_size;
+} JitFunction;
+
+// プログラムをx86-64の機械語に変換する。(x86-64以外の環境や、大きすぎるプログラムの場合はNULLを返す)
+// パラメータはこの時点のprogram->parameterの値で固定される。
+JitFunction *compile_jit(Program *program);
+// count個のxについて一括で計算し、ysに書き込む。(一括計算の幅で割り切れない分も計算する)
+void run_jit(JitFunction *jit, const double *xs, double *ys, int count);
+// run_jit()のfloat版
+void run_jit_float(JitFunction *jit, const float *xs, float *ys, int count);
+// 機械語の領域を開放する。
+void dispose_jit(JitFunction *jit);
+
+#endif
\ No newline at end of file
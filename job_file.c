@@ -0,0 +1,791 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
+// ジョブファイルをメモリにマップできる環境か
+#if defined(__unix__) || defined(__APPLE__)
+#define USE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include "graph_writer.h"
+#include "graph_library.h"
+#include "parallel.h"
+#include "job_file.h"
+
+// マップできない場合に一度に読み込む大きさ[バイト]
+#define READ_CHUNK_SIZE (1 << 20)
+// 読み込みながら描画する時に、一度にまとめて描画する画像の数
+#define JOB_CHUNK_SIZE 64
+// コンパイル済みの式をこの数より多く持っている場合は、描画の区切りで開放する。(メモリと機械語の領域が増え続けないように)
+#define MAX_CACHED_EXPRESSIONS 4096
+// 式の行の項目の最大数(式, 色RGB, パラメータの範囲, 最後の色RGB)
+#define MAX_FIELD_COUNT 8
+// この出力ファイル名の画像は、ファイルではなく標準出力に書き出す。
+#define STDOUT_OUTPUT_NAME "-"
+
+struct job_reader
+{
+    // マップした領域(マップできなかった場合はNULL)
+    const char *map;
+    long long map_size;
+    // 塊ごとに読み込む場合のファイルと、読み込んだデータの領域
+    FILE *fp;
+    char *buffer;
+    long long buffer_capacity;
+    long long buffer_length;
+    // 次に読む位置(mapまたはbufferの先頭から)
+    long long position;
+};
+
+// 画像に描画する1つのグラフ
+typedef struct job_graph
+{
+    // コンパイル済みの式の番号(パラメータの族と陰関数の場合は-1)
+    int expression_index;
+    // パラメータの族と陰関数の場合の式と、パラメータの範囲(陰関数の場合はfamily.countが0)
+    char *expression;
+    GraphFamily family;
+    Pixel color;
+} JobGraph;
+
+// 1つの出力画像
+typedef struct job_image
+{
+    // 出力ファイル名(拡張子.bmpは付けない)
+    char *output;
+    // 標準出力に書き出す画像の、描画し終えたコンテキスト(書き出す順番を守るため、描画が全部終わるまで持っておく)
+    GraphContext *streamed_context;
+    // 描画するグラフ(書かれた順に描画する)
+    JobGraph *graphs;
+    int graph_count;
+    int graph_capacity;
+} JobImage;
+
+// すべてのジョブファイルの画像と、それらで共有するコンパイル済みの式
+typedef struct job_set
+{
+    JobImage *images;
+    int image_count;
+    int image_capacity;
+    // 式の文字列と、それをコンパイルしたもの(compiled_count番目以降はまだコンパイルしていない)
+    char **expressions;
+    GraphExpression **compiled;
+    int expression_count;
+    int expression_capacity;
+    int compiled_count;
+    // 同じ式を探すためのハッシュ表(空きは-1)
+    int *lookup;
+    int lookup_capacity;
+    Accuracy accuracy;
+    int worker_count;
+    // コンパイルした式を保存するキャッシュ(使わない場合はNULL)
+    ExpressionCache *cache;
+    // 出力した画像の数と、これまでに登録した式の種類の数(開放した式も含む)
+    int output_count;
+    int interned_count;
+} JobSet;
+
+// 読み込んだデータの中から次の行を探す。(塊ごとに読み込む場合は、足りなければ続きを読み込む)
+bool read_buffered_line(JobReader *reader, const char **line, int *length);
+// 行を空白で区切った項目の先頭と長さを求め、項目の数を返す。
+int split_fields(const char *line, int length, const char **fields, int *lengths, int max_count);
+// 0から255の整数の項目を読み取る。(数字でなければfalse)
+bool parse_byte_field(const char *field, int length, unsigned char *value);
+// ジョブファイルを読み込みながら、画像を追加して描画する。(開けなければfalse)
+bool load_job_file(JobSet *jobs, const char *path);
+// ディレクトリ内の.txtファイルを名前順にすべて読み込む。読み込めなかったファイルの数を返す。
+int load_job_directory(JobSet *jobs, const char *path);
+// 読み込んだ画像をすべて描画して出力し、開放する。
+void flush_jobs(JobSet *jobs);
+// コンパイル済みの式をすべて開放する。
+void clear_expressions(JobSet *jobs);
+// 出力画像を追加する。
+JobImage *add_job_image(JobSet *jobs, const char *output);
+// 画像にグラフを追加する。
+void add_job_graph(JobSet *jobs, JobImage *image, GraphLine *graph_line);
+// 式の番号を返す。(初めての式なら登録する)
+int intern_expression(JobSet *jobs, const char *expression, int length);
+// 文字列のハッシュ値を求める。
+unsigned int hash_string(const char *text, int length);
+// ハッシュ表に式の番号を登録する。
+void insert_expression_lookup(JobSet *jobs, int index);
+// index番目の式をコンパイルする。(parallel_for()用)
+void compile_job_expression(int index, void *context);
+// index番目の画像を描画して出力する。(parallel_for()用)
+void render_job_image(int index, void *context);
+// 文字列の先頭からlength文字を、新しく確保した領域にnull文字で終わる文字列としてコピーする。
+char *copy_string(const char *text, int length);
+// qsort()用に文字列を比較する。
+int compare_strings(const void *a, const void *b);
+
+JobReader *open_job_reader(const char *path)
+{
+    JobReader *reader = (JobReader *)calloc(1, sizeof(JobReader));
+    if (reader == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+#ifdef USE_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        free(reader);
+        return NULL;
+    }
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_size > 0)
+    {
+        void *map = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            // 先頭から順に一度だけ読むことをOSに伝え、先読みさせる。
+            madvise(map, status.st_size, MADV_SEQUENTIAL);
+            close(fd);
+            reader->map = (const char *)map;
+            reader->map_size = status.st_size;
+            return reader;
+        }
+    }
+    close(fd);
+#endif
+    // マップできない場合(空のファイルを含む)は、塊ごとに読み込む。
+    reader->fp = fopen(path, "rb");
+    if (reader->fp == NULL)
+    {
+        free(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+bool read_job_line(JobReader *reader, const char **line, int *length)
+{
+    if (reader->map == NULL)
+    {
+        return read_buffered_line(reader, line, length);
+    }
+    if (reader->position >= reader->map_size)
+    {
+        return false;
+    }
+    const char *start = reader->map + reader->position;
+    long long rest = reader->map_size - reader->position;
+    const char *newline = (const char *)memchr(start, '\n', rest);
+    long long line_length = newline == NULL ? rest : newline - start;
+    reader->position += newline == NULL ? rest : line_length + 1;
+    // CRLFの改行にも対応する。
+    if (line_length > 0 && start[line_length - 1] == '\r')
+    {
+        line_length--;
+    }
+    *line = start;
+    *length = (int)line_length;
+    return true;
+}
+
+// bufferのposition以降に、まだ返していないデータがある。
+bool read_buffered_line(JobReader *reader, const char **line, int *length)
+{
+    long long searched = 0;
+    while (1)
+    {
+        char *start = reader->buffer + reader->position;
+        long long rest = reader->buffer_length - reader->position;
+        char *newline = rest > searched ? (char *)memchr(start + searched, '\n', rest - searched) : NULL;
+        bool is_end = feof(reader->fp) || ferror(reader->fp);
+        if (newline != NULL || (is_end && rest > 0))
+        {
+            long long line_length = newline == NULL ? rest : newline - start;
+            reader->position += newline == NULL ? rest : line_length + 1;
+            if (line_length > 0 && start[line_length - 1] == '\r')
+            {
+                line_length--;
+            }
+            *line = start;
+            *length = (int)line_length;
+            return true;
+        }
+        if (is_end)
+        {
+            return false;
+        }
+        // 行の途中までしか読み込んでいないので、残りを先頭に詰めてから続きを読み込む。(足りなければ領域を広げる)
+        searched = rest;
+        memmove(reader->buffer, start, rest);
+        reader->position = 0;
+        reader->buffer_length = rest;
+        if (reader->buffer_capacity - rest < READ_CHUNK_SIZE)
+        {
+            long long capacity = reader->buffer_capacity == 0 ? READ_CHUNK_SIZE : reader->buffer_capacity * 2;
+            char *buffer = (char *)realloc(reader->buffer, capacity);
+            if (buffer == NULL)
+            {
+                perror("メモリ確保エラー");
+                exit(-1);
+            }
+            reader->buffer = buffer;
+            reader->buffer_capacity = capacity;
+        }
+        reader->buffer_length += fread(reader->buffer + rest, 1, reader->buffer_capacity - rest, reader->fp);
+    }
+}
+
+void close_job_reader(JobReader *reader)
+{
+#ifdef USE_MMAP
+    if (reader->map != NULL)
+    {
+        munmap((void *)reader->map, reader->map_size);
+    }
+#endif
+    if (reader->fp != NULL)
+    {
+        fclose(reader->fp);
+    }
+    free(reader->buffer);
+    free(reader);
+}
+
+// 色を省略した場合は黒、最後のグラフの色を省略した場合は最初のグラフと同じ色にする。
+// 数値として読めない項目があれば、それ以降の項目は省略したものとして扱う。
+bool parse_graph_line(const char *line, int length, GraphLine *graph_line)
+{
+    const char *fields[MAX_FIELD_COUNT];
+    int lengths[MAX_FIELD_COUNT];
+    int field_count = split_fields(line, length, fields, lengths, MAX_FIELD_COUNT);
+    if (field_count < 1)
+    {
+        return false;
+    }
+    graph_line->expression = fields[0];
+    graph_line->expression_length = lengths[0];
+    Pixel *color = &graph_line->color;
+    GraphFamily *family = &graph_line->family;
+    family->parameter_name = graph_line->parameter_name;
+    color->R = 0;
+    color->G = 0;
+    color->B = 0;
+    int n = 1;
+    if (n < field_count && parse_byte_field(fields[n], lengths[n], &color->R))
+    {
+        n++;
+    }
+    if (n == 2 && n < field_count && parse_byte_field(fields[n], lengths[n], &color->G))
+    {
+        n++;
+    }
+    if (n == 3 && n < field_count && parse_byte_field(fields[n], lengths[n], &color->B))
+    {
+        n++;
+    }
+    family->count = 0;
+    family->start_color = *color;
+    family->end_color = *color;
+    if (n < 4 || field_count < 5)
+    {
+        return true;
+    }
+    // パラメータの範囲は「名前=最初の値:最後の値:グラフの数」と書く。(数値の読み取りのために短い領域にコピーする)
+    char range[64];
+    int range_length = lengths[4] < (int)sizeof(range) - 1 ? lengths[4] : (int)sizeof(range) - 1;
+    memcpy(range, fields[4], range_length);
+    range[range_length] = '\0';
+    if (sscanf(range, "%31[^=]=%lf:%lf:%d", family->parameter_name, &family->start, &family->end, &family->count) != 4 || family->count < 1)
+    {
+        fprintf(stderr, "パラメータの範囲の書式が正しくありません。(%s)\n", range);
+        family->count = 0;
+        return true;
+    }
+    Pixel end_color;
+    if (field_count >= 8 && parse_byte_field(fields[5], lengths[5], &end_color.R) &&
+        parse_byte_field(fields[6], lengths[6], &end_color.G) && parse_byte_field(fields[7], lengths[7], &end_color.B))
+    {
+        family->end_color = end_color;
+    }
+    return true;
+}
+
+// 空行(1行目の出力ファイル名の後の改行を含む)は読み飛ばす。
+bool read_graph_line(JobReader *reader, GraphLine *graph_line)
+{
+    const char *line;
+    int length;
+    while (read_job_line(reader, &line, &length))
+    {
+        if (parse_graph_line(line, length, graph_line))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int split_fields(const char *line, int length, const char **fields, int *lengths, int max_count)
+{
+    int count = 0;
+    int i = 0;
+    while (count < max_count)
+    {
+        while (i < length && isspace((unsigned char)line[i]))
+        {
+            i++;
+        }
+        if (i >= length)
+        {
+            break;
+        }
+        int start = i;
+        while (i < length && !isspace((unsigned char)line[i]))
+        {
+            i++;
+        }
+        fields[count] = line + start;
+        lengths[count] = i - start;
+        count++;
+    }
+    return count;
+}
+
+// scanf()の%hhuと同じく、256以上の値は下位8ビットにする。
+bool parse_byte_field(const char *field, int length, unsigned char *value)
+{
+    unsigned int result = 0;
+    int i;
+    for (i = 0; i < length; i++)
+    {
+        if (!isdigit((unsigned char)field[i]))
+        {
+            return false;
+        }
+        result = result * 10 + (field[i] - '0');
+    }
+    *value = (unsigned char)result;
+    return true;
+}
+
+// ファイルを読み込みながらJOB_CHUNK_SIZE枚ごとに描画し、すべて読み終えたら残りを描画する。
+int run_job_files(char **paths, int path_count, int worker_count, Accuracy accuracy, const char *cache_directory)
+{
+    JobSet jobs;
+    memset(&jobs, 0, sizeof(JobSet));
+    jobs.accuracy = accuracy;
+    jobs.worker_count = worker_count;
+    if (cache_directory != NULL)
+    {
+        jobs.cache = open_expression_cache(cache_directory);
+        if (jobs.cache == NULL)
+        {
+            perror("キャッシュのディレクトリを作れませんでした。\n");
+            fprintf(stderr, "ディレクトリ名: %s\n", cache_directory);
+        }
+    }
+    int failure_count = 0;
+    int i;
+    for (i = 0; i < path_count; i++)
+    {
+        struct stat status;
+        if (stat(paths[i], &status) == 0 && S_ISDIR(status.st_mode))
+        {
+            failure_count += load_job_directory(&jobs, paths[i]);
+        }
+        else if (!load_job_file(&jobs, paths[i]))
+        {
+            failure_count++;
+        }
+    }
+    flush_jobs(&jobs);
+    fprintf(stderr, "%d枚の画像を出力しました。(式の種類: %d)\n", jobs.output_count, jobs.interned_count);
+    if (jobs.cache != NULL)
+    {
+        int load_count, store_count;
+        get_expression_cache_counts(jobs.cache, &load_count, &store_count);
+        fprintf(stderr, "キャッシュから%d個の式を読み込み、%d個の式を保存しました。\n", load_count, store_count);
+        close_expression_cache(jobs.cache);
+    }
+    clear_expressions(&jobs);
+    free(jobs.images);
+    free(jobs.expressions);
+    free(jobs.compiled);
+    free(jobs.lookup);
+    return failure_count;
+}
+
+// 最初の空でない行は出力ファイル名(graphs.txtと同じ)。以降は「>出力ファイル名」の行で次の画像に切り替える。
+bool load_job_file(JobSet *jobs, const char *path)
+{
+    JobReader *reader = open_job_reader(path);
+    if (reader == NULL)
+    {
+        perror("ファイルを開けませんでした。\n");
+        fprintf(stderr, "ファイル名: %s\n", path);
+        return false;
+    }
+    const char *line;
+    int length;
+    GraphLine graph_line;
+    bool has_image = false;
+    while (read_job_line(reader, &line, &length))
+    {
+        const char *start = line;
+        const char *end = line + length;
+        while (start < end && isspace((unsigned char)*start))
+        {
+            start++;
+        }
+        if (start == end)
+        {
+            continue;
+        }
+        if (*start == '>' || !has_image)
+        {
+            // 前の画像まではすべて読み終えているので、溜まっていれば描画する。
+            if (jobs->image_count >= JOB_CHUNK_SIZE)
+            {
+                flush_jobs(jobs);
+            }
+            if (*start == '>')
+            {
+                start++;
+            }
+            // 出力ファイル名は空白を含められるように、前後の空白だけを除く。
+            while (start < end && isspace((unsigned char)*start))
+            {
+                start++;
+            }
+            while (end > start && isspace((unsigned char)*(end - 1)))
+            {
+                end--;
+            }
+            char *output = copy_string(start, end - start);
+            add_job_image(jobs, output);
+            free(output);
+            has_image = true;
+            continue;
+        }
+        if (parse_graph_line(start, end - start, &graph_line))
+        {
+            add_job_graph(jobs, jobs->images + jobs->image_count - 1, &graph_line);
+        }
+    }
+    close_job_reader(reader);
+    return true;
+}
+
+int load_job_directory(JobSet *jobs, const char *path)
+{
+    DIR *directory = opendir(path);
+    if (directory == NULL)
+    {
+        perror("ディレクトリを開けませんでした。\n");
+        fprintf(stderr, "ディレクトリ名: %s\n", path);
+        return 1;
+    }
+    char **names = NULL;
+    int count = 0, capacity = 0, i;
+    struct dirent *entry;
+    while ((entry = readdir(directory)) != NULL)
+    {
+        size_t length = strlen(entry->d_name);
+        if (length < 4 || strcmp(entry->d_name + length - 4, ".txt") != 0)
+        {
+            continue;
+        }
+        if (count == capacity)
+        {
+            capacity = capacity == 0 ? 16 : capacity * 2;
+            names = (char **)realloc(names, sizeof(char *) * capacity);
+            if (names == NULL)
+            {
+                perror("メモリ確保エラー");
+                exit(-1);
+            }
+        }
+        names[count] = (char *)malloc(strlen(path) + length + 2);
+        if (names[count] == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        sprintf(names[count], "%s/%s", path, entry->d_name);
+        count++;
+    }
+    closedir(directory);
+    // 出力の順番が実行ごとに変わらないように、名前順にする。
+    qsort(names, count, sizeof(char *), compare_strings);
+    int failure_count = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (!load_job_file(jobs, names[i]))
+        {
+            failure_count++;
+        }
+        free(names[i]);
+    }
+    free(names);
+    return failure_count;
+}
+
+JobImage *add_job_image(JobSet *jobs, const char *output)
+{
+    // 足りなくなったら倍の大きさにする。
+    if (jobs->image_count == jobs->image_capacity)
+    {
+        int capacity = jobs->image_capacity == 0 ? 16 : jobs->image_capacity * 2;
+        JobImage *images = (JobImage *)realloc(jobs->images, sizeof(JobImage) * capacity);
+        if (images == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        jobs->images = images;
+        jobs->image_capacity = capacity;
+    }
+    JobImage *image = jobs->images + jobs->image_count++;
+    image->output = copy_string(output, strlen(output));
+    image->streamed_context = NULL;
+    image->graphs = NULL;
+    image->graph_count = 0;
+    image->graph_capacity = 0;
+    return image;
+}
+
+void add_job_graph(JobSet *jobs, JobImage *image, GraphLine *graph_line)
+{
+    if (image->graph_count == image->graph_capacity)
+    {
+        int capacity = image->graph_capacity == 0 ? 8 : image->graph_capacity * 2;
+        JobGraph *graphs = (JobGraph *)realloc(image->graphs, sizeof(JobGraph) * capacity);
+        if (graphs == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        image->graphs = graphs;
+        image->graph_capacity = capacity;
+    }
+    JobGraph *graph = image->graphs + image->graph_count++;
+    graph->color = graph_line->color;
+    graph->family = graph_line->family;
+    // パラメータの族はパラメータの値ごとに、陰関数はxとyの格子で計算するので、共有するコンパイル済みの式は使わない。
+    if (graph_line->family.count > 0)
+    {
+        graph->expression_index = -1;
+        graph->expression = copy_string(graph_line->expression, graph_line->expression_length);
+        graph->family.parameter_name = copy_string(graph_line->parameter_name, strlen(graph_line->parameter_name));
+    }
+    else if (memchr(graph_line->expression, '=', graph_line->expression_length) != NULL)
+    {
+        graph->expression_index = -1;
+        graph->expression = copy_string(graph_line->expression, graph_line->expression_length);
+        graph->family.parameter_name = NULL;
+    }
+    else
+    {
+        graph->expression_index = intern_expression(jobs, graph_line->expression, graph_line->expression_length);
+        graph->expression = NULL;
+        graph->family.parameter_name = NULL;
+    }
+}
+
+// 式は読み込んだ行の一部(null文字で終わらない)なので、長さを指定して比較する。
+int intern_expression(JobSet *jobs, const char *expression, int length)
+{
+    unsigned int mask = jobs->lookup_capacity - 1;
+    unsigned int slot = hash_string(expression, length) & mask;
+    while (jobs->lookup_capacity > 0 && jobs->lookup[slot] >= 0)
+    {
+        const char *candidate = jobs->expressions[jobs->lookup[slot]];
+        if (strncmp(candidate, expression, length) == 0 && candidate[length] == '\0')
+        {
+            return jobs->lookup[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (jobs->expression_count == jobs->expression_capacity)
+    {
+        int capacity = jobs->expression_capacity == 0 ? 16 : jobs->expression_capacity * 2;
+        char **expressions = (char **)realloc(jobs->expressions, sizeof(char *) * capacity);
+        GraphExpression **compiled = (GraphExpression **)realloc(jobs->compiled, sizeof(GraphExpression *) * capacity);
+        if (expressions == NULL || compiled == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        jobs->expressions = expressions;
+        jobs->compiled = compiled;
+        jobs->expression_capacity = capacity;
+    }
+    jobs->expressions[jobs->expression_count] = copy_string(expression, length);
+    jobs->compiled[jobs->expression_count] = NULL;
+    insert_expression_lookup(jobs, jobs->expression_count);
+    jobs->interned_count++;
+    return jobs->expression_count++;
+}
+
+unsigned int hash_string(const char *text, int length)
+{
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    int i;
+    for (i = 0; i < length; i++)
+    {
+        hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// 使用率が半分を超えたら、倍の大きさにして登録し直す。
+void insert_expression_lookup(JobSet *jobs, int index)
+{
+    int i;
+    if ((index + 1) * 2 > jobs->lookup_capacity)
+    {
+        int capacity = jobs->lookup_capacity == 0 ? 64 : jobs->lookup_capacity * 2;
+        int *lookup = (int *)malloc(sizeof(int) * capacity);
+        if (lookup == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        for (i = 0; i < capacity; i++)
+        {
+            lookup[i] = -1;
+        }
+        free(jobs->lookup);
+        jobs->lookup = lookup;
+        jobs->lookup_capacity = capacity;
+        for (i = 0; i < index; i++)
+        {
+            insert_expression_lookup(jobs, i);
+        }
+    }
+    unsigned int mask = jobs->lookup_capacity - 1;
+    unsigned int slot = hash_string(jobs->expressions[index], strlen(jobs->expressions[index])) & mask;
+    while (jobs->lookup[slot] >= 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    jobs->lookup[slot] = index;
+}
+
+// indexは、まだコンパイルしていない式の中での番号
+void compile_job_expression(int index, void *context)
+{
+    JobSet *jobs = (JobSet *)context;
+    index += jobs->compiled_count;
+    jobs->compiled[index] = compile_graph_expression_cached(jobs->expressions[index], jobs->accuracy, jobs->cache);
+}
+
+// 画像ごとにコンテキストを作るので、スレッド間で共有するのはコンパイル済みの式だけ。
+void render_job_image(int index, void *context)
+{
+    JobSet *jobs = (JobSet *)context;
+    JobImage *image = jobs->images + index;
+    GraphContext *graph_context = create_graph_context();
+    set_graph_context_accuracy(graph_context, jobs->accuracy);
+    render_axis(graph_context);
+    int i;
+    for (i = 0; i < image->graph_count; i++)
+    {
+        JobGraph *graph = image->graphs + i;
+        if (graph->expression_index < 0 && graph->family.count > 0)
+        {
+            render_graph_family(graph_context, &graph->family, graph->expression);
+        }
+        else if (graph->expression_index < 0)
+        {
+            render_graph_implicit(graph_context, graph->color, graph->expression);
+        }
+        else
+        {
+            render_graph_expression(graph_context, jobs->compiled[graph->expression_index], graph->color);
+        }
+    }
+    if (strcmp(image->output, STDOUT_OUTPUT_NAME) == 0)
+    {
+        image->streamed_context = graph_context;
+        return;
+    }
+    export_graph_context(graph_context, image->output);
+    dispose_graph_context(graph_context);
+}
+
+// コンパイル済みの式は描画中に書き換えないので、すべてのスレッドで共有できる。
+void flush_jobs(JobSet *jobs)
+{
+    int i, j;
+    parallel_for(jobs->expression_count - jobs->compiled_count, compile_job_expression, jobs, jobs->worker_count);
+    jobs->compiled_count = jobs->expression_count;
+    parallel_for(jobs->image_count, render_job_image, jobs, jobs->worker_count);
+    jobs->output_count += jobs->image_count;
+    for (i = 0; i < jobs->image_count; i++)
+    {
+        JobImage *image = jobs->images + i;
+        // 標準出力に書き出す画像は、ジョブファイルに書かれた順に続けて書き出す。
+        if (image->streamed_context != NULL)
+        {
+            fflush(stdout);
+            if (!export_graph_context_to_fd(image->streamed_context, fileno(stdout)))
+            {
+                perror("標準出力に書き込めませんでした。\n");
+            }
+            dispose_graph_context(image->streamed_context);
+        }
+        for (j = 0; j < image->graph_count; j++)
+        {
+            free(image->graphs[j].expression);
+            free(image->graphs[j].family.parameter_name);
+        }
+        free(image->graphs);
+        free(image->output);
+    }
+    jobs->image_count = 0;
+    // 次の画像で同じ式が使われることが多いので、多くなりすぎるまでは残しておく。
+    if (jobs->expression_count > MAX_CACHED_EXPRESSIONS)
+    {
+        clear_expressions(jobs);
+    }
+}
+
+void clear_expressions(JobSet *jobs)
+{
+    int i;
+    for (i = 0; i < jobs->expression_count; i++)
+    {
+        free(jobs->expressions[i]);
+        if (jobs->compiled[i] != NULL)
+        {
+            dispose_graph_expression(jobs->compiled[i]);
+        }
+    }
+    jobs->expression_count = 0;
+    jobs->compiled_count = 0;
+    for (i = 0; i < jobs->lookup_capacity; i++)
+    {
+        jobs->lookup[i] = -1;
+    }
+}
+
+char *copy_string(const char *text, int length)
+{
+    char *copy = (char *)malloc(length + 1);
+    if (copy == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+int compare_strings(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef JOB_FILE
+#define JOB_FILE
+#include <stdbool.h>
+#include "graph_writer.h"
+#include "fast_math.h"
+
+// ジョブファイル(graphs.txtなど)を1行ずつ読む読み込み器
+// ファイル全体をメモリにマップし、行をコピーせずに返す。マップできない場合は大きな塊ごとに読み込む。(どちらも行の長さに上限はない)
+typedef struct job_reader JobReader;
+
+// graphs.txtの式の行(式, 色, 省略可能なパラメータの範囲と最後のグラフの色)を解析したもの
+// family.parameter_nameは構造体の中を指すので、構造体ごとコピーした場合は付け替えること。
+typedef struct graph_line
+{
+    // 式(読み込んだ行の中を指す。null文字で終わっていないので、長さと合わせて使う)
+    const char *expression;
+    int expression_length;
+    // 色(省略した場合は黒)
+    Pixel color;
+    // パラメータの範囲(パラメータの族でなければfamily.countは0)
+    GraphFamily family;
+    char parameter_name[32];
+} GraphLine;
+
+// ファイルを開いて読み込み器を生成する。(開けなければNULL)
+JobReader *open_job_reader(const char *path);
+// 次の行の先頭と長さ(改行を含まない)を返す。(ファイルの終わりならfalse)
+// 行は読み込み器の領域を指し、次にread_job_line()を呼ぶまで有効。
+bool read_job_line(JobReader *reader, const char **line, int *length);
+// 読み込み器を開放し、ファイルを閉じる。
+void close_job_reader(JobReader *reader);
+
+// 式の行を解析する。(空行ならfalse)
+bool parse_graph_line(const char *line, int length, GraphLine *graph_line);
+// 次の空でない行を、式の行として読み込む。(ファイルの終わりならfalse)
+bool read_graph_line(JobReader *reader, GraphLine *graph_line);
+
+// ジョブファイル(またはディレクトリ内の.txtファイルすべて)に書かれた画像を、worker_count個のスレッドで並列に出力する。
+// ジョブファイルはgraphs.txtと同じ形式で、「>出力ファイル名」の行から次の画像の記述になる。
+// 出力ファイル名が「-」の画像は、ファイルを作らずに標準出力に書き出す。(複数あれば書かれた順に続けて書き出す)
+// 標準出力の画像を壊さないように、メッセージはすべて標準エラー出力に表示する。
+// 読み込みながら一定数の画像ごとに描画するので、大きなジョブファイルでも読み終わる前に出力が始まる。
+// 同じ式は、すべてのジョブファイルを通して1回だけコンパイルする。(種類が多すぎる場合は途中で開放する。worker_countが0以下の場合はCPUの数)
+// cache_directoryがNULLでなければ、コンパイルした式をそのディレクトリに保存し、次回からは保存したものを読み込む。
+// 読み込めなかったファイルの数を返す。
+int run_job_files(char **paths, int path_count, int worker_count, Accuracy accuracy, const char *cache_directory);
+
+#endif
\ No newline at end of file
@@ -4,6 +4,25 @@
 #include <stdbool.h>
 #include <ctype.h>
 #include "lexer.h"
+#include "parallel.h"
+// 文字数がこれ以上の式は、複数の塊に分けて別々のスレッドで字句解析する。
+#define PARALLEL_LEX_MIN_LENGTH (1 << 16)
+// 1つの塊の最小の文字数
+#define MIN_LEX_CHUNK_LENGTH (1 << 14)
+// スレッドあたりの塊の数の目安
+#define LEX_CHUNKS_PER_THREAD 4
+
+// 字句解析する塊(区切りは演算子か括弧の直前にする)
+typedef struct lex_chunk
+{
+    const char *start;
+    int length;
+    // 式の最後の塊ならtrue
+    bool is_last;
+    // 字句解析したトークンの列の最初と最後
+    Token *first;
+    Token *last;
+} LexChunk;
 
 // 与えた文字列とトークンの種類でトークンを生成する。
 Token *create_token(StringInfo *info, TokenType type);
@@ -13,11 +32,106 @@ void dispose_token(Token *token);
 bool is_other_char(char current);
 // 演算子以外の文字列からトークンの種類を取得する
 TokenType get_token_type_for_other(char *literal);
+// 塊を字句解析し、トークンの列の先頭を返して最後のトークンをlastに書き込む。
+// is_lastがfalseなら、塊の後ろに演算子が続くものとして最後のトークンを作る。
+Token *lexical_chunk(const char *expression, int length, bool is_last, Token **last);
+// index番目の塊を字句解析する。(contextはLexChunkの配列)
+void lex_chunk_task(int index, void *context);
+// 演算子か括弧の文字かを判定する
+bool is_chunk_boundary(char current);
 
 // 字句解析を行う。
-Token *lexical(char *expression)
+Token *lexical(const char *expression)
+{
+    return lexical_range(expression, strlen(expression));
+}
+
+// 演算子と括弧の文字はその前の文字列や数字を区切るので、その直前で分けた塊は独立に字句解析できる。
+// 塊の境目では、単項演算子の判定(前のトークンが二項演算子か)だけをつないだ後に直す。
+// 終端の判定は文字数で行うので、expressionはnull文字で終わっていなくてもよい。
+Token *lexical_range(const char *expression, int length)
+{
+    Token *last;
+    if (length < PARALLEL_LEX_MIN_LENGTH)
+    {
+        return lexical_chunk(expression, length, true, &last);
+    }
+    int chunk_count = get_cpu_count() * LEX_CHUNKS_PER_THREAD;
+    if (chunk_count > length / MIN_LEX_CHUNK_LENGTH)
+    {
+        chunk_count = length / MIN_LEX_CHUNK_LENGTH;
+    }
+    LexChunk *chunks = (LexChunk *)malloc(sizeof(LexChunk) * chunk_count);
+    if (chunks == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    // 等分した位置から、次の演算子か括弧の文字まで区切りをずらす。(見つからなければ残りを1つの塊にする)
+    int count = 0;
+    int begin = 0;
+    int i;
+    for (i = 1; i <= chunk_count && begin < length; i++)
+    {
+        int boundary = (int)((long long)length * i / chunk_count);
+        if (boundary <= begin)
+        {
+            continue;
+        }
+        while (boundary < length && !is_chunk_boundary(expression[boundary]))
+        {
+            boundary++;
+        }
+        chunks[count].start = expression + begin;
+        chunks[count].length = boundary - begin;
+        chunks[count].is_last = boundary == length;
+        count++;
+        begin = boundary;
+    }
+    parallel_for(count, lex_chunk_task, chunks, 0);
+
+    // 塊のトークンの列をつなぐ。
+    for (i = 1; i < count; i++)
+    {
+        Token *first = chunks[i].first;
+        Token *previous = chunks[i - 1].last;
+        previous->next = first;
+        first->prev = previous;
+        // 塊の先頭の'-'は前のトークンが分からないので二項演算子になっている。
+        // 前のトークンが二項演算子なら単項演算子に直し、続く'-'も前のトークンの種類が変わったので判定し直す。
+        Token *token = first;
+        while (token != NULL && *token->data == '-')
+        {
+            bool is_unary = token->prev->type == bin_ope_plus_minus || token->prev->type == bin_ope_times_div;
+            TokenType type = is_unary ? unary_ope : bin_ope_plus_minus;
+            if (token->type == type)
+            {
+                break;
+            }
+            token->type = type;
+            token = token->next;
+        }
+    }
+    Token *start = chunks[0].first;
+    free(chunks);
+    return start;
+}
+
+void lex_chunk_task(int index, void *context)
 {
-    char *current = expression;
+    LexChunk *chunk = (LexChunk *)context + index;
+    chunk->first = lexical_chunk(chunk->start, chunk->length, chunk->is_last, &chunk->last);
+}
+
+bool is_chunk_boundary(char current)
+{
+    return current == '+' || current == '-' || current == '*' || current == '/' || current == '^' || current == '(' || current == ')';
+}
+
+Token *lexical_chunk(const char *expression, int length, bool is_last, Token **last)
+{
+    const char *current = expression;
+    const char *end = expression + length;
     // 文字列生成用変数
     StringInfo string_info = {"", 0};
     // トークンのリスト(ダミーノードで初期化)
@@ -29,7 +143,7 @@ Token *lexical(char *expression)
     bool is_during_other_str = false;
     bool is_diring_num = false;
 
-    while (*current != '\0')
+    while (current < end)
     {
         Token *token = NULL;
 
@@ -110,7 +224,7 @@ Token *lexical(char *expression)
             continue;
         }
         // 円周率の場合
-        else if (*current == 'p' && *(current + 1) == 'i')
+        else if (*current == 'p' && current + 1 < end && *(current + 1) == 'i')
         {
             string_info.start = current;
             string_info.length = 2;
@@ -155,13 +269,21 @@ Token *lexical(char *expression)
     {
         token_list->next = create_token(&string_info, variable);
         token_list->next->prev = token_list; // 次の前は現在
+        // 後ろに演算子が続く場合は、途中で区切った場合と同じく関数名かを判定する。
+        if (!is_last)
+        {
+            token_list->next->type = get_token_type_for_other(token_list->next->data);
+        }
+        token_list = token_list->next;
     }
     // 数字の入力中だった場合はnextに追加する。
-    else if (is_diring_num && !isdigit(*current))
+    else if (is_diring_num)
     {
         token_list->next = create_token(&string_info, num);
         token_list->next->prev = token_list;
+        token_list = token_list->next;
     }
+    *last = token_list;
     // リストの先頭
     Token *start = token_start->next;
     start->prev = NULL;
@@ -207,7 +329,7 @@ TokenType get_token_type_for_other(char *literal)
 
 Token *create_token(StringInfo *info, TokenType type)
 {
-    char *current = info->start;
+    const char *current = info->start;
     int i;
     char *other_str = (char *)calloc(info->length + 1, sizeof(char));
 
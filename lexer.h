@@ -35,11 +35,13 @@ typedef struct token
 
 typedef struct
 {
-    char *start;
+    const char *start;
     int length;
 } StringInfo;
 
-Token *lexical(char *expression);
+Token *lexical(const char *expression);
+// expressionの先頭からlength文字を字句解析する。
+Token *lexical_range(const char *expression, int length);
 void dispose_all_tokens(Token *root);
 void dispose_token(Token *token);
 Token *remove_token(Token *root, Token *target);
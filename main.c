@@ -1,39 +1,131 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
 #include <math.h>
 #include <time.h>
+#include <ctype.h>
 #define MAX_ITER_COUNT 100
+// ニュートン法で書き出し待ちにできる画像の数
+#define EXPORT_QUEUE_SIZE 2
+// グラフ描画モードで一度に描画する行数(画像の大きさに関わらず、使用メモリはこの行数分になる)
+#define STRIP_HEIGHT 64
+// 収束先の分布を調べる時の初期値の数
+#define START_COUNT 1000000
+// 収束先の分布を調べる時に区別する解の最大数
+#define MAX_ROOT_COUNT 64
+// 計算速度の比較で、1つの式あたりに計算する点の数
+#define BENCHMARK_POINT_COUNT 1000000
+// graphs.txtの式のグラフを一度にまとめて描画する最大の数(これだけ読み込んだら、続きを読む前に描画する)
+#define MAX_BATCH_EXPRESSIONS 64
+// 回帰チェックの基準ファイルの既定の名前と、既定で許容する遅れ[%]
+#define DEFAULT_BASELINE_NAME "regression_baseline.txt"
+// 回帰チェックの画像のハッシュ値の基準ファイル(リポジトリに含める)
+#define GOLDEN_HASH_NAME "regression_golden.txt"
+#define DEFAULT_CHECK_THRESHOLD 30
 #include "graph_writer.h"
 #include "parser.h"
 #include "lexer.h"
 #include "calclator.h"
+#include "export_queue.h"
+#include "program.h"
+#include "newton_solver.h"
+#include "jit.h"
+#include "job_file.h"
+#include "polynomial.h"
+#include "root_finder.h"
+#include "curve_analysis.h"
+#include "implicit_curve.h"
+#include "regression_check.h"
 
 typedef enum mode
 {
     newton,
     draw_graph_mode,
+    draw_graph_mapped_mode,
+    newton_basins_mode,
+    benchmark_mode,
+    curve_features_mode,
+    progressive_mode,
 } Mode;
-// テキストファイルに記述した関数のグラフを描画する
-void draw_graph();
+// コマンドライン引数で与えたジョブファイルの画像を、対話的な入力なしで出力する
+int run_batch(int argc, char *argv[]);
+// 固定の式の集合の画像と処理時間を基準と比べる(--checkで始まるコマンドライン引数の場合)
+int run_check(int argc, char *argv[]);
+// テキストファイルに記述した関数のグラフを描画する(use_mappingがtrueの場合は出力ファイルをメモリにマップして直接描画する)
+void draw_graph(bool use_mapping);
 
 // ニュートン法を実行してグラフを出力する
 void newton_method();
-// 関数
-double f(double x, Node *node);
-// 微分係数を計算する
-double dxdy(double x, Node *node);
-// 接線の式
-double tangent_line(double x, Node *node);
-// 接線を描画して保存する
-void write_tangent_line(Pixel *graph_image, Node *nodes_for_tangent_line, int count);
+// 多数の初期値からニュートン法を実行し、どの解に収束するかの分布を画像に出力する
+void newton_basins();
+// 収束先の分布の画像で、x座標に対応する色を返す
+Pixel basin_color(double x, void *context);
+// graphs.txtの各式について、計算方法ごとの速度と結果の差を表示する
+void benchmark_evaluators();
+// graphs.txtのグラフの交点と極値の一覧を出力する(印を付けた画像も出力できる)
+void list_curve_features();
+// graphs.txtのグラフを、粗い点の集合から段階ごとに細かくしながら描画し、段階ごとの画像を出力する
+void draw_graph_progressive();
+// graphs.txtの2行目以降から、パラメータの族と陰関数以外の式と色を読み込み、式の数を返す(対象外の行は表示して読み飛ばす)
+int read_plain_expressions(JobReader *reader, char ***expressions, Pixel **colors);
+// 複数の式について、1つずつ計算した場合と1つのプログラムにまとめて計算した場合の速度と結果の差を表示する
+void benchmark_fused(Node **nodes, int count, double *expected, double *ys);
+// パラメータの族について、1つずつ計算した場合と一括で計算した場合の速度と結果の差を表示する
+void benchmark_family(Node *node, GraphFamily *family, double *expected, double *ys);
+// graphs.txtの1行目(最初の空でない行)から出力ファイル名を読み込む(ファイルの終わりならNULL)
+char *read_output_name(JobReader *reader);
+// graphs.txtの2行目以降のグラフを描画する(graph_imageがNULLならtiled_graphに追加する)
+void draw_graph_lines(JobReader *reader, GraphImage *graph_image, TiledGraph *tiled_graph);
+// まとめて描画するために溜めておいた式のグラフを描画する
+void flush_expressions(GraphImage *graph_image, TiledGraph *tiled_graph, char **expressions, Pixel *colors, int count);
+// 2つの計算結果の差の最大値を返す
+double max_difference(double *expected, double *actual, int count);
+// 経過時間の計測用に、現在の時刻[秒]を返す
+double get_seconds();
+// ニュートン法で解を求める関数
+typedef struct function
+{
+    // 関数の構文木
+    Node *node;
+    // 多項式(有理式)であればその係数(そうでなければNULL)
+    Rational *rational;
+} Function;
+
+// 反復ごとに接線(割線)を描画する先
+typedef struct tangent_images
+{
+    ExportQueue *queue;
+    GraphImage *graph_image;
+} TangentImages;
 
-int main(void)
+// 関数(userdataはFunction)
+double f(double x, void *userdata);
+// 関数の値と微分係数を求める。
+Dual calclate_function_dual(Function *function, double x);
+// 解法に渡す関数。order階までの微分係数を自動微分で求める。(userdataはFunction)
+void evaluate_function(double x, int order, double *values, void *userdata);
+// 解法の反復ごとに近似解を表示し、接線を描画する。(userdataはTangentImages)
+void on_root_iteration(int iteration, double x, double fx, double slope, void *userdata);
+// 点(x, fx)を通る傾きslopeの直線を描画して書き出し待ちに追加する(slopeがNANなら直線は描かない)
+void write_tangent_line(ExportQueue *queue, GraphImage *graph_image, double x, double fx, double slope, int count);
+
+int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "--check") == 0)
+    {
+        return run_check(argc, argv);
+    }
+    // 引数があればジョブファイルを処理する。
+    if (argc > 1)
+    {
+        return run_batch(argc, argv);
+    }
     Mode mode;
     int mode_input;
     printf("グラフ描画&ニュートン法シミュレータ\n");
-    printf("モードを選んでください。\n%d: ニュートン法シミュレータ\n%d: 関数グラフ描画\n", newton, draw_graph_mode);
+    printf("モードを選んでください。\n%d: ニュートン法シミュレータ\n%d: 関数グラフ描画\n%d: 関数グラフ描画(出力ファイルに直接描画)\n%d: ニュートン法の収束先の分布\n%d: 計算速度の比較\n%d: グラフの交点と極値の一覧\n%d: 関数グラフ描画(段階的に描画)\n",
+           newton, draw_graph_mode, draw_graph_mapped_mode, newton_basins_mode, benchmark_mode, curve_features_mode, progressive_mode);
     scanf("%d", &mode_input);
     mode = (Mode)mode_input;
     switch (mode)
@@ -42,7 +134,22 @@ int main(void)
         newton_method();
         break;
     case draw_graph_mode:
-        draw_graph();
+        draw_graph(false);
+        break;
+    case draw_graph_mapped_mode:
+        draw_graph(true);
+        break;
+    case newton_basins_mode:
+        newton_basins();
+        break;
+    case benchmark_mode:
+        benchmark_evaluators();
+        break;
+    case curve_features_mode:
+        list_curve_features();
+        break;
+    case progressive_mode:
+        draw_graph_progressive();
         break;
     default:
         break;
@@ -50,12 +157,80 @@ int main(void)
     return 0;
 }
 
-// 接線の方程式を計算するためににグローバル変数にしている。
-double xk;
+// 使い方: 実行ファイル [-j 並列数] [-a 計算精度] [-c キャッシュのディレクトリ] ジョブファイルまたはディレクトリ...
+int run_batch(int argc, char *argv[])
+{
+    int worker_count = 0;
+    Accuracy accuracy = accuracy_full;
+    const char *cache_directory = NULL;
+    int i;
+    for (i = 1; i < argc - 1 && argv[i][0] == '-'; i += 2)
+    {
+        if (strcmp(argv[i], "-j") == 0)
+        {
+            worker_count = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "-a") == 0)
+        {
+            accuracy = atoi(argv[i + 1]) == accuracy_fast ? accuracy_fast : accuracy_full;
+        }
+        else if (strcmp(argv[i], "-c") == 0)
+        {
+            cache_directory = argv[i + 1];
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (i >= argc || argv[i][0] == '-')
+    {
+        printf("使い方: %s [-j 並列数] [-a 計算精度(%d: 標準, %d: 高速)] [-c キャッシュのディレクトリ] ジョブファイルまたはディレクトリ...\n", argv[0], accuracy_full, accuracy_fast);
+        return 1;
+    }
+    return run_job_files(argv + i, argc - i, worker_count, accuracy, cache_directory) == 0 ? 0 : 1;
+}
+
+// 使い方: 実行ファイル --check [-g] [-u] [-t 許容する遅れ(%)] [基準ファイル]
+int run_check(int argc, char *argv[])
+{
+    bool update_golden = false;
+    bool update_baseline = false;
+    int threshold = DEFAULT_CHECK_THRESHOLD;
+    const char *baseline_path = DEFAULT_BASELINE_NAME;
+    int i;
+    for (i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-g") == 0)
+        {
+            update_golden = true;
+        }
+        else if (strcmp(argv[i], "-u") == 0)
+        {
+            update_baseline = true;
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            threshold = atoi(argv[++i]);
+        }
+        else if (argv[i][0] != '-')
+        {
+            baseline_path = argv[i];
+        }
+        else
+        {
+            printf("使い方: %s --check [-g(画像のハッシュ値を記録し直す)] [-u(時間を記録し直す)] [-t 許容する遅れ(%%)] [時間の基準ファイル(省略時は%s)]\n",
+                   argv[0], DEFAULT_BASELINE_NAME);
+            return 1;
+        }
+    }
+    return run_regression_check(GOLDEN_HASH_NAME, baseline_path, update_golden, update_baseline, threshold / 100.0) == 0 ? 0 : 1;
+}
 
 void newton_method()
 {
-    // ファイルから初期値、関数、導関数を読み込む
+    int i;
+    // ファイルから初期値、関数を読み込む
     char *function_file_name = "newton_funcs.txt";
     FILE *fp = fopen(function_file_name, "r");
     if (fp == NULL)
@@ -67,81 +242,158 @@ void newton_method()
 
     char expression[255];
     Token *tokens;
-    Node *dxdy_node, *f_node;
+    Node *f_node;
     // 初期値
     double x0;
-    // 初期値を読み込む
-    fscanf(fp, "%lf", &x0);
-    // 関数の式を読み込む
-    fscanf(fp, "%s", expression);
+    // 初期値と関数の式を読み込む(式は配列に収まる長さまで)
+    if (fscanf(fp, "%lf", &x0) != 1 || fscanf(fp, "%254s", expression) != 1)
+    {
+        printf("初期値と関数の式を読み込めませんでした。(ファイル名: %s)\n", function_file_name);
+        fclose(fp);
+        exit(-1);
+    }
     tokens = lexical(expression);
     f_node = parse(tokens);
-    // 導関数の式を読み込む
-    fscanf(fp, "%s", expression);
-    tokens = lexical(expression);
-    dxdy_node = parse(tokens);
-    // 接線描画用に構造体をコピーして配列にする(引数がNodeのポインタに制限されているので無理やり渡すには配列にするしかない)
-    Node nodes_for_tangent_line[2];
-    nodes_for_tangent_line[0] = *f_node;
-    nodes_for_tangent_line[1] = *dxdy_node;
-
-    // 許容誤差
-    double eps = 1.0e-10;
-    int i;
-    xk = x0;
-    Pixel *graph_image = init_graph_image();
+    // 導関数は自動微分で求めるので読み込まない。(3行目に書かれていても無視する)
+    fclose(fp);
+    // 多項式(有理式)なら係数から直接、値と微分係数を求める。
+    Function function = {f_node, extract_rational(f_node, NULL)};
+
+    int method_input;
+    printf("解法を選んでください。\n");
+    for (i = 0; i < root_method_count; i++)
+    {
+        printf("%d: %s\n", i, get_root_method_name(i));
+    }
+    if (scanf("%d", &method_input) != 1 || method_input < 0 || method_input >= root_method_count)
+    {
+        method_input = root_newton;
+    }
+    RootOptions options = get_default_root_options(method_input);
+    options.max_iter_count = MAX_ITER_COUNT;
+
+    GraphImage *graph_image = init_graph_image();
     draw_axis(graph_image);
     Pixel color = {0, 0, 0};
-    draw_graph_func(graph_image, color, f_node, f);
+    draw_graph_func(graph_image, color, &function, f);
+    // 画像の書き出しは別スレッドで行い、書き出している間に次の接線を計算・描画する。
+    ExportQueue *queue = init_export_queue(EXPORT_QUEUE_SIZE);
     srand(time(NULL));
-    for (i = 0; i < MAX_ITER_COUNT; i++)
+    // 接線は、解法が近似解を求める時に計算した値と微分係数から描く。
+    TangentImages images = {queue, graph_image};
+    options.observer = on_root_iteration;
+    options.observer_userdata = &images;
+    RootResult result = find_root(evaluate_function, &function, x0, &options);
+    if (result.is_converged)
     {
-        write_tangent_line(graph_image, nodes_for_tangent_line, i);
-        xk = xk - f(xk, f_node) / dxdy(xk, dxdy_node);
-        printf("[繰り返し%d回目]\n近似解: %.16f\n", i + 1, xk);
-        if (fabs(f(xk, f_node)) < eps)
-        {
-            printf("%d反復で近似解: %.16fが求まりました。\n", i + 1, xk);
-            write_tangent_line(graph_image, nodes_for_tangent_line, i + 1);
-            return;
-        }
+        printf("%d反復で近似解: %.16fが求まりました。\n", result.iteration_count, result.root);
+    }
+    else
+    {
+        printf("%d反復では収束しませんでした。\n", result.iteration_count);
+    }
+    printf("関数の計算回数: %d\n", result.evaluation_count);
+    // 同じ初期値から、各解法の反復回数と計算回数を比べる。
+    printf("%-16s %8s %8s %22s\n", "解法", "反復", "計算", "近似解");
+    for (i = 0; i < root_method_count; i++)
+    {
+        RootOptions compared = get_default_root_options(i);
+        compared.max_iter_count = MAX_ITER_COUNT;
+        RootResult compared_result = find_root(evaluate_function, &function, x0, &compared);
+        printf("%-16s %8d %8d %22.16f%s\n", get_root_method_name(i), compared_result.iteration_count,
+               compared_result.evaluation_count, compared_result.root, compared_result.is_converged ? "" : " (収束せず)");
+    }
+    // 書き出し待ちの画像がすべて書き出されるまで待つ。
+    dispose_export_queue(queue);
+    dispose_image(graph_image);
+    if (function.rational != NULL)
+    {
+        dispose_rational(function.rational);
     }
-    printf("%d反復では収束しませんでした。\n", MAX_ITER_COUNT);
-    write_tangent_line(graph_image, nodes_for_tangent_line, MAX_ITER_COUNT);
+    dispose_tree(f_node);
 }
 
-double dxdy(double x, Node *node)
+double f(double x, void *userdata)
 {
-    return calclate(x, node);
+    Function *function = (Function *)userdata;
+    if (function->rational != NULL)
+    {
+        return evaluate_rational(function->rational, x);
+    }
+    return calclate(x, function->node);
 }
 
-double f(double x, Node *node)
+Dual calclate_function_dual(Function *function, double x)
 {
-    return calclate(x, node);
+    if (function->rational != NULL)
+    {
+        return evaluate_rational_dual(function->rational, x);
+    }
+    return calclate_dual(x, function->node);
 }
 
-// f(x)計算用nodeとf'(x)計算用nodeを渡す
-// f(x) -> f'(x)という順でノードを渡す
-double tangent_line(double x, Node *node)
+void evaluate_function(double x, int order, double *values, void *userdata)
 {
-    return dxdy(xk, node + 1) * (x - xk) + f(xk, node);
+    Function *function = (Function *)userdata;
+    if (order >= 2)
+    {
+        Dual2 fx = function->rational != NULL ? evaluate_rational_dual2(function->rational, x) : calclate_dual2(x, function->node);
+        values[0] = fx.value;
+        values[1] = fx.derivative;
+        values[2] = fx.second_derivative;
+    }
+    else if (order == 1)
+    {
+        Dual fx = calclate_function_dual(function, x);
+        values[0] = fx.value;
+        values[1] = fx.derivative;
+    }
+    else
+    {
+        values[0] = f(x, function);
+    }
+}
+
+void on_root_iteration(int iteration, double x, double fx, double slope, void *userdata)
+{
+    TangentImages *images = (TangentImages *)userdata;
+    if (iteration > 0)
+    {
+        printf("[繰り返し%d回目]\n近似解: %.16f\n", iteration, x);
+    }
+    write_tangent_line(images->queue, images->graph_image, x, fx, slope, iteration);
 }
 
-void write_tangent_line(Pixel *graph_image, Node *nodes_for_tangent_line, int count)
+void write_tangent_line(ExportQueue *queue, GraphImage *graph_image, double x, double fx, double slope, int count)
 {
     char fileName[51];
     Pixel color;
     color.R = rand() % 256;
     color.G = rand() % 256;
     color.B = rand() % 256;
-    draw_graph_func(graph_image, color, nodes_for_tangent_line, tangent_line);
+    // 点(x, fx)を通る直線 y = slope(X - x) + fx の傾きと切片を求めて描画する。
+    if (!isnan(slope))
+    {
+        draw_graph_linear(graph_image, color, slope, fx - slope * x);
+    }
     sprintf(fileName, "%s/%d-%s", "newton_method_images", count, "newton_method");
-    export_to_bmp(graph_image, fileName);
+    enqueue_export(queue, graph_image, fileName);
 }
 
-void draw_graph()
+// 収束先の分布の画像を描くための情報
+typedef struct basins
 {
-    char *function_file_name = "graphs.txt";
+    // 初期値を等間隔に並べた時の最小値と間隔
+    double x_min;
+    double step;
+    NewtonResult *results;
+    int count;
+} Basins;
+
+void newton_basins()
+{
+    // ファイルから関数を読み込む(初期値は画像に写る範囲に並べるので使わない)
+    char *function_file_name = "newton_funcs.txt";
     FILE *fp = fopen(function_file_name, "r");
     if (fp == NULL)
     {
@@ -149,33 +401,790 @@ void draw_graph()
         printf("ファイル名: %s\n", function_file_name);
         exit(-1);
     }
+    char expression[255];
+    double x0;
+    if (fscanf(fp, "%lf", &x0) != 1 || fscanf(fp, "%254s", expression) != 1)
+    {
+        printf("初期値と関数の式を読み込めませんでした。(ファイル名: %s)\n", function_file_name);
+        fclose(fp);
+        exit(-1);
+    }
+    fclose(fp);
+    Node *f_node = parse(lexical(expression));
+    Program *program = compile_program(f_node);
 
-    char *file_name = (char *)calloc(51, sizeof(char));
-    fscanf(fp, "%s", file_name);
-    if (strlen(file_name) > 20)
+    // 画像に写るxの範囲に初期値を等間隔に並べる。
+    Basins basins;
+    double x_max;
+    get_graph_x_range(&basins.x_min, &x_max);
+    basins.count = START_COUNT;
+    basins.step = (x_max - basins.x_min) / (START_COUNT - 1);
+    double *x0s = (double *)malloc(sizeof(double) * START_COUNT);
+    basins.results = (NewtonResult *)malloc(sizeof(NewtonResult) * START_COUNT);
+    if (x0s == NULL || basins.results == NULL)
     {
-        printf("出力ファイル名は20文字までにしてください。\n");
+        perror("メモリ確保エラー");
         exit(-1);
     }
-    printf("%s.bmpにグラフを書き込みます。\n", file_name);
-    Pixel color;
-    char expression[255];
+    int i;
+    for (i = 0; i < START_COUNT; i++)
+    {
+        x0s[i] = basins.x_min + basins.step * i;
+    }
 
-    Pixel *graph_image = init_graph_image();
-    draw_axis(graph_image);
-    while (fscanf(fp, "%s %hhu %hhu %hhu", expression, &color.R, &color.G, &color.B) != EOF)
+    double start_time = get_seconds();
+    solve_newton_multi(program, x0s, basins.results, START_COUNT, MAX_ITER_COUNT, 1.0e-10, 0);
+    double roots[MAX_ROOT_COUNT];
+    int root_count = classify_roots(basins.results, START_COUNT, roots, MAX_ROOT_COUNT, 1.0e-4);
+    printf("%d個の初期値を%.3f秒で計算しました。\n", START_COUNT, get_seconds() - start_time);
+
+    // 解ごとに、収束した初期値の数と平均反復回数を表示する。
+    int not_converged = START_COUNT;
+    for (i = 0; i < root_count; i++)
     {
-        draw_graph_expression(graph_image, color, expression);
-        color.R = 0;
-        color.G = 0;
-        color.B = 0;
+        int count = 0;
+        long long iteration_sum = 0;
+        int j;
+        for (j = 0; j < START_COUNT; j++)
+        {
+            if (basins.results[j].root_index == i)
+            {
+                count++;
+                iteration_sum += basins.results[j].iteration_count;
+            }
+        }
+        not_converged -= count;
+        printf("解%d: %.16f (初期値%d個, 平均%.2f反復)\n", i + 1, roots[i], count, (double)iteration_sum / count);
     }
+    printf("収束しなかった初期値: %d個\n", not_converged);
 
+    // 収束先ごとに色分けした背景に、座標軸と関数のグラフを重ねて描画する。
+    GraphImage *graph_image = init_graph_image();
+    paint_columns(graph_image, basin_color, &basins);
+    draw_axis(graph_image);
+    Pixel color = {0, 0, 0};
+    Function function = {f_node, extract_rational(f_node, NULL)};
+    draw_graph_func(graph_image, color, &function, f);
+    if (function.rational != NULL)
+    {
+        dispose_rational(function.rational);
+    }
+    char file_name[51] = "newton_basins";
     export_to_bmp(graph_image, file_name);
+    printf("%s.bmpを出力しました。\n", file_name);
 
-    printf("%sを出力しました。\n", file_name);
     dispose_image(graph_image);
+    free(x0s);
+    free(basins.results);
+    dispose_program(program);
+    dispose_tree(f_node);
+}
+
+// 解の番号ごとの色で、反復回数が多いほど暗くする。(収束しなかった場合は白)
+Pixel basin_color(double x, void *context)
+{
+    static const Pixel palette[] = {
+        {230, 100, 100}, {100, 180, 230}, {120, 210, 120}, {230, 190, 90}, {180, 120, 220}, {90, 200, 190}};
+    Basins *basins = (Basins *)context;
+    Pixel white = {255, 255, 255};
+    int index = (int)round((x - basins->x_min) / basins->step);
+    if (index < 0 || index >= basins->count || basins->results[index].root_index < 0)
+    {
+        return white;
+    }
+    NewtonResult *result = basins->results + index;
+    Pixel color = palette[result->root_index % (sizeof(palette) / sizeof(palette[0]))];
+    double brightness = 1 - 0.6 * fmin(1, result->iteration_count / 30.0);
+    color.R = color.R * brightness;
+    color.G = color.G * brightness;
+    color.B = color.B * brightness;
+    return color;
+}
+
+double get_seconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1.0e-9;
+}
+
+void draw_graph(bool use_mapping)
+{
+    char *function_file_name = "graphs.txt";
+    JobReader *reader = open_job_reader(function_file_name);
+    if (reader == NULL)
+    {
+        perror("ファイルを開けませんでした。\n");
+        printf("ファイル名: %s\n", function_file_name);
+        exit(-1);
+    }
+
+    char *file_name = read_output_name(reader);
+    if (file_name == NULL)
+    {
+        printf("出力ファイル名がありません。\n");
+        exit(-1);
+    }
+    // グラフの描画にはピクセル単位の精度があれば十分なので、高速な近似も選べるようにする。
+    int accuracy_input;
+    printf("計算精度を選んでください。\n%d: 標準(libmと同じ精度)\n%d: 高速(相対誤差1e-7程度)\n", accuracy_full, accuracy_fast);
+    scanf("%d", &accuracy_input);
+    Accuracy accuracy = accuracy_input == accuracy_fast ? accuracy_fast : accuracy_full;
+    printf("%s.bmpにグラフを書き込みます。\n", file_name);
+
+    // 出力ファイルをメモリにマップして、ファイルの画像データに直接描画する。(マップできない環境では帯ごとの描画にする)
+    GraphImage *graph_image = use_mapping ? init_mapped_graph_image(file_name) : NULL;
+    if (graph_image != NULL)
+    {
+        graph_image->accuracy = accuracy;
+        draw_axis(graph_image);
+        draw_graph_lines(reader, graph_image, NULL);
+        export_mapped_graph_image(graph_image);
+        printf("%s.bmpを出力しました。\n", file_name);
+        dispose_image(graph_image);
+        free(file_name);
+        close_job_reader(reader);
+        return;
+    }
+
+    // 画像全体をメモリ上に持たず、帯ごとに描画してファイルに書き出す。
+    TiledGraph *tiled_graph = init_tiled_graph(STRIP_HEIGHT);
+    set_tiled_graph_accuracy(tiled_graph, accuracy);
+    add_axis(tiled_graph);
+    draw_graph_lines(reader, NULL, tiled_graph);
+
+    export_tiled_graph_to_bmp(tiled_graph, file_name);
+
+    printf("%s.bmpを出力しました。\n", file_name);
+    dispose_tiled_graph(tiled_graph);
     free(file_name);
 
+    close_job_reader(reader);
+}
+
+// 行の最初の項目を出力ファイル名とする。(長さの制限はない)
+char *read_output_name(JobReader *reader)
+{
+    const char *line;
+    int length;
+    while (read_job_line(reader, &line, &length))
+    {
+        int start = 0;
+        while (start < length && isspace((unsigned char)line[start]))
+        {
+            start++;
+        }
+        int end = start;
+        while (end < length && !isspace((unsigned char)line[end]))
+        {
+            end++;
+        }
+        if (start == end)
+        {
+            continue;
+        }
+        char *name = (char *)malloc(end - start + 1);
+        if (name == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        memcpy(name, line + start, end - start);
+        name[end - start] = '\0';
+        return name;
+    }
+    return NULL;
+}
+
+// 式のグラフは、共通の部分式を1回だけ計算するように、パラメータの族の行の間にあるものをまとめて描画する。
+// (描画する順番は行の順番のまま)
+// ファイルをすべて読み終わるのを待たずに描画を始めるように、MAX_BATCH_EXPRESSIONS個ずつ描画する。
+void draw_graph_lines(JobReader *reader, GraphImage *graph_image, TiledGraph *tiled_graph)
+{
+    GraphLine graph_line;
+    char **expressions = NULL;
+    Pixel *colors = NULL;
+    int count = 0, capacity = 0, i;
+    while (read_graph_line(reader, &graph_line))
+    {
+        // 式は読み込み器の領域を指しているので、null文字で終わる文字列にコピーする。
+        char *expression = (char *)malloc(graph_line.expression_length + 1);
+        if (expression == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        memcpy(expression, graph_line.expression, graph_line.expression_length);
+        expression[graph_line.expression_length] = '\0';
+        bool is_implicit = is_implicit_expression(expression);
+        if (graph_line.family.count > 0 || is_implicit || count == MAX_BATCH_EXPRESSIONS)
+        {
+            flush_expressions(graph_image, tiled_graph, expressions, colors, count);
+            for (i = 0; i < count; i++)
+            {
+                free(expressions[i]);
+            }
+            count = 0;
+        }
+        if (graph_line.family.count > 0)
+        {
+            if (graph_image != NULL)
+            {
+                draw_graph_family(graph_image, &graph_line.family, expression);
+            }
+            else
+            {
+                add_graph_family(tiled_graph, &graph_line.family, expression);
+            }
+            free(expression);
+            continue;
+        }
+        // 陰関数の曲線は、xとyの格子で値を求めるので、他の式とまとめずに描画する。
+        if (is_implicit)
+        {
+            if (graph_image != NULL)
+            {
+                draw_graph_implicit(graph_image, graph_line.color, expression, 0);
+            }
+            else
+            {
+                add_graph_implicit(tiled_graph, graph_line.color, expression);
+            }
+            free(expression);
+            continue;
+        }
+        // 足りなくなったら倍の大きさにする。
+        if (count == capacity)
+        {
+            capacity = capacity == 0 ? 16 : capacity * 2;
+            expressions = (char **)realloc(expressions, sizeof(char *) * capacity);
+            colors = (Pixel *)realloc(colors, sizeof(Pixel) * capacity);
+            if (expressions == NULL || colors == NULL)
+            {
+                perror("メモリ確保エラー");
+                exit(-1);
+            }
+        }
+        expressions[count] = expression;
+        colors[count] = graph_line.color;
+        count++;
+    }
+    flush_expressions(graph_image, tiled_graph, expressions, colors, count);
+    for (i = 0; i < count; i++)
+    {
+        free(expressions[i]);
+    }
+    free(expressions);
+    free(colors);
+}
+
+void flush_expressions(GraphImage *graph_image, TiledGraph *tiled_graph, char **expressions, Pixel *colors, int count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (graph_image != NULL)
+    {
+        draw_graph_expressions(graph_image, colors, expressions, count);
+    }
+    else
+    {
+        add_graph_expressions(tiled_graph, colors, expressions, count);
+    }
+}
+
+// 式の行をすべて読み込んでから、全曲線の極値と全組の交点をまとめて求める。(パラメータの族の行は対象外)
+void list_curve_features()
+{
+    char *function_file_name = "graphs.txt";
+    JobReader *reader = open_job_reader(function_file_name);
+    if (reader == NULL)
+    {
+        perror("ファイルを開けませんでした。\n");
+        printf("ファイル名: %s\n", function_file_name);
+        exit(-1);
+    }
+    char *file_name = read_output_name(reader);
+    if (file_name == NULL)
+    {
+        printf("出力ファイル名がありません。\n");
+        exit(-1);
+    }
+    int marker_input;
+    printf("交点と極値に印を付けた画像を出力しますか。\n0: いいえ\n1: はい\n");
+    if (scanf("%d", &marker_input) != 1)
+    {
+        marker_input = 0;
+    }
+
+    char **expressions;
+    Pixel *colors;
+    int count = read_plain_expressions(reader, &expressions, &colors), i;
+    close_job_reader(reader);
+
+    Node **nodes = (Node **)malloc(sizeof(Node *) * (count + 1));
+    if (nodes == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    for (i = 0; i < count; i++)
+    {
+        nodes[i] = parse(lexical(expressions[i]));
+    }
+    CurveFeature *features;
+    double start = get_seconds();
+    int feature_count = find_curve_features(nodes, count, accuracy_full, &features, 0);
+    double elapsed = get_seconds() - start;
+
+    // 一覧は画面とファイルの両方に出力する。
+    char *list_name = (char *)malloc(strlen(file_name) + sizeof("_features.txt"));
+    if (list_name == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    sprintf(list_name, "%s_features.txt", file_name);
+    FILE *fp = fopen(list_name, "w");
+    if (fp == NULL)
+    {
+        perror("ファイルを開けませんでした。\n");
+        printf("ファイル名: %s\n", list_name);
+        exit(-1);
+    }
+    for (i = 0; i < count; i++)
+    {
+        printf("[%d] %s\n", i + 1, expressions[i]);
+        fprintf(fp, "# [%d] %s\n", i + 1, expressions[i]);
+    }
+    fprintf(fp, "# 種類\t曲線\t曲線\tx\ty\n");
+    for (i = 0; i < feature_count; i++)
+    {
+        CurveFeature *feature = features + i;
+        // 極値の場合、2つ目の曲線の欄は空にする。
+        char other_curve[16] = "";
+        if (feature->other_curve >= 0)
+        {
+            sprintf(other_curve, "%d", feature->other_curve + 1);
+        }
+        printf("%s [%d]%s%s%s (%.12f, %.12f)\n", get_feature_type_name(feature->type), feature->curve + 1,
+               feature->other_curve >= 0 ? " と [" : "", other_curve, feature->other_curve >= 0 ? "]" : "", feature->x, feature->y);
+        fprintf(fp, "%s\t%d\t%s\t%.17g\t%.17g\n", get_feature_type_name(feature->type), feature->curve + 1, other_curve, feature->x, feature->y);
+    }
     fclose(fp);
+    printf("%d本の曲線から%d個の点が見つかりました。(%.3f ms)\n%sに一覧を出力しました。\n", count, feature_count, elapsed * 1000, list_name);
+
+    if (marker_input == 1)
+    {
+        // 交点は黒、極値は曲線と同じ色の円で示す。
+        GraphImage *graph_image = init_graph_image();
+        draw_axis(graph_image);
+        draw_graph_expressions(graph_image, colors, expressions, count);
+        Pixel black = {0, 0, 0};
+        for (i = 0; i < feature_count; i++)
+        {
+            CurveFeature *feature = features + i;
+            draw_marker(graph_image, feature->type == feature_intersection ? black : colors[feature->curve], feature->x, feature->y);
+        }
+        sprintf(list_name, "%s_features", file_name);
+        export_to_bmp(graph_image, list_name);
+        printf("%s.bmpを出力しました。\n", list_name);
+        dispose_image(graph_image);
+    }
+
+    free(features);
+    free(list_name);
+    for (i = 0; i < count; i++)
+    {
+        dispose_tree(nodes[i]);
+        free(expressions[i]);
+    }
+    free(nodes);
+    free(expressions);
+    free(colors);
+    free(file_name);
+}
+
+int read_plain_expressions(JobReader *reader, char ***expressions, Pixel **colors)
+{
+    GraphLine graph_line;
+    int count = 0, capacity = 0;
+    *expressions = NULL;
+    *colors = NULL;
+    while (read_graph_line(reader, &graph_line))
+    {
+        if (graph_line.family.count > 0 || memchr(graph_line.expression, '=', graph_line.expression_length) != NULL)
+        {
+            printf("パラメータの族と陰関数の行は対象外です: %.*s\n", graph_line.expression_length, graph_line.expression);
+            continue;
+        }
+        // 足りなくなったら倍の大きさにする。
+        if (count == capacity)
+        {
+            capacity = capacity == 0 ? 16 : capacity * 2;
+            *expressions = (char **)realloc(*expressions, sizeof(char *) * capacity);
+            *colors = (Pixel *)realloc(*colors, sizeof(Pixel) * capacity);
+            if (*expressions == NULL || *colors == NULL)
+            {
+                perror("メモリ確保エラー");
+                exit(-1);
+            }
+        }
+        (*expressions)[count] = (char *)malloc(graph_line.expression_length + 1);
+        if ((*expressions)[count] == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        memcpy((*expressions)[count], graph_line.expression, graph_line.expression_length);
+        (*expressions)[count][graph_line.expression_length] = '\0';
+        (*colors)[count] = graph_line.color;
+        count++;
+    }
+    return count;
+}
+
+// 段階ごとの画像は別スレッドで書き出し、書き出している間に次の段階を計算・描画する。
+void draw_graph_progressive()
+{
+    char *function_file_name = "graphs.txt";
+    JobReader *reader = open_job_reader(function_file_name);
+    if (reader == NULL)
+    {
+        perror("ファイルを開けませんでした。\n");
+        printf("ファイル名: %s\n", function_file_name);
+        exit(-1);
+    }
+    char *file_name = read_output_name(reader);
+    if (file_name == NULL)
+    {
+        printf("出力ファイル名がありません。\n");
+        exit(-1);
+    }
+    int accuracy_input;
+    printf("計算精度を選んでください。\n%d: 標準(libmと同じ精度)\n%d: 高速(相対誤差1e-7程度)\n", accuracy_full, accuracy_fast);
+    scanf("%d", &accuracy_input);
+    Accuracy accuracy = accuracy_input == accuracy_fast ? accuracy_fast : accuracy_full;
+    char **expressions;
+    Pixel *colors;
+    int count = read_plain_expressions(reader, &expressions, &colors), i;
+    close_job_reader(reader);
+
+    double start = get_seconds();
+    GraphImage *graph_image = init_graph_image();
+    ExportQueue *queue = init_export_queue(EXPORT_QUEUE_SIZE);
+    ProgressiveGraph *progressive_graph = init_progressive_graph(expressions, colors, count, accuracy);
+    int pass_count = get_progressive_pass_count(progressive_graph);
+    // 途中の段階は「出力画像ファイル名_段階の番号」に、最後の段階は出力画像ファイル名に出力する。
+    char *pass_name = (char *)malloc(strlen(file_name) + 16);
+    if (pass_name == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int pass;
+    for (pass = 0; refine_progressive_graph(progressive_graph, graph_image); pass++)
+    {
+        printf("[段階%d/%d] %.3f ms\n", pass + 1, pass_count, (get_seconds() - start) * 1000);
+        if (pass < pass_count - 1)
+        {
+            sprintf(pass_name, "%s_%d", file_name, pass);
+        }
+        else
+        {
+            strcpy(pass_name, file_name);
+        }
+        enqueue_export(queue, graph_image, pass_name);
+    }
+    dispose_export_queue(queue);
+    printf("%s.bmpまで%d枚の画像を出力しました。(%.3f ms)\n", file_name, pass_count, (get_seconds() - start) * 1000);
+    dispose_progressive_graph(progressive_graph);
+    dispose_image(graph_image);
+    free(pass_name);
+    for (i = 0; i < count; i++)
+    {
+        free(expressions[i]);
+    }
+    free(expressions);
+    free(colors);
+    free(file_name);
+}
+
+// 2つの結果の差の最大値を返す。(両方NaNなら差はなし、片方だけNaNなら無限大とする)
+double max_difference(double *expected, double *actual, int count)
+{
+    double max = 0;
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        if (isnan(expected[i]) && isnan(actual[i]))
+        {
+            continue;
+        }
+        double difference = isnan(expected[i]) || isnan(actual[i]) ? INFINITY : fabs(expected[i] - actual[i]);
+        if (!(difference <= max))
+        {
+            max = difference;
+        }
+    }
+    return max;
+}
+
+void benchmark_evaluators()
+{
+    char *function_file_name = "graphs.txt";
+    JobReader *reader = open_job_reader(function_file_name);
+    if (reader == NULL)
+    {
+        perror("ファイルを開けませんでした。\n");
+        printf("ファイル名: %s\n", function_file_name);
+        exit(-1);
+    }
+    // 1行目の出力ファイル名は使わない。
+    free(read_output_name(reader));
+
+    double *xs = (double *)malloc(sizeof(double) * BENCHMARK_POINT_COUNT);
+    double *expected = (double *)malloc(sizeof(double) * BENCHMARK_POINT_COUNT);
+    double *ys = (double *)malloc(sizeof(double) * BENCHMARK_POINT_COUNT);
+    float *xs_float = (float *)malloc(sizeof(float) * BENCHMARK_POINT_COUNT);
+    float *ys_float = (float *)malloc(sizeof(float) * BENCHMARK_POINT_COUNT);
+    if (xs == NULL || expected == NULL || ys == NULL || xs_float == NULL || ys_float == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    // 画像に写るxの範囲に点を等間隔に並べる。
+    double x_min, x_max;
+    get_graph_x_range(&x_min, &x_max);
+    int i;
+    for (i = 0; i < BENCHMARK_POINT_COUNT; i++)
+    {
+        xs[i] = x_min + (x_max - x_min) * i / (BENCHMARK_POINT_COUNT - 1);
+        xs_float[i] = (float)xs[i];
+    }
+
+    GraphLine graph_line;
+    GraphFamily *family = &graph_line.family;
+    // 最後にまとめて計算するために、式の構文木を取っておく。
+    Node **nodes = NULL;
+    int node_count = 0, node_capacity = 0;
+    while (read_graph_line(reader, &graph_line))
+    {
+        // 式は読み込んだ行の一部なので、コピーせずに範囲を指定して字句解析する。
+        const char *expression = graph_line.expression;
+        int length = graph_line.expression_length;
+        Node *node = parse(lexical_range(expression, length));
+        if (family->count > 0)
+        {
+            printf("%.*s (%s=%g〜%g)\n", length, expression, family->parameter_name, family->start, family->end);
+            benchmark_family(node, family, expected, ys);
+            dispose_tree(node);
+            continue;
+        }
+        printf("%.*s (%d点)\n", length, expression, BENCHMARK_POINT_COUNT);
+
+        // 構文木を辿る計算を基準にする。
+        double start_time = get_seconds();
+        for (i = 0; i < BENCHMARK_POINT_COUNT; i++)
+        {
+            expected[i] = calclate(xs[i], node);
+        }
+        printf("  構文木: %.3f秒\n", get_seconds() - start_time);
+
+        // 多項式(有理式)なら、係数を求めてHorner法で計算する。
+        Rational *rational = extract_rational(node, NULL);
+        if (rational != NULL)
+        {
+            start_time = get_seconds();
+            for (i = 0; i < BENCHMARK_POINT_COUNT; i++)
+            {
+                ys[i] = evaluate_rational(rational, xs[i]);
+            }
+            printf("  多項式(Horner法, 1点ずつ): %.3f秒 (最大誤差 %g)\n", get_seconds() - start_time, max_difference(expected, ys, BENCHMARK_POINT_COUNT));
+            dispose_rational(rational);
+        }
+
+        Program *program = compile_program(node);
+        start_time = get_seconds();
+        run_program(program, xs, ys, BENCHMARK_POINT_COUNT);
+        printf("  命令列: %.3f秒 (最大誤差 %g)\n", get_seconds() - start_time, max_difference(expected, ys, BENCHMARK_POINT_COUNT));
+
+        JitFunction *jit = compile_jit(program);
+        if (jit != NULL)
+        {
+            start_time = get_seconds();
+            for (i = 0; i < BENCHMARK_POINT_COUNT; i++)
+            {
+                ys[i] = jit->function(xs[i], NULL);
+            }
+            printf("  機械語(1点ずつ): %.3f秒 (最大誤差 %g)\n", get_seconds() - start_time, max_difference(expected, ys, BENCHMARK_POINT_COUNT));
+            start_time = get_seconds();
+            run_jit(jit, xs, ys, BENCHMARK_POINT_COUNT);
+            printf("  機械語(%d点ずつ): %.3f秒 (最大誤差 %g)\n", jit->batch_width, get_seconds() - start_time, max_difference(expected, ys, BENCHMARK_POINT_COUNT));
+            dispose_jit(jit);
+        }
+        else
+        {
+            printf("  機械語: この環境では使用できません。\n");
+        }
+
+        // 超越関数を多項式近似で計算する。
+        program->accuracy = accuracy_fast;
+        start_time = get_seconds();
+        run_program(program, xs, ys, BENCHMARK_POINT_COUNT);
+        printf("  命令列(高速): %.3f秒 (最大誤差 %g)\n", get_seconds() - start_time, max_difference(expected, ys, BENCHMARK_POINT_COUNT));
+        jit = compile_jit(program);
+        if (jit != NULL)
+        {
+            start_time = get_seconds();
+            run_jit(jit, xs, ys, BENCHMARK_POINT_COUNT);
+            printf("  機械語(%d点ずつ, 高速): %.3f秒 (最大誤差 %g)\n", jit->batch_width, get_seconds() - start_time, max_difference(expected, ys, BENCHMARK_POINT_COUNT));
+            dispose_jit(jit);
+        }
+
+        // グラフの描画と同じく、floatで計算する。
+        int accuracy;
+        for (accuracy = accuracy_full; accuracy <= accuracy_fast; accuracy++)
+        {
+            program->accuracy = (Accuracy)accuracy;
+            char *accuracy_name = accuracy == accuracy_fast ? ", 高速" : "";
+            start_time = get_seconds();
+            run_program_float(program, xs_float, ys_float, BENCHMARK_POINT_COUNT);
+            double seconds = get_seconds() - start_time;
+            for (i = 0; i < BENCHMARK_POINT_COUNT; i++)
+            {
+                ys[i] = ys_float[i];
+            }
+            printf("  命令列(float%s): %.3f秒 (最大誤差 %g)\n", accuracy_name, seconds, max_difference(expected, ys, BENCHMARK_POINT_COUNT));
+            jit = compile_jit(program);
+            if (jit != NULL)
+            {
+                start_time = get_seconds();
+                run_jit_float(jit, xs_float, ys_float, BENCHMARK_POINT_COUNT);
+                seconds = get_seconds() - start_time;
+                for (i = 0; i < BENCHMARK_POINT_COUNT; i++)
+                {
+                    ys[i] = ys_float[i];
+                }
+                printf("  機械語(%d点ずつ, float%s): %.3f秒 (最大誤差 %g)\n", jit->batch_width_float, accuracy_name, seconds, max_difference(expected, ys, BENCHMARK_POINT_COUNT));
+                dispose_jit(jit);
+            }
+        }
+        dispose_program(program);
+        if (node_count == node_capacity)
+        {
+            node_capacity = node_capacity == 0 ? 16 : node_capacity * 2;
+            nodes = (Node **)realloc(nodes, sizeof(Node *) * node_capacity);
+            if (nodes == NULL)
+            {
+                perror("メモリ確保エラー");
+                exit(-1);
+            }
+        }
+        nodes[node_count++] = node;
+    }
+    if (node_count > 1)
+    {
+        benchmark_fused(nodes, node_count, expected, ys);
+    }
+    for (i = 0; i < node_count; i++)
+    {
+        dispose_tree(nodes[i]);
+    }
+    free(nodes);
+
+    free(xs);
+    free(expected);
+    free(ys);
+    free(xs_float);
+    free(ys_float);
+    close_job_reader(reader);
+}
+
+// 全体でBENCHMARK_POINT_COUNT点になるように、各式の点の数を決める。
+void benchmark_fused(Node **nodes, int count, double *expected, double *ys)
+{
+    int point_count = BENCHMARK_POINT_COUNT / count < 1 ? 1 : BENCHMARK_POINT_COUNT / count;
+    int node_count = count < BENCHMARK_POINT_COUNT ? count : BENCHMARK_POINT_COUNT;
+    double *xs = (double *)malloc(sizeof(double) * point_count);
+    if (xs == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    double x_min, x_max;
+    get_graph_x_range(&x_min, &x_max);
+    int i;
+    for (i = 0; i < point_count; i++)
+    {
+        xs[i] = point_count == 1 ? x_min : x_min + (x_max - x_min) * i / (point_count - 1);
+    }
+
+    // 式ごとに別のプログラムで計算する。
+    int instruction_count = 0;
+    double start_time = get_seconds();
+    for (i = 0; i < node_count; i++)
+    {
+        Program *program = compile_program(nodes[i]);
+        instruction_count += program->instruction_count;
+        run_program(program, xs, expected + (long long)i * point_count, point_count);
+        dispose_program(program);
+    }
+    double seconds = get_seconds() - start_time;
+    printf("すべての式 (%d式×%d点)\n", node_count, point_count);
+    printf("  命令列(1式ずつ, %d命令): %.3f秒\n", instruction_count, seconds);
+    // 共通の部分式を1回だけ計算する。
+    start_time = get_seconds();
+    Program *program = compile_programs(nodes, node_count);
+    run_program_multi(program, xs, ys, point_count);
+    seconds = get_seconds() - start_time;
+    printf("  命令列(まとめて, %d命令): %.3f秒 (最大誤差 %g)\n", program->instruction_count, seconds,
+           max_difference(expected, ys, node_count * point_count));
+    dispose_program(program);
+    free(xs);
+}
+
+// 族全体でBENCHMARK_POINT_COUNT点になるように、各グラフの点の数を決める。
+void benchmark_family(Node *node, GraphFamily *family, double *expected, double *ys)
+{
+    int point_count = BENCHMARK_POINT_COUNT / family->count < 1 ? 1 : BENCHMARK_POINT_COUNT / family->count;
+    int member_count = family->count < BENCHMARK_POINT_COUNT ? family->count : BENCHMARK_POINT_COUNT;
+    printf("  %d本×%d点\n", member_count, point_count);
+    double *xs = (double *)malloc(sizeof(double) * point_count);
+    double *parameters = (double *)malloc(sizeof(double) * member_count);
+    if (xs == NULL || parameters == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    double x_min, x_max;
+    get_graph_x_range(&x_min, &x_max);
+    int i;
+    for (i = 0; i < point_count; i++)
+    {
+        xs[i] = point_count == 1 ? x_min : x_min + (x_max - x_min) * i / (point_count - 1);
+    }
+    for (i = 0; i < member_count; i++)
+    {
+        parameters[i] = member_count == 1 ? family->start : family->start + (family->end - family->start) * i / (member_count - 1);
+    }
+
+    // パラメータの値ごとに、式全体を計算する。
+    Program *program = compile_program_with_parameter(node, family->parameter_name);
+    double start_time = get_seconds();
+    for (i = 0; i < member_count; i++)
+    {
+        program->parameter = parameters[i];
+        run_program(program, xs, expected + (long long)i * point_count, point_count);
+    }
+    printf("  命令列(1本ずつ): %.3f秒\n", get_seconds() - start_time);
+    // xだけで決まる部分を共通にして、全体を一括で計算する。
+    start_time = get_seconds();
+    run_program_family(program, parameters, member_count, xs, ys, point_count);
+    printf("  命令列(一括): %.3f秒 (最大誤差 %g)\n", get_seconds() - start_time,
+           max_difference(expected, ys, member_count * point_count));
+    dispose_program(program);
+    free(parameters);
+    free(xs);
 }
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdbool.h>
+#include "program.h"
+#include "parallel.h"
+#include "newton_solver.h"
+
+// 1つのスレッドがまとめて処理する初期値の数
+#define CHUNK_SIZE 4096
+
+// スレッドに渡す情報
+typedef struct newton_work
+{
+    Program *program;
+    const double *x0s;
+    NewtonResult *results;
+    int count;
+    int max_iter_count;
+    double eps;
+} NewtonWork;
+
+// CHUNK_SIZE個の初期値についてニュートン法を実行する。
+void solve_newton_chunk(int chunk_index, void *context);
+// 昇順に並べるための比較関数
+int compare_double(const void *a, const void *b);
+// 昇順に並んだ解の一覧から、最も近い解の番号を探す。
+int find_nearest_root(double *roots, int root_count, double x);
+
+void solve_newton_multi(Program *program, const double *x0s, NewtonResult *results, int count,
+                        int max_iter_count, double eps, int thread_count)
+{
+    NewtonWork work = {program, x0s, results, count, max_iter_count, eps};
+    int chunk_count = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    parallel_for(chunk_count, solve_newton_chunk, &work, thread_count);
+}
+
+void solve_newton_chunk(int chunk_index, void *context)
+{
+    NewtonWork *work = (NewtonWork *)context;
+    int start = chunk_index * CHUNK_SIZE;
+    int count = work->count - start < CHUNK_SIZE ? work->count - start : CHUNK_SIZE;
+    NewtonResult *results = work->results + start;
+
+    // まだ収束していない初期値の番号と、その近似値(詰めて並べておくと一括計算の無駄がない)
+    int active[CHUNK_SIZE];
+    double xs[CHUNK_SIZE], values[CHUNK_SIZE], derivatives[CHUNK_SIZE];
+    int active_count = count;
+    int i, iter;
+    for (i = 0; i < count; i++)
+    {
+        active[i] = i;
+        xs[i] = work->x0s[start + i];
+        results[i].is_converged = false;
+        results[i].root_index = -1;
+    }
+
+    for (iter = 0; active_count > 0; iter++)
+    {
+        // f(xk)とf'(xk)を1回で求める。
+        run_program_dual(work->program, xs, values, derivatives, active_count);
+        int next_count = 0;
+        for (i = 0; i < active_count; i++)
+        {
+            NewtonResult *result = results + active[i];
+            result->root = xs[i];
+            result->iteration_count = iter;
+            if (fabs(values[i]) < work->eps)
+            {
+                result->is_converged = true;
+                continue;
+            }
+            double next_x = xs[i] - values[i] / derivatives[i];
+            // 反復回数の上限に達した場合や、発散した場合(微分係数が0など)は打ち切る。
+            if (iter == work->max_iter_count || !isfinite(next_x))
+            {
+                continue;
+            }
+            active[next_count] = active[i];
+            xs[next_count] = next_x;
+            next_count++;
+        }
+        active_count = next_count;
+    }
+}
+
+int classify_roots(NewtonResult *results, int count, double *roots, int max_root_count, double tolerance)
+{
+    // 収束した近似解を昇順に並べる。
+    double *sorted = (double *)malloc(sizeof(double) * (count > 0 ? count : 1));
+    if (sorted == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int converged_count = 0;
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        if (results[i].is_converged)
+        {
+            sorted[converged_count++] = results[i].root;
+        }
+    }
+    qsort(sorted, converged_count, sizeof(double), compare_double);
+
+    // 隣り合う近似解の差が許容誤差以下なら同じ解とみなし、その平均を解とする。
+    int root_count = 0;
+    int group_start = 0;
+    for (i = 1; i <= converged_count; i++)
+    {
+        if (i < converged_count && sorted[i] - sorted[i - 1] <= tolerance * fmax(1, fabs(sorted[i])))
+        {
+            continue;
+        }
+        if (root_count < max_root_count)
+        {
+            double sum = 0;
+            int j;
+            for (j = group_start; j < i; j++)
+            {
+                sum += sorted[j];
+            }
+            roots[root_count++] = sum / (i - group_start);
+        }
+        group_start = i;
+    }
+    free(sorted);
+
+    for (i = 0; i < count; i++)
+    {
+        results[i].root_index = -1;
+        if (!results[i].is_converged || root_count == 0)
+        {
+            continue;
+        }
+        int nearest = find_nearest_root(roots, root_count, results[i].root);
+        if (fabs(roots[nearest] - results[i].root) <= tolerance * fmax(1, fabs(roots[nearest])) * 2)
+        {
+            results[i].root_index = nearest;
+        }
+    }
+    return root_count;
+}
+
+int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// 二分探索で探す。
+int find_nearest_root(double *roots, int root_count, double x)
+{
+    int low = 0, high = root_count - 1;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (roots[middle] < x)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    // lowはx以上で最小の解(なければ最後の解)なので、1つ前の解とも比べる。
+    if (low > 0 && fabs(roots[low - 1] - x) < fabs(roots[low] - x))
+    {
+        return low - 1;
+    }
+    return low;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef NEWTON_SOLVER
+#define NEWTON_SOLVER
+#include <stdbool.h>
+#include "program.h"
+
+// 1つの初期値についてのニュートン法の結果
+typedef struct newton_result
+{
+    // 近似解(収束しなかった場合は最後の値)
+    double root;
+    // 反復回数
+    int iteration_count;
+    // 収束したか
+    bool is_converged;
+    // 収束先の解の番号(classify_roots()で設定する。収束しなかった場合は-1)
+    int root_index;
+} NewtonResult;
+
+// count個の初期値それぞれからニュートン法を実行する。
+// 初期値をまとめて一括計算し(SIMD)、まとまりごとにスレッドに分けて並列に計算する。
+// thread_countが0以下の場合はCPUの数だけスレッドを使う。
+void solve_newton_multi(Program *program, const double *x0s, NewtonResult *results, int count,
+                        int max_iter_count, double eps, int thread_count);
+// 収束した近似解を近いものどうしでまとめて解の一覧(昇順)をrootsに書き込み、各結果のroot_indexを設定する。
+// 解の数を返す。(max_root_countを超えた分の解に収束した結果のroot_indexは-1になる)
+int classify_roots(NewtonResult *results, int count, double *roots, int max_root_count, double tolerance);
+
+#endif
\ No newline at end of file
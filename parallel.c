@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+
+// スレッド間で共有する作業の情報
+typedef struct parallel_work
+{
+    void (*task)(int index, void *context);
+    void *context;
+    int count;
+    // 次に処理する番号
+    int next;
+    pthread_mutex_t mutex;
+} ParallelWork;
+
+// 各スレッドで実行する関数
+void *parallel_worker(void *arg);
+
+int get_cpu_count()
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count < 1 ? 1 : (int)count;
+}
+
+void parallel_for(int count, void (*task)(int index, void *context), void *context, int thread_count)
+{
+    if (thread_count <= 0)
+    {
+        thread_count = get_cpu_count();
+    }
+    if (thread_count > count)
+    {
+        thread_count = count;
+    }
+    // 1スレッドで済む場合はスレッドを作らない。
+    if (thread_count <= 1)
+    {
+        int i;
+        for (i = 0; i < count; i++)
+        {
+            task(i, context);
+        }
+        return;
+    }
+
+    ParallelWork work;
+    work.task = task;
+    work.context = context;
+    work.count = count;
+    work.next = 0;
+    pthread_mutex_init(&work.mutex, NULL);
+
+    // 呼び出し元のスレッドも作業するので、新しく作るのは1つ少ない数
+    pthread_t *threads = (pthread_t *)calloc(thread_count - 1, sizeof(pthread_t));
+    if (threads == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int i;
+    for (i = 0; i < thread_count - 1; i++)
+    {
+        pthread_create(threads + i, NULL, parallel_worker, &work);
+    }
+    parallel_worker(&work);
+    for (i = 0; i < thread_count - 1; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&work.mutex);
+}
+
+void *parallel_worker(void *arg)
+{
+    ParallelWork *work = (ParallelWork *)arg;
+    while (1)
+    {
+        pthread_mutex_lock(&work->mutex);
+        int index = work->next++;
+        pthread_mutex_unlock(&work->mutex);
+        if (index >= work->count)
+        {
+            return NULL;
+        }
+        work->task(index, work->context);
+    }
+}
\ No newline at end of file
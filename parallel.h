@@ -0,0 +1,11 @@
+#ifndef PARALLEL
+#define PARALLEL
+
+// 使用できるCPUの数を返す。
+int get_cpu_count();
+// 0からcount-1までの番号について、複数のスレッドでtask(番号, context)を実行する。
+// 空いたスレッドが次の番号を取りに行くので、番号ごとの処理時間がばらついても偏りにくい。
+// thread_countが0以下の場合はCPUの数だけスレッドを使う。
+void parallel_for(int count, void (*task)(int index, void *context), void *context, int thread_count);
+
+#endif
\ No newline at end of file
@@ -1,12 +1,46 @@
 #include <stdlib.h>
+#include <stdio.h>
 #include "lexer.h"
 #include <math.h>
 #include <limits.h>
 #include "parser.h"
+#include "parallel.h"
 // get_priority関数で演算子以外が渡された時の戻り値
 #define NOT_OPERAND -1
 // 優先順位の基本値の最大(括弧の深さを考慮しない時の最大)
 #define MAX_PRIORITY 3
+// トークンの数がこれ以上の式は、一番外側の演算子で区切った部分を複数のスレッドで構文解析する。
+#define PARALLEL_PARSE_MIN_TOKENS (1 << 16)
+// 1つのスレッドにまとめて割り当てる、区切った部分の数の目安(スレッドあたり)
+#define PARSE_TASKS_PER_THREAD 8
+
+// 構文解析中の式の演算子の一覧(i番目は、式の中でi番目に現れる演算子)
+typedef struct parse_state
+{
+    // 演算子のトークンと優先順位(括弧の深さを含む)
+    Token **operators;
+    int *priorities;
+    // 演算子の直前と直後のトークン(構文解析中にトークンのつながりを切るので、先に覚えておく)
+    Token **prev_tokens;
+    Token **next_tokens;
+    // 演算子の左右の子になる演算子の番号(子が演算子でなければ-1)と、演算子のノード
+    int *lefts;
+    int *rights;
+    Node **nodes;
+    // 部分木を作る時のスタック(部分ごとに、その部分の演算子と同じ範囲を使う)
+    int *stack;
+    int count;
+    // 式の最初と最後のトークン
+    Token *first;
+    Token *last;
+    // 一番外側の演算子(優先順位が最小の演算子)の番号と数(複数のスレッドで解析する場合)
+    int *top_indices;
+    int top_count;
+    // 一番外側の演算子で区切った部分の構文木
+    Node **parts;
+    // 1つのスレッドの処理でまとめて解析する部分の数
+    int parts_per_task;
+} ParseState;
 
 Node *create_node(Token *tokens);
 // トークンの種類から優先順位を計算する。
@@ -15,6 +49,14 @@ Node *create_node(Token *tokens);
 // *: MAX_PRIORITY - 1
 // +: MAX_PRIORITY + (MAX_PRIORITY - 2)
 int get_priority(TokenType token_type, int nest_deps);
+// 演算子を含まない、firstからlastまでのトークンを値のノードにする。(firstがNULLなら空なのでNULLを返す)
+Node *parse_operand(Token *first, Token *last);
+// lo番目からhi-1番目までの演算子と、その間のfirstからlastまでのトークンの構文木を作る。(演算子がなければ値のノード)
+Node *build_subtree(ParseState *state, int lo, int hi, Token *first, Token *last);
+// 一番外側の演算子で区切ったindex番目の部分(のまとまり)の構文木を作る。(contextはParseState)
+void build_parts(int index, void *context);
+// 構文解析の作業領域を開放する。
+void dispose_parse_state(ParseState *state);
 
 // メモ：単項演算子の場合は左辺=0の二項演算として考える
 // 関数は単項演算子として考え、演算する。
@@ -22,95 +64,276 @@ int get_priority(TokenType token_type, int nest_deps);
 // sin(x) = 0 sin x
 // sin(x**2 + 1) = 0 sin (x**2 + 1)
 
+// 優先順位が最小の演算子(同じ場合は一番右)を根とし、その左右のトークンをそれぞれ同じように構文解析した木を作る。
+// 演算子の列に対するこの木はスタックを使って1回の走査で作れるので、トークンの数に比例する時間で構文解析できる。
+// 優先順位が最小の演算子は左に向かって鎖状につながり、その間の部分は互いに独立なので、大きな式では別々のスレッドで作る。
 Node *parse(Token *tokens)
 {
+    ParseState state = {NULL};
+    state.first = tokens;
+    int capacity = 0;
+    int token_count = 0;
     // 括弧の深さを考慮する。(括弧が深いほど優先順位が上がるため)
     int nest_deps = 0;
-
-    // 優先順位が一番低い演算子
-    Token *min_priority_operand = NULL;
-    int min_priority = INT_MAX;
-
-    Token *current = tokens;
-    while (current != NULL)
+    Token *current;
+    for (current = tokens; current != NULL; current = current->next)
     {
+        state.last = current;
+        token_count++;
         // 括弧はじめだったら優先順位の最大値を足してスキップ
         if (current->type == left_parenthesis)
         {
             nest_deps += MAX_PRIORITY;
-            Token *parenthesis_token = current;
-            current = current->next;
             continue;
         }
         // とじだったら優先順位の最大値を引く
         else if (current->type == right_parenthesis)
         {
             nest_deps -= MAX_PRIORITY;
-            Token *parenthesis_token = current;
-            current = current->next;
             continue;
         }
-
-        int current_operand_priorirty = get_priority(current->type, nest_deps);
-        // 優先順位が同じときは左を優先するので条件は「<=」になる
-        if (current_operand_priorirty <= min_priority && current_operand_priorirty != NOT_OPERAND)
+        int priority = get_priority(current->type, nest_deps);
+        if (priority == NOT_OPERAND)
+        {
+            continue;
+        }
+        // 足りなくなったら倍の大きさにする。
+        if (state.count == capacity)
         {
-            min_priority_operand = current;
-            min_priority = current_operand_priorirty;
+            capacity = capacity == 0 ? 16 : capacity * 2;
+            Token **operators = (Token **)realloc(state.operators, sizeof(Token *) * capacity);
+            int *priorities = (int *)realloc(state.priorities, sizeof(int) * capacity);
+            if (operators == NULL || priorities == NULL)
+            {
+                perror("メモリ確保エラー");
+                exit(-1);
+            }
+            state.operators = operators;
+            state.priorities = priorities;
         }
-        current = current->next;
+        state.operators[state.count] = current;
+        state.priorities[state.count] = priority;
+        state.count++;
     }
 
     // 演算子がない場合は値として扱う。
-    if (min_priority_operand == NULL)
+    if (state.count == 0)
+    {
+        return parse_operand(tokens, state.last);
+    }
+
+    state.prev_tokens = (Token **)malloc(sizeof(Token *) * state.count);
+    state.next_tokens = (Token **)malloc(sizeof(Token *) * state.count);
+    state.lefts = (int *)malloc(sizeof(int) * state.count);
+    state.rights = (int *)malloc(sizeof(int) * state.count);
+    state.nodes = (Node **)malloc(sizeof(Node *) * state.count);
+    state.stack = (int *)malloc(sizeof(int) * state.count);
+    if (state.prev_tokens == NULL || state.next_tokens == NULL || state.lefts == NULL || state.rights == NULL ||
+        state.nodes == NULL || state.stack == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int i;
+    for (i = 0; i < state.count; i++)
+    {
+        state.prev_tokens[i] = state.operators[i]->prev;
+        state.next_tokens[i] = state.operators[i]->next;
+    }
+
+    if (token_count < PARALLEL_PARSE_MIN_TOKENS)
+    {
+        Node *root = build_subtree(&state, 0, state.count, tokens, state.last);
+        dispose_parse_state(&state);
+        return root;
+    }
+
+    // 優先順位が最小の演算子を探す。
+    int min_priority = INT_MAX;
+    for (i = 0; i < state.count; i++)
+    {
+        if (state.priorities[i] < min_priority)
+        {
+            min_priority = state.priorities[i];
+        }
+    }
+    state.top_indices = (int *)malloc(sizeof(int) * state.count);
+    if (state.top_indices == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    for (i = 0; i < state.count; i++)
+    {
+        if (state.priorities[i] == min_priority)
+        {
+            state.top_indices[state.top_count++] = i;
+        }
+    }
+    // 一番外側の演算子で区切った部分(top_count + 1個)を、まとまりごとに別々のスレッドで作る。
+    state.parts = (Node **)malloc(sizeof(Node *) * (state.top_count + 1));
+    if (state.parts == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int task_count = get_cpu_count() * PARSE_TASKS_PER_THREAD;
+    state.parts_per_task = (state.top_count + 1 + task_count - 1) / task_count;
+    parallel_for((state.top_count + 1 + state.parts_per_task - 1) / state.parts_per_task, build_parts, &state, 0);
+
+    // 一番外側の演算子を左から順につなぐ。(左の子は1つ左の演算子、右の子はその演算子の右の部分)
+    Node *root = state.parts[0];
+    for (i = 0; i < state.top_count; i++)
+    {
+        Token *operator = state.operators[state.top_indices[i]];
+        Node *node = create_node(operator);
+        node->left = root;
+        node->right = state.parts[i + 1];
+        operator->next = NULL;
+        operator->prev = NULL;
+        root = node;
+    }
+    free(state.top_indices);
+    free(state.parts);
+    dispose_parse_state(&state);
+    return root;
+}
+
+void build_parts(int index, void *context)
+{
+    ParseState *state = (ParseState *)context;
+    int part;
+    int end = (index + 1) * state->parts_per_task;
+    for (part = index * state->parts_per_task; part < end && part <= state->top_count; part++)
     {
-        // 括弧は不要なので削除する。
-        current = tokens;
-        while (current != NULL)
+        // 部分の範囲は、前後の一番外側の演算子(または式の両端)の間
+        int lo = part == 0 ? 0 : state->top_indices[part - 1] + 1;
+        int hi = part == state->top_count ? state->count : state->top_indices[part];
+        Token *first = part == 0 ? state->first : state->next_tokens[lo - 1];
+        Token *last = part == state->top_count ? state->last : state->prev_tokens[hi];
+        // 一番外側の演算子が隣り合っている場合や、式の端にある場合は空
+        if ((part > 0 && first == NULL) || (part < state->top_count && first == state->operators[hi]))
         {
-            Token *next = current->next;
-            if (current->type == left_parenthesis || current->type == right_parenthesis)
+            first = NULL;
+        }
+        state->parts[part] = build_subtree(state, lo, hi, first, last);
+    }
+}
+
+// 演算子を左から順にスタックに積み、優先順位が同じか大きい演算子を取り出して新しい演算子の左の子にする。
+// 取り出した後にスタックに残った演算子の右の子は新しい演算子になる。(最後にスタックの底に残った演算子が根)
+Node *build_subtree(ParseState *state, int lo, int hi, Token *first, Token *last)
+{
+    if (lo == hi)
+    {
+        return parse_operand(first, last);
+    }
+    int *stack = state->stack + lo;
+    int stack_count = 0;
+    int i;
+    for (i = lo; i < hi; i++)
+    {
+        int popped = -1;
+        while (stack_count > 0 && state->priorities[stack[stack_count - 1]] >= state->priorities[i])
+        {
+            popped = stack[--stack_count];
+        }
+        state->lefts[i] = popped;
+        state->rights[i] = -1;
+        if (stack_count > 0)
+        {
+            state->rights[stack[stack_count - 1]] = i;
+        }
+        stack[stack_count++] = i;
+        state->nodes[i] = create_node(state->operators[i]);
+    }
+    // 子が演算子でない場合は、隣の演算子(または範囲の端)との間のトークンが値になる。
+    for (i = lo; i < hi; i++)
+    {
+        Node *node = state->nodes[i];
+        if (state->lefts[i] >= 0)
+        {
+            node->left = state->nodes[state->lefts[i]];
+        }
+        else
+        {
+            Token *left_first = i == lo ? first : state->next_tokens[i - 1];
+            if (left_first != state->operators[i])
             {
-                tokens = remove_token(tokens, current);
+                node->left = parse_operand(left_first, state->prev_tokens[i]);
             }
-            current = next;
         }
-        // すべて括弧だった場合はNULLを返す
-        if (tokens == NULL)
+        if (state->rights[i] >= 0)
+        {
+            node->right = state->nodes[state->rights[i]];
+        }
+        else
         {
-            return NULL;
+            Token *right_last = i == hi - 1 ? last : state->prev_tokens[i + 1];
+            if (right_last != state->operators[i])
+            {
+                node->right = parse_operand(state->next_tokens[i], right_last);
+            }
         }
-        tokens->prev == NULL;
-        Node *node = create_node(tokens);
-        return node;
     }
+    // 演算子ノードのトークンの前後を切断
+    for (i = lo; i < hi; i++)
+    {
+        state->operators[i]->next = NULL;
+        state->operators[i]->prev = NULL;
+    }
+    return state->nodes[stack[0]];
+}
 
-    // 以降、演算子がある場合のみ
-    // 演算子をトークンとして持つノード
-    Node *node = create_node(min_priority_operand);
-    Token *right_start_token = min_priority_operand->next;
-    min_priority_operand->next = NULL;
-    if (right_start_token != NULL)
+Node *parse_operand(Token *first, Token *last)
+{
+    if (first == NULL)
     {
-        node->right = parse(right_start_token);
+        return NULL;
     }
-    // 優先順位最小の演算子とtokensが同じではなかったら左側の子は存在する(「-1」など)
-    if (min_priority_operand != tokens)
+    // 後ろの演算子とのつながりを切る。
+    last->next = NULL;
+    Token *tokens = first;
+    // 括弧は不要なので削除する。
+    Token *current = tokens;
+    while (current != NULL)
     {
-        // 左の子の最後のトークン
-        Token *left_end_token = min_priority_operand->prev;
-        left_end_token->next = NULL;
-        node->left = parse(tokens);
+        Token *next = current->next;
+        if (current->type == left_parenthesis || current->type == right_parenthesis)
+        {
+            tokens = remove_token(tokens, current);
+        }
+        current = next;
     }
-    // 演算子ノードのトークンの前後を切断
-    node->token->next = NULL;
-    node->token->prev = NULL;
+    // すべて括弧だった場合はNULLを返す
+    if (tokens == NULL)
+    {
+        return NULL;
+    }
+    Node *node = create_node(tokens);
     return node;
 }
 
+void dispose_parse_state(ParseState *state)
+{
+    free(state->operators);
+    free(state->priorities);
+    free(state->prev_tokens);
+    free(state->next_tokens);
+    free(state->lefts);
+    free(state->rights);
+    free(state->nodes);
+    free(state->stack);
+}
+
 Node *create_node(Token *tokens)
 {
     Node *node = (Node *)calloc(1, sizeof(Node));
+    if (node == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
     node->left = NULL;
     node->right = NULL;
     node->token = tokens;
@@ -134,16 +357,18 @@ int get_priority(TokenType token_type, int nest_deps)
     }
 }
 
+// 左結合の長い式では左の子が深く続くので、左の子は再帰呼び出しではなくループでたどる。
 void dispose_tree(Node *node)
 {
-    dispose_all_tokens(node->token);
-    if (node->left != NULL)
-    {
-        dispose_tree(node->left);
-    }
-    if (node->right != NULL)
+    while (node != NULL)
     {
-        dispose_tree(node->right);
+        dispose_all_tokens(node->token);
+        if (node->right != NULL)
+        {
+            dispose_tree(node->right);
+        }
+        Node *left = node->left;
+        free(node);
+        node = left;
     }
-    free(node);
 }
\ No newline at end of file
@@ -0,0 +1,641 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdbool.h>
+#include "lexer.h"
+#include "parser.h"
+#include "calclator.h"
+#include "polynomial.h"
+
+// 有理式として扱う多項式の次数の上限
+#define MAX_POLYNOMIAL_DEGREE 64
+
+// mark_rational_subtrees()で辿っている途中の節
+typedef struct mark_frame
+{
+    Node *node;
+    // 節の前順の番号
+    int index;
+    // 左の子の部分木の有理式(右の子を辿っている間だけ使う)
+    Rational *left;
+    // 0: 左の子を辿る前, 1: 右の子を辿る前, 2: 両方の子を辿り終えた
+    int state;
+} MarkFrame;
+
+// 係数がすべて0の多項式を生成する。
+Polynomial *init_polynomial(int degree);
+// 多項式を開放する。
+void dispose_polynomial(Polynomial *polynomial);
+// 多項式をコピーする。
+Polynomial *copy_polynomial(Polynomial *polynomial);
+// 多項式a + sign * bを求める。
+Polynomial *add_polynomials(Polynomial *a, Polynomial *b, double sign);
+// 多項式の積を求める。(次数が上限を超える場合はNULL)
+Polynomial *multiply_polynomials(Polynomial *a, Polynomial *b);
+// 最高次の0の係数を取り除く。
+void trim_polynomial(Polynomial *polynomial);
+// 2つの多項式が等しいかを調べる。
+bool is_equal_polynomial(Polynomial *a, Polynomial *b);
+// 分子と分母から有理式を生成する。(分母が定数なら分子を割って多項式にする。分母が0や係数が有限でない場合はNULL)
+// 引数の多項式は有理式のものになるか、開放される。
+Rational *make_rational(Polynomial *numerator, Polynomial *denominator);
+// 定数の有理式を生成する。
+Rational *make_constant_rational(double value);
+// 有理式が定数かを調べる。
+bool is_constant_rational(Rational *rational);
+// 構文木を有理式に変換する。(有理式でない場合はNULL)
+Rational *convert_node(Node *node, const char *parameter_name);
+// 葉(定数と変数)を有理式に変換する。
+Rational *convert_leaf(Node *node, const char *parameter_name);
+// 節の演算を子の有理式に適用する。(子のどちらかが有理式でない(NULL)場合や、結果が有理式でない場合はNULL。引数の有理式は開放する)
+Rational *apply_node_to_rationals(Node *node, Rational *left, Rational *right);
+// 有理式の計算量が構文木のnode_count個の節より多いかを調べる。
+bool is_expensive_rational(Rational *rational, int node_count);
+// 有理式の和a + sign * bを求める。(引数の有理式は開放する。以下同様)
+Rational *add_rationals(Rational *a, Rational *b, double sign);
+// 有理式の積を求める。
+Rational *multiply_rationals(Rational *a, Rational *b);
+// 有理式の商を求める。
+Rational *divide_rationals(Rational *a, Rational *b);
+// 有理式の整数乗を求める。
+Rational *power_rational(Rational *base, int exponent);
+// 有理式をコピーする。
+Rational *copy_rational(Rational *rational);
+// 構文木のノードの数を数える。
+int count_nodes(Node *node);
+// Horner法で計算する時の演算(定数の読み込みを含む)の数を求める。
+int get_polynomial_cost(Polynomial *polynomial);
+
+Rational *extract_rational(Node *node, const char *parameter_name)
+{
+    Rational *rational = convert_node(node, parameter_name);
+    if (rational == NULL)
+    {
+        return NULL;
+    }
+    if (is_expensive_rational(rational, count_nodes(node)))
+    {
+        dispose_rational(rational);
+        return NULL;
+    }
+    return rational;
+}
+
+// 展開すると長くなる式((x+1)^20など)は、元の式のまま計算した方が速く、桁落ちもしにくい。
+bool is_expensive_rational(Rational *rational, int node_count)
+{
+    int cost = get_polynomial_cost(rational->numerator);
+    if (rational->denominator->degree > 0)
+    {
+        cost += get_polynomial_cost(rational->denominator) + 1;
+    }
+    return cost > node_count;
+}
+
+// 部分木ごとにextract_rational()を呼ぶと、長い式では同じ部分木を何度も変換することになるので、
+// 下の節から1回ずつ変換し、子の有理式から親の有理式を求める。(深い構文木でもスタックが溢れないように、再帰を使わずに辿る)
+RationalMarks *mark_rational_subtrees(Node *node, const char *parameter_name)
+{
+    RationalMarks *marks = (RationalMarks *)malloc(sizeof(RationalMarks));
+    int capacity = 16, stack_capacity = 16;
+    MarkFrame *stack = (MarkFrame *)malloc(sizeof(MarkFrame) * stack_capacity);
+    if (marks == NULL || stack == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    marks->is_rational = (bool *)malloc(sizeof(bool) * capacity);
+    marks->subtree_sizes = (int *)malloc(sizeof(int) * capacity);
+    if (marks->is_rational == NULL || marks->subtree_sizes == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int node_count = 0, depth = 0;
+    // 最後に辿り終えた部分木の有理式
+    Rational *rational = NULL;
+    Node *next = node;
+    while (next != NULL || depth > 0)
+    {
+        // 次の節に番号を付けて積む。
+        if (next != NULL)
+        {
+            if (node_count == capacity)
+            {
+                capacity *= 2;
+                bool *is_rational = (bool *)realloc(marks->is_rational, sizeof(bool) * capacity);
+                int *subtree_sizes = (int *)realloc(marks->subtree_sizes, sizeof(int) * capacity);
+                if (is_rational == NULL || subtree_sizes == NULL)
+                {
+                    perror("メモリ確保エラー");
+                    exit(-1);
+                }
+                marks->is_rational = is_rational;
+                marks->subtree_sizes = subtree_sizes;
+            }
+            if (depth == stack_capacity)
+            {
+                stack_capacity *= 2;
+                MarkFrame *new_stack = (MarkFrame *)realloc(stack, sizeof(MarkFrame) * stack_capacity);
+                if (new_stack == NULL)
+                {
+                    perror("メモリ確保エラー");
+                    exit(-1);
+                }
+                stack = new_stack;
+            }
+            stack[depth].node = next;
+            stack[depth].index = node_count++;
+            stack[depth].left = NULL;
+            stack[depth].state = 0;
+            depth++;
+            next = NULL;
+        }
+        MarkFrame *frame = stack + depth - 1;
+        TokenType type = frame->node->token->type;
+        if (type == num || type == e || type == pi || type == variable)
+        {
+            rational = convert_leaf(frame->node, parameter_name);
+        }
+        else if (frame->state < 2)
+        {
+            // 左の子を辿り終えたら、その有理式を取っておいて右の子を辿る。(子がない側は0)
+            if (frame->state == 1)
+            {
+                frame->left = rational;
+            }
+            next = frame->state == 0 ? frame->node->left : frame->node->right;
+            frame->state++;
+            if (next == NULL)
+            {
+                rational = make_constant_rational(0);
+            }
+            continue;
+        }
+        else
+        {
+            rational = apply_node_to_rationals(frame->node, frame->left, rational);
+        }
+        // 部分木を辿り終えた。
+        int size = node_count - frame->index;
+        marks->subtree_sizes[frame->index] = size;
+        marks->is_rational[frame->index] = rational != NULL && !is_expensive_rational(rational, size);
+        depth--;
+    }
+    if (rational != NULL)
+    {
+        dispose_rational(rational);
+    }
+    free(stack);
+    return marks;
+}
+
+void dispose_rational_marks(RationalMarks *marks)
+{
+    free(marks->is_rational);
+    free(marks->subtree_sizes);
+    free(marks);
+}
+
+void dispose_rational(Rational *rational)
+{
+    dispose_polynomial(rational->numerator);
+    dispose_polynomial(rational->denominator);
+    free(rational);
+}
+
+double evaluate_polynomial(Polynomial *polynomial, double x)
+{
+    double *c = polynomial->coefficients;
+    double y = c[polynomial->degree];
+    int i;
+    for (i = polynomial->degree - 1; i >= 0; i--)
+    {
+        y = y * x + c[i];
+    }
+    return y;
+}
+
+double evaluate_rational(Rational *rational, double x)
+{
+    double numerator = evaluate_polynomial(rational->numerator, x);
+    if (rational->denominator->degree == 0)
+    {
+        return numerator;
+    }
+    return numerator / evaluate_polynomial(rational->denominator, x);
+}
+
+// 多項式の値と微分係数は、Horner法の各段の微分を同時に求める。(p = p * x + c より p' = p' * x + p)
+Dual evaluate_rational_dual(Rational *rational, double x)
+{
+    Dual result[2];
+    Polynomial *polynomials[2] = {rational->numerator, rational->denominator};
+    int i, k;
+    for (k = 0; k < 2; k++)
+    {
+        double *c = polynomials[k]->coefficients;
+        double value = c[polynomials[k]->degree], derivative = 0;
+        for (i = polynomials[k]->degree - 1; i >= 0; i--)
+        {
+            derivative = derivative * x + value;
+            value = value * x + c[i];
+        }
+        result[k].value = value;
+        result[k].derivative = derivative;
+    }
+    if (rational->denominator->degree == 0)
+    {
+        return result[0];
+    }
+    // (p / q)' = (p'q - pq') / q^2
+    Dual quotient = {result[0].value / result[1].value,
+                     (result[0].derivative * result[1].value - result[0].value * result[1].derivative) / (result[1].value * result[1].value)};
+    return quotient;
+}
+
+// Horner法の各段の2階微分も同時に求める。(p' = p'_prev * x + p_prev より p'' = p''_prev * x + 2 * p'_prev)
+Dual2 evaluate_rational_dual2(Rational *rational, double x)
+{
+    Dual2 result[2];
+    Polynomial *polynomials[2] = {rational->numerator, rational->denominator};
+    int i, k;
+    for (k = 0; k < 2; k++)
+    {
+        double *c = polynomials[k]->coefficients;
+        double value = c[polynomials[k]->degree], derivative = 0, second_derivative = 0;
+        for (i = polynomials[k]->degree - 1; i >= 0; i--)
+        {
+            second_derivative = second_derivative * x + 2 * derivative;
+            derivative = derivative * x + value;
+            value = value * x + c[i];
+        }
+        result[k].value = value;
+        result[k].derivative = derivative;
+        result[k].second_derivative = second_derivative;
+    }
+    if (rational->denominator->degree == 0)
+    {
+        return result[0];
+    }
+    // q = p / r とすると、q' = (p' - q * r') / r, q'' = (p'' - 2 * q' * r' - q * r'') / r
+    Dual2 *p = result, *r = result + 1;
+    Dual2 quotient;
+    quotient.value = p->value / r->value;
+    quotient.derivative = (p->derivative - quotient.value * r->derivative) / r->value;
+    quotient.second_derivative = (p->second_derivative - 2 * quotient.derivative * r->derivative - quotient.value * r->second_derivative) / r->value;
+    return quotient;
+}
+
+Polynomial *init_polynomial(int degree)
+{
+    Polynomial *polynomial = (Polynomial *)malloc(sizeof(Polynomial));
+    if (polynomial == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    polynomial->coefficients = (double *)calloc(degree + 1, sizeof(double));
+    if (polynomial->coefficients == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    polynomial->degree = degree;
+    return polynomial;
+}
+
+void dispose_polynomial(Polynomial *polynomial)
+{
+    free(polynomial->coefficients);
+    free(polynomial);
+}
+
+Polynomial *copy_polynomial(Polynomial *polynomial)
+{
+    Polynomial *copy = init_polynomial(polynomial->degree);
+    memcpy(copy->coefficients, polynomial->coefficients, sizeof(double) * (polynomial->degree + 1));
+    return copy;
+}
+
+Polynomial *add_polynomials(Polynomial *a, Polynomial *b, double sign)
+{
+    Polynomial *sum = init_polynomial(a->degree > b->degree ? a->degree : b->degree);
+    int i;
+    for (i = 0; i <= a->degree; i++)
+    {
+        sum->coefficients[i] += a->coefficients[i];
+    }
+    for (i = 0; i <= b->degree; i++)
+    {
+        sum->coefficients[i] += sign * b->coefficients[i];
+    }
+    trim_polynomial(sum);
+    return sum;
+}
+
+Polynomial *multiply_polynomials(Polynomial *a, Polynomial *b)
+{
+    if (a->degree + b->degree > MAX_POLYNOMIAL_DEGREE)
+    {
+        return NULL;
+    }
+    Polynomial *product = init_polynomial(a->degree + b->degree);
+    int i, j;
+    for (i = 0; i <= a->degree; i++)
+    {
+        for (j = 0; j <= b->degree; j++)
+        {
+            product->coefficients[i + j] += a->coefficients[i] * b->coefficients[j];
+        }
+    }
+    trim_polynomial(product);
+    return product;
+}
+
+void trim_polynomial(Polynomial *polynomial)
+{
+    while (polynomial->degree > 0 && polynomial->coefficients[polynomial->degree] == 0)
+    {
+        polynomial->degree--;
+    }
+}
+
+bool is_equal_polynomial(Polynomial *a, Polynomial *b)
+{
+    return a->degree == b->degree && memcmp(a->coefficients, b->coefficients, sizeof(double) * (a->degree + 1)) == 0;
+}
+
+Rational *make_rational(Polynomial *numerator, Polynomial *denominator)
+{
+    if (numerator == NULL || denominator == NULL)
+    {
+        if (numerator != NULL)
+        {
+            dispose_polynomial(numerator);
+        }
+        if (denominator != NULL)
+        {
+            dispose_polynomial(denominator);
+        }
+        return NULL;
+    }
+    trim_polynomial(numerator);
+    trim_polynomial(denominator);
+    int i;
+    bool is_valid = !(denominator->degree == 0 && denominator->coefficients[0] == 0);
+    if (is_valid && denominator->degree == 0 && denominator->coefficients[0] != 1)
+    {
+        for (i = 0; i <= numerator->degree; i++)
+        {
+            numerator->coefficients[i] /= denominator->coefficients[0];
+        }
+        denominator->coefficients[0] = 1;
+    }
+    for (i = 0; is_valid && i <= numerator->degree; i++)
+    {
+        is_valid = isfinite(numerator->coefficients[i]);
+    }
+    for (i = 0; is_valid && i <= denominator->degree; i++)
+    {
+        is_valid = isfinite(denominator->coefficients[i]);
+    }
+    if (!is_valid)
+    {
+        dispose_polynomial(numerator);
+        dispose_polynomial(denominator);
+        return NULL;
+    }
+    Rational *rational = (Rational *)malloc(sizeof(Rational));
+    if (rational == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    rational->numerator = numerator;
+    rational->denominator = denominator;
+    return rational;
+}
+
+Rational *make_constant_rational(double value)
+{
+    Polynomial *numerator = init_polynomial(0);
+    Polynomial *denominator = init_polynomial(0);
+    numerator->coefficients[0] = value;
+    denominator->coefficients[0] = 1;
+    return make_rational(numerator, denominator);
+}
+
+bool is_constant_rational(Rational *rational)
+{
+    return rational->numerator->degree == 0 && rational->denominator->degree == 0;
+}
+
+// calclate()と同じ意味になるように変換する。(子がない側は0)
+Rational *convert_node(Node *node, const char *parameter_name)
+{
+    if (node == NULL)
+    {
+        return make_constant_rational(0);
+    }
+    TokenType type = node->token->type;
+    if (type == num || type == e || type == pi || type == variable)
+    {
+        return convert_leaf(node, parameter_name);
+    }
+    // 左の子が有理式でなければ、右の子は変換しない。
+    Rational *left = convert_node(node->left, parameter_name);
+    if (left == NULL)
+    {
+        return NULL;
+    }
+    return apply_node_to_rationals(node, left, convert_node(node->right, parameter_name));
+}
+
+Rational *convert_leaf(Node *node, const char *parameter_name)
+{
+    // 変数の場合
+    if (node->token->type == variable)
+    {
+        if (parameter_name != NULL && strcmp(node->token->data, parameter_name) == 0)
+        {
+            return NULL;
+        }
+        Polynomial *numerator = init_polynomial(1);
+        Polynomial *denominator = init_polynomial(0);
+        numerator->coefficients[1] = 1;
+        denominator->coefficients[0] = 1;
+        return make_rational(numerator, denominator);
+    }
+    // 定数の場合
+    return make_constant_rational(calclate(0, node));
+}
+
+Rational *apply_node_to_rationals(Node *node, Rational *left, Rational *right)
+{
+    TokenType type = node->token->type;
+    if (left == NULL || right == NULL)
+    {
+        if (left != NULL)
+        {
+            dispose_rational(left);
+        }
+        if (right != NULL)
+        {
+            dispose_rational(right);
+        }
+        return NULL;
+    }
+    // 引数がすべて定数なら、どの演算でも結果は定数になる。(calclate()と同じ計算機で、子の値から求める)
+    if (is_constant_rational(left) && is_constant_rational(right))
+    {
+        double (*calclator)(double left, double right) = get_calclator(node->token);
+        double value = calclator != NULL ? calclator(left->numerator->coefficients[0], right->numerator->coefficients[0]) : 0;
+        dispose_rational(left);
+        dispose_rational(right);
+        return make_constant_rational(value);
+    }
+    if (type == unary_ope)
+    {
+        return add_rationals(left, right, -1);
+    }
+    if (type == bin_ope_plus_minus)
+    {
+        return add_rationals(left, right, *(node->token->data) == '+' ? 1 : -1);
+    }
+    if (type == bin_ope_times_div)
+    {
+        return *(node->token->data) == '*' ? multiply_rationals(left, right) : divide_rationals(left, right);
+    }
+    // べき乗は、指数が整数の定数の場合だけ有理式になる。
+    if (type == func && (strcmp(node->token->data, "exp") == 0 || *(node->token->data) == '^') && is_constant_rational(right))
+    {
+        double exponent = right->numerator->coefficients[0];
+        dispose_rational(right);
+        if (exponent == floor(exponent) && fabs(exponent) <= MAX_POLYNOMIAL_DEGREE)
+        {
+            return power_rational(left, (int)exponent);
+        }
+        dispose_rational(left);
+        return NULL;
+    }
+    dispose_rational(left);
+    dispose_rational(right);
+    return NULL;
+}
+
+Rational *add_rationals(Rational *a, Rational *b, double sign)
+{
+    Rational *sum;
+    // 分母が同じ(多項式どうしの場合を含む)なら、分子だけを足す。
+    if (is_equal_polynomial(a->denominator, b->denominator))
+    {
+        sum = make_rational(add_polynomials(a->numerator, b->numerator, sign), copy_polynomial(a->denominator));
+    }
+    else
+    {
+        Polynomial *ad = multiply_polynomials(a->numerator, b->denominator);
+        Polynomial *bc = multiply_polynomials(b->numerator, a->denominator);
+        Polynomial *numerator = ad != NULL && bc != NULL ? add_polynomials(ad, bc, sign) : NULL;
+        if (ad != NULL)
+        {
+            dispose_polynomial(ad);
+        }
+        if (bc != NULL)
+        {
+            dispose_polynomial(bc);
+        }
+        sum = make_rational(numerator, multiply_polynomials(a->denominator, b->denominator));
+    }
+    dispose_rational(a);
+    dispose_rational(b);
+    return sum;
+}
+
+Rational *multiply_rationals(Rational *a, Rational *b)
+{
+    Rational *product = make_rational(multiply_polynomials(a->numerator, b->numerator),
+                                      multiply_polynomials(a->denominator, b->denominator));
+    dispose_rational(a);
+    dispose_rational(b);
+    return product;
+}
+
+Rational *divide_rationals(Rational *a, Rational *b)
+{
+    Rational *quotient = make_rational(multiply_polynomials(a->numerator, b->denominator),
+                                       multiply_polynomials(a->denominator, b->numerator));
+    dispose_rational(a);
+    dispose_rational(b);
+    return quotient;
+}
+
+// 2乗を繰り返して求める。負の指数は逆数の整数乗にする。
+Rational *power_rational(Rational *base, int exponent)
+{
+    if (exponent < 0)
+    {
+        Polynomial *numerator = base->numerator;
+        base->numerator = base->denominator;
+        base->denominator = numerator;
+        exponent = -exponent;
+    }
+    Rational *result = make_constant_rational(1);
+    while (exponent > 0 && result != NULL && base != NULL)
+    {
+        if (exponent & 1)
+        {
+            result = multiply_rationals(result, copy_rational(base));
+        }
+        exponent >>= 1;
+        if (exponent > 0 && result != NULL)
+        {
+            base = multiply_rationals(base, copy_rational(base));
+        }
+    }
+    // 途中で次数が上限を超えた場合
+    if (result == NULL || base == NULL)
+    {
+        if (result != NULL)
+        {
+            dispose_rational(result);
+        }
+        if (base != NULL)
+        {
+            dispose_rational(base);
+        }
+        return NULL;
+    }
+    dispose_rational(base);
+    return result;
+}
+
+Rational *copy_rational(Rational *rational)
+{
+    return make_rational(copy_polynomial(rational->numerator), copy_polynomial(rational->denominator));
+}
+
+int count_nodes(Node *node)
+{
+    if (node == NULL)
+    {
+        return 0;
+    }
+    return 1 + count_nodes(node->left) + count_nodes(node->right);
+}
+
+// 最高次の係数から始めて、xを掛ける命令と、0でない係数を足す命令(係数の読み込みを含む)の数
+int get_polynomial_cost(Polynomial *polynomial)
+{
+    int cost = 1 + polynomial->degree;
+    int i;
+    for (i = 0; i < polynomial->degree; i++)
+    {
+        if (polynomial->coefficients[i] != 0)
+        {
+            cost += 2;
+        }
+    }
+    return cost;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef POLYNOMIAL
+#define POLYNOMIAL
+#include "parser.h"
+#include "calclator.h"
+
+// xの多項式 coefficients[0] + coefficients[1] * x + ... + coefficients[degree] * x^degree
+typedef struct polynomial
+{
+    double *coefficients;
+    // 次数(最高次の係数は0でない。ただし0の定数はdegreeが0で係数が0)
+    int degree;
+} Polynomial;
+
+// xの有理式 numerator / denominator (多項式の場合、denominatorは定数1)
+typedef struct rational
+{
+    Polynomial *numerator;
+    Polynomial *denominator;
+} Rational;
+
+// 式がxの有理式(多項式を含む)であれば、その係数を求める。parameter_nameという名前の変数を含む式は有理式として扱わない。
+// 有理式でない場合や、展開すると元の式より計算量が多くなる場合((x+1)^20など)はNULLを返す。
+Rational *extract_rational(Node *node, const char *parameter_name);
+// 構文木の部分木のうち、extract_rational()で有理式に変換できるものの印(節には前順(親、左の子、右の子の順)に0から番号を付ける)
+typedef struct rational_marks
+{
+    // 番号の節を根とする部分木を、extract_rational()で有理式に変換できればtrue
+    bool *is_rational;
+    // 番号の節を根とする部分木の節の数
+    int *subtree_sizes;
+} RationalMarks;
+
+// 構文木のすべての部分木について、extract_rational()で有理式に変換できるかを1回辿るだけで調べる。
+RationalMarks *mark_rational_subtrees(Node *node, const char *parameter_name);
+// 印を開放する。
+void dispose_rational_marks(RationalMarks *marks);
+// 有理式を開放する。
+void dispose_rational(Rational *rational);
+// 多項式の値をHorner法で計算する。
+double evaluate_polynomial(Polynomial *polynomial, double x);
+// 有理式の値を計算する。
+double evaluate_rational(Rational *rational, double x);
+// 有理式の値と微分係数を計算する。(微分係数も係数から直接求めるので、数値微分の誤差はない)
+Dual evaluate_rational_dual(Rational *rational, double x);
+// 有理式の値と1階・2階の微分係数を計算する。
+Dual2 evaluate_rational_dual2(Rational *rational, double x);
+
+#endif
\ No newline at end of file
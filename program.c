@@ -0,0 +1,806 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdbool.h>
+#include "lexer.h"
+#include "parser.h"
+#include "calclator.h"
+#include "program.h"
+#include "fast_math.h"
+#include "polynomial.h"
+
+// 空のプログラムを生成する。
+Program *init_program(const char *parameter_name);
+// コンパイル中だけ使う領域を開放する。
+void finish_compile(Program *program);
+// 命令を追加して、その番号を返す。(同じ命令がすでにあれば、追加せずにその番号を返す)
+int add_instruction(Program *program, Opcode opcode, int left, int right, double value);
+// 命令のハッシュ値を求める。
+unsigned int hash_instruction(Opcode opcode, int left, int right, double value);
+// ハッシュ表に命令の番号を登録する。
+void insert_lookup(Program *program, int index);
+// 構文木全体を命令に変換し、式の値が入る命令の番号を返す。
+int compile_tree(Program *program, Node *node);
+// 構文木を後ろから順に命令に変換し、式の値が入る命令の番号を返す。(節は前順に辿り、program->mark_indexを進める)
+int compile_node(Program *program, Node *node);
+// 最後に番号を進めた節の、子の部分木の節の番号を飛ばす。
+void skip_subtree_marks(Program *program);
+// 有理式をHorner法で計算する命令に変換し、式の値が入る命令の番号を返す。
+int compile_rational(Program *program, Rational *rational);
+// 多項式をHorner法で計算する命令に変換し、式の値が入る命令の番号を返す。
+int compile_polynomial(Program *program, Polynomial *polynomial);
+// トークンに対応する命令の種類を取得する。(演算子でない、または未知の関数の場合は-1)
+int get_opcode(Token *token);
+// BATCH_SIZE個以下のxについて、すべての命令を実行する。
+void run_block(Program *program, const double *xs, double *registers, int count);
+// BATCH_SIZE個以下のxについて、index番目の命令を実行する。
+void run_instruction(Program *program, int index, const double *xs, double *registers, int count);
+// 各命令の結果がパラメータによって変わるかを求める。
+bool *get_parameter_dependency(Program *program);
+// floatで、すべての命令を実行する。
+void run_block_float(Program *program, const float *xs, float *registers, int count);
+// 値と微分係数の両方について、すべての命令を実行する。
+void run_block_dual(Program *program, const double *xs, double *values, double *derivatives, int count);
+
+Program *compile_program(Node *node)
+{
+    return compile_program_with_parameter(node, NULL);
+}
+
+Program *compile_program_with_parameter(Node *node, const char *parameter_name)
+{
+    Program *program = init_program(parameter_name);
+    program->result = compile_tree(program, node);
+    finish_compile(program);
+    return program;
+}
+
+Program *compile_programs(Node **nodes, int count)
+{
+    Program *program = init_program(NULL);
+    program->results = (int *)malloc(sizeof(int) * (count + 1));
+    if (program->results == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        program->results[i] = compile_tree(program, nodes[i]);
+    }
+    program->result_count = count;
+    program->result = count > 0 ? program->results[0] : compile_node(program, NULL);
+    finish_compile(program);
+    return program;
+}
+
+Program *init_program(const char *parameter_name)
+{
+    Program *program = (Program *)calloc(1, sizeof(Program));
+    if (program == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    program->instructions = NULL;
+    program->instruction_count = 0;
+    program->instruction_capacity = 0;
+    program->results = NULL;
+    program->result_count = 0;
+    program->lookup = NULL;
+    program->lookup_capacity = 0;
+    program->parameter_name = parameter_name;
+    program->parameter = 0;
+    program->accuracy = accuracy_full;
+    program->rational_marks = NULL;
+    program->mark_index = 0;
+    return program;
+}
+
+void finish_compile(Program *program)
+{
+    free(program->lookup);
+    program->lookup = NULL;
+    program->lookup_capacity = 0;
+}
+
+void dispose_program(Program *program)
+{
+    free(program->instructions);
+    free(program->results);
+    free(program->lookup);
+    free(program);
+}
+
+int add_instruction(Program *program, Opcode opcode, int left, int right, double value)
+{
+    // 引数も同じ命令なら結果も同じなので、前の命令の結果を使う。
+    unsigned int mask = program->lookup_capacity - 1;
+    unsigned int slot = hash_instruction(opcode, left, right, value) & mask;
+    while (program->lookup_capacity > 0 && program->lookup[slot] >= 0)
+    {
+        Instruction *found = program->instructions + program->lookup[slot];
+        if (found->opcode == opcode && found->left == left && found->right == right &&
+            memcmp(&found->value, &value, sizeof(double)) == 0)
+        {
+            return program->lookup[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    // 足りなくなったら倍の大きさにする。
+    if (program->instruction_count == program->instruction_capacity)
+    {
+        int capacity = program->instruction_capacity == 0 ? 16 : program->instruction_capacity * 2;
+        Instruction *instructions = (Instruction *)realloc(program->instructions, capacity * sizeof(Instruction));
+        if (instructions == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        program->instructions = instructions;
+        program->instruction_capacity = capacity;
+    }
+    Instruction *instruction = program->instructions + program->instruction_count;
+    instruction->opcode = opcode;
+    instruction->left = left;
+    instruction->right = right;
+    instruction->value = value;
+    insert_lookup(program, program->instruction_count);
+    return program->instruction_count++;
+}
+
+unsigned int hash_instruction(Opcode opcode, int left, int right, double value)
+{
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(double));
+    unsigned long long hash = (unsigned long long)opcode * 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ (unsigned int)left) * 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ (unsigned int)right) * 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ bits) * 0x9e3779b97f4a7c15ULL;
+    return (unsigned int)(hash >> 32);
+}
+
+// 使用率が半分を超えたら、倍の大きさにして登録し直す。
+void insert_lookup(Program *program, int index)
+{
+    int i;
+    if ((index + 1) * 2 > program->lookup_capacity)
+    {
+        int capacity = program->lookup_capacity == 0 ? 64 : program->lookup_capacity * 2;
+        int *lookup = (int *)malloc(sizeof(int) * capacity);
+        if (lookup == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        for (i = 0; i < capacity; i++)
+        {
+            lookup[i] = -1;
+        }
+        free(program->lookup);
+        program->lookup = lookup;
+        program->lookup_capacity = capacity;
+        // 新しい命令以外を登録し直す。
+        for (i = 0; i < index; i++)
+        {
+            insert_lookup(program, i);
+        }
+    }
+    Instruction *instruction = program->instructions + index;
+    unsigned int mask = program->lookup_capacity - 1;
+    unsigned int slot = hash_instruction(instruction->opcode, instruction->left, instruction->right, instruction->value) & mask;
+    while (program->lookup[slot] >= 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    program->lookup[slot] = index;
+}
+
+// 有理式に変換できる部分木は、先に構文木を1回辿って調べておく。
+int compile_tree(Program *program, Node *node)
+{
+    program->rational_marks = mark_rational_subtrees(node, program->parameter_name);
+    program->mark_index = 0;
+    int result = compile_node(program, node);
+    dispose_rational_marks(program->rational_marks);
+    program->rational_marks = NULL;
+    return result;
+}
+
+// calclate()と同じ結果になるように変換する。
+int compile_node(Program *program, Node *node)
+{
+    // 空の式は0として扱う。
+    if (node == NULL)
+    {
+        return add_instruction(program, op_const, -1, -1, 0);
+    }
+    // この節の番号を進める。(子を辿らずに返す場合は、skip_subtree_marks()で部分木の節の番号を飛ばす)
+    program->mark_index++;
+    TokenType type = node->token->type;
+    // 変数の場合
+    if (type == variable)
+    {
+        if (program->parameter_name != NULL && strcmp(node->token->data, program->parameter_name) == 0)
+        {
+            return add_instruction(program, op_param, -1, -1, 0);
+        }
+        return add_instruction(program, op_x, -1, -1, 0);
+    }
+    // 定数の場合
+    if (type == num || type == e || type == pi)
+    {
+        return add_instruction(program, op_const, -1, -1, calclate(0, node));
+    }
+
+    int opcode = get_opcode(node->token);
+    if (opcode < 0)
+    {
+        skip_subtree_marks(program);
+        return add_instruction(program, op_const, -1, -1, 0);
+    }
+    // 多項式(有理式)の部分式は係数を求めて、Horner法で計算する。(累乗を掛け算の繰り返しで計算せず、定数の計算もなくなる)
+    // (有理式に変換できる部分木だけを変換するので、変換する節の数は全体で構文木の節の数以下になる)
+    Rational *rational = program->rational_marks->is_rational[program->mark_index - 1] ? extract_rational(node, program->parameter_name) : NULL;
+    if (rational != NULL)
+    {
+        skip_subtree_marks(program);
+        int result = compile_rational(program, rational);
+        dispose_rational(rational);
+        return result;
+    }
+    // 子がない側は0として計算する。(単項演算子や関数は左辺=0の二項演算として考える)
+    int left = compile_node(program, node->left);
+    int right = compile_node(program, node->right);
+    if (opcode == op_pow)
+    {
+        Instruction *exponent = program->instructions + right;
+        // e^uはexp(u)で計算する。
+        if (node->left != NULL && node->left->token->type == e)
+        {
+            return add_instruction(program, op_exp, -1, right, 0);
+        }
+        // u^n(nは小さい正の整数の定数)は掛け算の繰り返しで計算する。
+        if (exponent->opcode == op_const && exponent->value >= 1 && exponent->value <= MAX_POWI_EXPONENT &&
+            exponent->value == floor(exponent->value))
+        {
+            return add_instruction(program, op_powi, left, -1, exponent->value);
+        }
+    }
+    return add_instruction(program, (Opcode)opcode, left, right, 0);
+}
+
+void skip_subtree_marks(Program *program)
+{
+    int index = program->mark_index - 1;
+    program->mark_index = index + program->rational_marks->subtree_sizes[index];
+}
+
+int compile_rational(Program *program, Rational *rational)
+{
+    int numerator = compile_polynomial(program, rational->numerator);
+    if (rational->denominator->degree == 0)
+    {
+        return numerator;
+    }
+    return add_instruction(program, op_div, numerator, compile_polynomial(program, rational->denominator), 0);
+}
+
+// ((c[n] * x + c[n-1]) * x + ...) * x + c[0] (0の係数は足さない)
+int compile_polynomial(Program *program, Polynomial *polynomial)
+{
+    int x = add_instruction(program, op_x, -1, -1, 0);
+    int result = add_instruction(program, op_const, -1, -1, polynomial->coefficients[polynomial->degree]);
+    int i;
+    for (i = polynomial->degree - 1; i >= 0; i--)
+    {
+        result = add_instruction(program, op_mul, result, x, 0);
+        if (polynomial->coefficients[i] != 0)
+        {
+            result = add_instruction(program, op_add, result, add_instruction(program, op_const, -1, -1, polynomial->coefficients[i]), 0);
+        }
+    }
+    return result;
+}
+
+int get_opcode(Token *token)
+{
+    if (token->type == func)
+    {
+        if (strcmp(token->data, "sin") == 0)
+        {
+            return op_sin;
+        }
+        else if (strcmp(token->data, "cos") == 0)
+        {
+            return op_cos;
+        }
+        else if (strcmp(token->data, "tan") == 0)
+        {
+            return op_tan;
+        }
+        else if (strcmp(token->data, "log") == 0)
+        {
+            return op_log;
+        }
+        else if (strcmp(token->data, "exp") == 0 || *(token->data) == '^')
+        {
+            return op_pow;
+        }
+    }
+    else if (token->type == unary_ope)
+    {
+        // 単項演算子はマイナスしかない。
+        return op_neg;
+    }
+    else if (token->type == bin_ope_times_div)
+    {
+        return *(token->data) == '*' ? op_mul : op_div;
+    }
+    else if (token->type == bin_ope_plus_minus)
+    {
+        return *(token->data) == '+' ? op_add : op_sub;
+    }
+    return -1;
+}
+
+// BATCH_SIZE個ずつに分けて計算する。
+void run_program(Program *program, const double *xs, double *ys, int count)
+{
+    // レジスタ(命令ごとにBATCH_SIZE個の値)
+    double *registers = (double *)malloc(sizeof(double) * BATCH_SIZE * program->instruction_count);
+    if (registers == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int start;
+    for (start = 0; start < count; start += BATCH_SIZE)
+    {
+        int n = count - start < BATCH_SIZE ? count - start : BATCH_SIZE;
+        run_block(program, xs + start, registers, n);
+        memcpy(ys + start, registers + program->result * BATCH_SIZE, sizeof(double) * n);
+    }
+    free(registers);
+}
+
+void run_program_multi(Program *program, const double *xs, double *ys, int count)
+{
+    double *registers = (double *)malloc(sizeof(double) * BATCH_SIZE * program->instruction_count);
+    if (registers == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int start, r;
+    for (start = 0; start < count; start += BATCH_SIZE)
+    {
+        int n = count - start < BATCH_SIZE ? count - start : BATCH_SIZE;
+        run_block(program, xs + start, registers, n);
+        for (r = 0; r < program->result_count; r++)
+        {
+            memcpy(ys + (long long)r * count + start, registers + program->results[r] * BATCH_SIZE, sizeof(double) * n);
+        }
+    }
+    free(registers);
+}
+
+void run_block(Program *program, const double *xs, double *registers, int count)
+{
+    int i;
+    for (i = 0; i < program->instruction_count; i++)
+    {
+        run_instruction(program, i, xs, registers, count);
+    }
+}
+
+void run_instruction(Program *program, int index, const double *xs, double *registers, int count)
+{
+    int j;
+    Instruction *instruction = program->instructions + index;
+    double *out = registers + index * BATCH_SIZE;
+    // 引数がない命令では使わない。
+    double *l = instruction->left < 0 ? NULL : registers + instruction->left * BATCH_SIZE;
+    double *r = instruction->right < 0 ? NULL : registers + instruction->right * BATCH_SIZE;
+    // 命令ごとに、すべての値について同じ演算をする。
+    switch (instruction->opcode)
+    {
+    case op_const:
+        for (j = 0; j < count; j++)
+        {
+            out[j] = instruction->value;
+        }
+        break;
+    case op_x:
+        for (j = 0; j < count; j++)
+        {
+            out[j] = xs[j];
+        }
+        break;
+    case op_param:
+        for (j = 0; j < count; j++)
+        {
+            out[j] = program->parameter;
+        }
+        break;
+    case op_neg:
+        for (j = 0; j < count; j++)
+        {
+            out[j] = -r[j];
+        }
+        break;
+    case op_add:
+        for (j = 0; j < count; j++)
+        {
+            out[j] = l[j] + r[j];
+        }
+        break;
+    case op_sub:
+        for (j = 0; j < count; j++)
+        {
+            out[j] = l[j] - r[j];
+        }
+        break;
+    case op_mul:
+        for (j = 0; j < count; j++)
+        {
+            out[j] = l[j] * r[j];
+        }
+        break;
+    case op_div:
+        for (j = 0; j < count; j++)
+        {
+            out[j] = l[j] / r[j];
+        }
+        break;
+    case op_sin:
+        sin_kernel(r, out, count, program->accuracy);
+        break;
+    case op_cos:
+        cos_kernel(r, out, count, program->accuracy);
+        break;
+    case op_tan:
+        tan_kernel(r, out, count, program->accuracy);
+        break;
+    case op_log:
+        log_kernel(r, out, count, program->accuracy);
+        break;
+    case op_pow:
+        pow_kernel(l, r, out, count, program->accuracy);
+        break;
+    case op_exp:
+        exp_kernel(r, out, count, program->accuracy);
+        break;
+    case op_powi:
+        powi_kernel(l, out, (int)instruction->value, count);
+        break;
+    }
+}
+
+// BATCH_SIZE個ずつに分け、パラメータによらない命令を先に計算してから、パラメータの値ごとに残りの命令を計算する。
+void run_program_family(Program *program, const double *parameters, int member_count, const double *xs, double *ys, int count)
+{
+    double *registers = (double *)malloc(sizeof(double) * BATCH_SIZE * program->instruction_count);
+    if (registers == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    bool *depends = get_parameter_dependency(program);
+    double parameter = program->parameter;
+    int start, i, k;
+    for (start = 0; start < count; start += BATCH_SIZE)
+    {
+        int n = count - start < BATCH_SIZE ? count - start : BATCH_SIZE;
+        for (i = 0; i < program->instruction_count; i++)
+        {
+            if (!depends[i])
+            {
+                run_instruction(program, i, xs + start, registers, n);
+            }
+        }
+        for (k = 0; k < member_count; k++)
+        {
+            program->parameter = parameters[k];
+            for (i = 0; i < program->instruction_count; i++)
+            {
+                if (depends[i])
+                {
+                    run_instruction(program, i, xs + start, registers, n);
+                }
+            }
+            memcpy(ys + (long long)k * count + start, registers + program->result * BATCH_SIZE, sizeof(double) * n);
+        }
+    }
+    program->parameter = parameter;
+    free(depends);
+    free(registers);
+}
+
+bool *get_parameter_dependency(Program *program)
+{
+    bool *depends = (bool *)malloc(sizeof(bool) * (program->instruction_count + 1));
+    if (depends == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    // 引数は必ず前の命令なので、前から順に決まる。
+    int i;
+    for (i = 0; i < program->instruction_count; i++)
+    {
+        Instruction *instruction = program->instructions + i;
+        depends[i] = instruction->opcode == op_param ||
+                     (instruction->left >= 0 && depends[instruction->left]) ||
+                     (instruction->right >= 0 && depends[instruction->right]);
+    }
+    return depends;
+}
+
+void run_program_float(Program *program, const float *xs, float *ys, int count)
+{
+    float *registers = (float *)malloc(sizeof(float) * BATCH_SIZE * program->instruction_count);
+    if (registers == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int start;
+    for (start = 0; start < count; start += BATCH_SIZE)
+    {
+        int n = count - start < BATCH_SIZE ? count - start : BATCH_SIZE;
+        run_block_float(program, xs + start, registers, n);
+        memcpy(ys + start, registers + program->result * BATCH_SIZE, sizeof(float) * n);
+    }
+    free(registers);
+}
+
+// run_block()のfloat版
+void run_block_float(Program *program, const float *xs, float *registers, int count)
+{
+    int i, j;
+    for (i = 0; i < program->instruction_count; i++)
+    {
+        Instruction *instruction = program->instructions + i;
+        float *out = registers + i * BATCH_SIZE;
+        float *l = instruction->left < 0 ? NULL : registers + instruction->left * BATCH_SIZE;
+        float *r = instruction->right < 0 ? NULL : registers + instruction->right * BATCH_SIZE;
+        switch (instruction->opcode)
+        {
+        case op_const:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = (float)instruction->value;
+            }
+            break;
+        case op_x:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = xs[j];
+            }
+            break;
+        case op_param:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = (float)program->parameter;
+            }
+            break;
+        case op_neg:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = -r[j];
+            }
+            break;
+        case op_add:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = l[j] + r[j];
+            }
+            break;
+        case op_sub:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = l[j] - r[j];
+            }
+            break;
+        case op_mul:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = l[j] * r[j];
+            }
+            break;
+        case op_div:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = l[j] / r[j];
+            }
+            break;
+        case op_sin:
+            sin_kernel_float(r, out, count, program->accuracy);
+            break;
+        case op_cos:
+            cos_kernel_float(r, out, count, program->accuracy);
+            break;
+        case op_tan:
+            tan_kernel_float(r, out, count, program->accuracy);
+            break;
+        case op_log:
+            log_kernel_float(r, out, count, program->accuracy);
+            break;
+        case op_pow:
+            pow_kernel_float(l, r, out, count, program->accuracy);
+            break;
+        case op_exp:
+            exp_kernel_float(r, out, count, program->accuracy);
+            break;
+        case op_powi:
+            powi_kernel_float(l, out, (int)instruction->value, count);
+            break;
+        }
+    }
+}
+
+void run_program_dual(Program *program, const double *xs, double *values, double *derivatives, int count)
+{
+    // 値のレジスタと微分係数のレジスタ
+    double *registers = (double *)malloc(sizeof(double) * BATCH_SIZE * program->instruction_count * 2);
+    if (registers == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    double *derivative_registers = registers + BATCH_SIZE * program->instruction_count;
+    int start;
+    for (start = 0; start < count; start += BATCH_SIZE)
+    {
+        int n = count - start < BATCH_SIZE ? count - start : BATCH_SIZE;
+        run_block_dual(program, xs + start, registers, derivative_registers, n);
+        memcpy(values + start, registers + program->result * BATCH_SIZE, sizeof(double) * n);
+        memcpy(derivatives + start, derivative_registers + program->result * BATCH_SIZE, sizeof(double) * n);
+    }
+    free(registers);
+}
+
+// 微分の規則はcalclator.cの二重数用の計算機と同じ。
+void run_block_dual(Program *program, const double *xs, double *values, double *derivatives, int count)
+{
+    int i, j;
+    for (i = 0; i < program->instruction_count; i++)
+    {
+        Instruction *instruction = program->instructions + i;
+        double *out = values + i * BATCH_SIZE;
+        double *dout = derivatives + i * BATCH_SIZE;
+        // 引数がない命令では使わない。
+        double *l = instruction->left < 0 ? NULL : values + instruction->left * BATCH_SIZE;
+        double *r = instruction->right < 0 ? NULL : values + instruction->right * BATCH_SIZE;
+        double *dl = instruction->left < 0 ? NULL : derivatives + instruction->left * BATCH_SIZE;
+        double *dr = instruction->right < 0 ? NULL : derivatives + instruction->right * BATCH_SIZE;
+        switch (instruction->opcode)
+        {
+        case op_const:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = instruction->value;
+                dout[j] = 0;
+            }
+            break;
+        case op_x:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = xs[j];
+                dout[j] = 1;
+            }
+            break;
+        case op_param:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = program->parameter;
+                dout[j] = 0;
+            }
+            break;
+        case op_neg:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = -r[j];
+                dout[j] = -dr[j];
+            }
+            break;
+        case op_add:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = l[j] + r[j];
+                dout[j] = dl[j] + dr[j];
+            }
+            break;
+        case op_sub:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = l[j] - r[j];
+                dout[j] = dl[j] - dr[j];
+            }
+            break;
+        case op_mul:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = l[j] * r[j];
+                dout[j] = dl[j] * r[j] + l[j] * dr[j];
+            }
+            break;
+        case op_div:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = l[j] / r[j];
+                dout[j] = (dl[j] * r[j] - l[j] * dr[j]) / (r[j] * r[j]);
+            }
+            break;
+        case op_sin:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = sin(r[j]);
+                dout[j] = cos(r[j]) * dr[j];
+            }
+            break;
+        case op_cos:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = cos(r[j]);
+                dout[j] = -sin(r[j]) * dr[j];
+            }
+            break;
+        case op_tan:
+            for (j = 0; j < count; j++)
+            {
+                double c = cos(r[j]);
+                out[j] = tan(r[j]);
+                dout[j] = dr[j] / (c * c);
+            }
+            break;
+        case op_log:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = log(r[j]);
+                dout[j] = dr[j] / r[j];
+            }
+            break;
+        case op_pow:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = pow(l[j], r[j]);
+                // 指数が定数の場合は (u^n)' = n * u^(n-1) * u'
+                if (dr[j] == 0)
+                {
+                    dout[j] = dl[j] == 0 ? 0 : r[j] * pow(l[j], r[j] - 1) * dl[j];
+                }
+                // (u^v)' = u^v * (v' * log(u) + v * u' / u)
+                else
+                {
+                    dout[j] = out[j] * (dr[j] * log(l[j]) + r[j] * dl[j] / l[j]);
+                }
+            }
+            break;
+        case op_exp:
+            for (j = 0; j < count; j++)
+            {
+                out[j] = exp(r[j]);
+                dout[j] = out[j] * dr[j];
+            }
+            break;
+        case op_powi:
+            powi_kernel(l, out, (int)instruction->value, count);
+            // (u^n)' = n * u^(n-1) * u'
+            if (instruction->value == 1)
+            {
+                memcpy(dout, dl, sizeof(double) * count);
+                break;
+            }
+            powi_kernel(l, dout, (int)instruction->value - 1, count);
+            for (j = 0; j < count; j++)
+            {
+                dout[j] *= instruction->value * dl[j];
+            }
+            break;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#ifndef PROGRAM
+#define PROGRAM
+#include "parser.h"
+#include "fast_math.h"
+
+// 一度にまとめて計算する値の数
+#define BATCH_SIZE 256
+// 掛け算の繰り返しで計算する整数乗の指数の上限
+#define MAX_POWI_EXPONENT 64
+
+// 命令の種類
+typedef enum opcode
+{
+    op_const, // 定数
+    op_x,     // 変数x
+    op_neg,   // 符号反転
+    op_add,   // 加算
+    op_sub,   // 減算
+    op_mul,   // 乗算
+    op_div,   // 除算
+    op_sin,   // 三角関数
+    op_cos,
+    op_tan,
+    op_log, // 自然対数
+    op_pow, // べき乗
+    op_exp, // eのべき乗
+    op_powi, // 正の整数の定数乗(指数はvalueに入る)
+    op_param, // パラメータ(x以外の名前の変数。値はProgramのparameterに入る)
+} Opcode;
+
+// 命令
+typedef struct instruction
+{
+    Opcode opcode;
+    // 引数となる命令の番号(使わない場合は-1)
+    int left;
+    int right;
+    // 定数の値(op_constの場合), 指数(op_powiの場合)
+    double value;
+} Instruction;
+
+// 構文木を命令の列に変換したもの
+// i番目の命令の結果はi番目のレジスタに入り、後ろの命令はそれより前の命令の結果だけを使う。
+// 多数のxについて、命令ごとにまとめて計算できる(配列の演算になるのでSIMD化されやすい)。
+typedef struct program
+{
+    Instruction *instructions;
+    int instruction_count;
+    int instruction_capacity;
+    // 式の値が入る命令の番号
+    int result;
+    // compile_programs()で複数の式をまとめた場合の、各式の値が入る命令の番号(それ以外はNULL)
+    int *results;
+    int result_count;
+    // コンパイル中に同じ命令を探すためのハッシュ表(空きは-1。コンパイル後はNULL)
+    int *lookup;
+    int lookup_capacity;
+    // 超越関数の計算精度(compile_program()直後はaccuracy_full)
+    Accuracy accuracy;
+    // op_paramに変換する変数の名前(NULLなら、すべての変数をxとして扱う)
+    const char *parameter_name;
+    // op_paramの値(compile_program_with_parameter()直後は0)
+    double parameter;
+    // コンパイル中の構文木の、有理式に変換できる部分木の印(コンパイル後はNULL)
+    struct rational_marks *rational_marks;
+    // 次に変換する節の、構文木での前順の番号
+    int mark_index;
+} Program;
+
+// 構文木をプログラムに変換する。(同じ部分式は1回だけ計算する)
+Program *compile_program(Node *node);
+// 複数の構文木を1つのプログラムに変換する。(式の間で共通の部分式も1回だけ計算する)
+Program *compile_programs(Node **nodes, int count);
+// 構文木をプログラムに変換する。parameter_nameという名前の変数は、xではなくパラメータとして扱う。
+Program *compile_program_with_parameter(Node *node, const char *parameter_name);
+// プログラムを開放する。
+void dispose_program(Program *program);
+// count個のxについて一括で計算し、ysに書き込む。
+void run_program(Program *program, const double *xs, double *ys, int count);
+// count個のxについてfloatで一括計算する。(グラフの描画用。doubleの半分の大きさなので、SIMDで倍の数をまとめて計算できる)
+void run_program_float(Program *program, const float *xs, float *ys, int count);
+// compile_programs()で変換したプログラムで、count個のxについてすべての式を一括で計算する。(r番目の式の結果はys[r * count + i])
+void run_program_multi(Program *program, const double *xs, double *ys, int count);
+// パラメータの値をmember_count通りに変えて、それぞれcount個のxについて一括で計算する。(k番目の値の結果はys[k * count + i])
+// パラメータによらない命令は、すべての値で共通に1回だけ計算する。
+void run_program_family(Program *program, const double *parameters, int member_count, const double *xs, double *ys, int count);
+// count個のxについて値と微分係数を一括で計算する。(前進型の自動微分)
+void run_program_dual(Program *program, const double *xs, double *values, double *derivatives, int count);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,602 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "lexer.h"
+#include "parser.h"
+#include "program.h"
+#include "graph_writer.h"
+#include "graph_library.h"
+#include "export_target.h"
+#include "regression_check.h"
+
+// 1つの画像を描画する回数(最も速かった回の時間を使い、他の処理による揺らぎを減らす)
+#define CHECK_REPEAT_COUNT 5
+// 基準との差がこの時間[ms]以下なら、比が大きくても遅くなったとはみなさない。(短い処理の揺らぎで失敗しないように)
+#define MIN_TIME_DIFFERENCE 1.0
+// 長い式の字句解析・構文解析・コンパイルで、これより時間[秒]がかかりそうな大きさは測定しない。
+#define SCALING_TIME_LIMIT 1.0
+// 長い式の測定で、この時間[ms]より速い場合は繰り返して最も速かった回の時間を使う。
+#define SCALING_REPEAT_LIMIT 50.0
+// 長い式の測定を行うスレッドのスタックの大きさ[バイト](構文木が深い式でも再帰呼び出しで溢れないように)
+#define SCALING_STACK_SIZE (512LL << 20)
+// 項目名の最大長
+#define MAX_CHECK_NAME_LENGTH 64
+// 1つの画像に描画する式の最大数
+#define MAX_CHECK_EXPRESSIONS 8
+
+// 画像の描画方法
+typedef enum check_kind
+{
+    // 式ごとにコンパイルして描画する
+    check_compiled,
+    // 複数の式を段階的に描画する(最後の段階は、すべての式を1つのプログラムにまとめて描画したものと同じ)
+    check_progressive,
+    // パラメータの族
+    check_family,
+    // 陰関数
+    check_implicit,
+    // 帯ごとに描画して書き出す
+    check_tiled,
+} CheckKind;
+
+// 回帰を調べる画像1枚分の描画内容
+typedef struct check_image
+{
+    const char *name;
+    CheckKind kind;
+    Accuracy accuracy;
+    const char *expressions[MAX_CHECK_EXPRESSIONS];
+    int count;
+    // パラメータの族の場合の、パラメータの名前と範囲、グラフの数
+    const char *parameter_name;
+    double start;
+    double end;
+    int family_count;
+} CheckImage;
+
+// 1つの項目の結果(画像のハッシュ値の基準ファイルや時間の基準ファイルの1行)
+typedef struct check_result
+{
+    char name[MAX_CHECK_NAME_LENGTH];
+    // 画像のハッシュ値(画像を出力しない項目はhas_hashがfalse)
+    bool has_hash;
+    unsigned long long hash;
+    // 処理時間[ms](時間がかかりすぎるため測定しなかった場合は負)
+    double time;
+} CheckResult;
+
+typedef struct check_results
+{
+    CheckResult *items;
+    int count;
+    int capacity;
+} CheckResults;
+
+// 結果を追加する。
+void add_check_result(CheckResults *results, const char *name, bool has_hash, unsigned long long hash, double time);
+// 名前が一致する結果を探す。(なければNULL)
+CheckResult *find_check_result(CheckResults *results, const char *name);
+// 基準ファイルを読み込む。(開けなければfalse)
+bool read_baseline(const char *path, CheckResults *results);
+// 基準ファイルを書き込む。with_hashがtrueなら画像のハッシュ値だけを、falseなら時間だけを書く。(開けなければfalse)
+bool write_baseline(const char *path, CheckResults *results, bool with_hash);
+// 固定の画像をすべて描画し、ハッシュ値と時間を求める。
+void check_images(CheckResults *results);
+// 画像を1回描画して、BMPとしてbufferに書き出す。
+void render_check_image(CheckImage *image, unsigned char *buffer, long long size);
+// 長い式の字句解析・構文解析とコンパイルの時間を求める。(大きなスタックを持つスレッドで実行する。argはCheckResults)
+void *check_scaling(void *arg);
+// 処理(stage)と式の形ごとに、大きさを10倍ずつ増やしながら長い式の処理時間をmeasureで求める。
+void check_scaling_shape(CheckResults *results, const char *stage, const char *shape, bool is_nested,
+                         double (*measure)(const char *expression, int length));
+// 約token_count個のトークンからなる式を生成する。(is_nestedがtrueなら括弧で平衡させた式、falseなら括弧のない長い式)
+char *generate_scaling_expression(int token_count, bool is_nested);
+// 括弧で平衡させた式をbufferに書き込み、書き込んだ文字数を返す。
+int write_nested_expression(char *buffer, int token_count, int depth);
+// 字句解析・構文解析・構文木の開放の時間[ms]を求める。
+double measure_parse(const char *expression, int length);
+// 構文木のコンパイルとプログラムの開放の時間[ms]を求める。(字句解析・構文解析の時間は含めない)
+double measure_compile(const char *expression, int length);
+// 画像のハッシュ値の基準goldenと時間の基準baselineと比べた結果を表示し、失敗ならtrueを返す。
+// check_hashがfalseなら画像のハッシュ値は比べない。(goldenとbaselineは、基準がなければNULL)
+bool compare_check_result(CheckResult *result, CheckResult *golden, CheckResult *baseline, bool check_hash, double threshold);
+// データのハッシュ値(64ビットのFNV-1a)を求める。
+unsigned long long hash_bytes(const unsigned char *data, long long size);
+// 現在の時刻[ms]を返す。
+double get_check_milliseconds();
+
+// 画像のハッシュ値は計算機によらない(-ffp-contract=offでコンパイルした場合)のでリポジトリに含め、時間は計算機ごとに別のファイルに記録する。
+int run_regression_check(const char *golden_path, const char *baseline_path, bool update_golden, bool update_baseline, double threshold)
+{
+    CheckResults results = {NULL, 0, 0};
+    CheckResults golden = {NULL, 0, 0};
+    CheckResults baseline = {NULL, 0, 0};
+    bool has_golden = !update_golden && read_baseline(golden_path, &golden);
+    bool has_baseline = !update_baseline && read_baseline(baseline_path, &baseline);
+    if (!update_golden && !has_golden)
+    {
+        printf("画像のハッシュ値の基準ファイル(%s)がありません。(-gで記録します)\n", golden_path);
+    }
+
+    check_images(&results);
+    // 構文木が深い式では再帰呼び出しが深くなるので、スタックの大きいスレッドで測定する。
+    pthread_t thread;
+    pthread_attr_t attribute;
+    pthread_attr_init(&attribute);
+    pthread_attr_setstacksize(&attribute, SCALING_STACK_SIZE);
+    if (pthread_create(&thread, &attribute, check_scaling, &results) != 0)
+    {
+        perror("スレッドを生成できませんでした。\n");
+        exit(-1);
+    }
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attribute);
+
+    printf("%-28s %18s %12s %12s %8s  %s\n", "項目", "ハッシュ値", "時間[ms]", "基準[ms]", "比", "結果");
+    int failure_count = 0;
+    int i;
+    for (i = 0; i < results.count; i++)
+    {
+        CheckResult *golden_result = has_golden ? find_check_result(&golden, results.items[i].name) : NULL;
+        CheckResult *reference = has_baseline ? find_check_result(&baseline, results.items[i].name) : NULL;
+        if (compare_check_result(results.items + i, golden_result, reference, !update_golden, threshold))
+        {
+            failure_count++;
+        }
+    }
+
+    const char *paths[2] = {golden_path, baseline_path};
+    bool is_recorded[2] = {update_golden, !has_baseline};
+    int k;
+    for (k = 0; k < 2; k++)
+    {
+        if (!is_recorded[k])
+        {
+            continue;
+        }
+        if (!write_baseline(paths[k], &results, k == 0))
+        {
+            perror("ファイルを開けませんでした。\n");
+            printf("ファイル名: %s\n", paths[k]);
+            failure_count++;
+        }
+        else
+        {
+            printf("%sを基準として%sに記録しました。\n", k == 0 ? "画像のハッシュ値" : "時間", paths[k]);
+        }
+    }
+    if (failure_count == 0)
+    {
+        printf("%d項目すべて基準どおりです。(許容する遅れ: %.0f%%)\n", results.count, threshold * 100);
+    }
+    else
+    {
+        printf("%d項目が基準と異なるか、遅くなりました。(許容する遅れ: %.0f%%)\n", failure_count, threshold * 100);
+    }
+    free(results.items);
+    free(golden.items);
+    free(baseline.items);
+    return failure_count;
+}
+
+// 足りなくなったら倍の大きさにする。
+void add_check_result(CheckResults *results, const char *name, bool has_hash, unsigned long long hash, double time)
+{
+    if (results->count == results->capacity)
+    {
+        int capacity = results->capacity == 0 ? 32 : results->capacity * 2;
+        CheckResult *items = (CheckResult *)realloc(results->items, sizeof(CheckResult) * capacity);
+        if (items == NULL)
+        {
+            perror("メモリ確保エラー");
+            exit(-1);
+        }
+        results->items = items;
+        results->capacity = capacity;
+    }
+    CheckResult *result = results->items + results->count++;
+    strncpy(result->name, name, MAX_CHECK_NAME_LENGTH - 1);
+    result->name[MAX_CHECK_NAME_LENGTH - 1] = '\0';
+    result->has_hash = has_hash;
+    result->hash = hash;
+    result->time = time;
+}
+
+CheckResult *find_check_result(CheckResults *results, const char *name)
+{
+    int i;
+    for (i = 0; i < results->count; i++)
+    {
+        if (strcmp(results->items[i].name, name) == 0)
+        {
+            return results->items + i;
+        }
+    }
+    return NULL;
+}
+
+// 1行に「項目名 ハッシュ値(16進数) 時間[ms]」を書く。ハッシュ値と時間がない場合は「-」。#で始まる行は読み飛ばす。
+// (画像のハッシュ値の基準ファイルは時間を、時間の基準ファイルはハッシュ値を、すべて「-」にする)
+bool read_baseline(const char *path, CheckResults *results)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        char name[MAX_CHECK_NAME_LENGTH];
+        char hash[32];
+        char time[32];
+        if (line[0] == '#' || sscanf(line, "%63s %31s %31s", name, hash, time) != 3)
+        {
+            continue;
+        }
+        bool has_hash = strcmp(hash, "-") != 0;
+        add_check_result(results, name, has_hash, has_hash ? strtoull(hash, NULL, 16) : 0,
+                         strcmp(time, "-") == 0 ? -1 : atof(time));
+    }
+    fclose(fp);
+    return true;
+}
+
+bool write_baseline(const char *path, CheckResults *results, bool with_hash)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL)
+    {
+        return false;
+    }
+    if (with_hash)
+    {
+        fprintf(fp, "# 項目名 画像(BMPファイル全体)のハッシュ値 -\n");
+        fprintf(fp, "# -ffp-contract=offでコンパイルすれば計算機によらない値なので、リポジトリに含める。出力を意図して変えた場合は --check -g で記録し直す。\n");
+    }
+    else
+    {
+        fprintf(fp, "# 項目名 - 時間[ms]\n");
+        fprintf(fp, "# 計算機ごとに異なるので、変更前のプログラムを同じ計算機で実行して記録する。\n");
+    }
+    int i;
+    for (i = 0; i < results->count; i++)
+    {
+        CheckResult *result = results->items + i;
+        if (with_hash && result->has_hash)
+        {
+            fprintf(fp, "%s %016llx -\n", result->name, result->hash);
+        }
+        else if (!with_hash && result->time >= 0)
+        {
+            fprintf(fp, "%s - %.3f\n", result->name, result->time);
+        }
+        else if (!with_hash)
+        {
+            fprintf(fp, "%s - -\n", result->name);
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+// 画像はBMPとしてメモリに書き出し、ヘッダを含むファイル全体のハッシュ値を求める。
+void check_images(CheckResults *results)
+{
+    CheckImage images[] = {
+        {.name = "axis", .kind = check_compiled, .accuracy = accuracy_full},
+        {.name = "graphs_full", .kind = check_compiled, .accuracy = accuracy_full,
+         .expressions = {"sin(2*x)+2*sin(x)", "x^2/(x-1)", "e^(-x^2/2)"}, .count = 3},
+        {.name = "graphs_fast", .kind = check_compiled, .accuracy = accuracy_fast,
+         .expressions = {"sin(2*x)+2*sin(x)", "x^2/(x-1)", "e^(-x^2/2)"}, .count = 3},
+        {.name = "rational", .kind = check_compiled, .accuracy = accuracy_full,
+         .expressions = {"(x^3+10*x^2-10)/(x^2+1)", "x^3-4*x^2+13/4*x-3/4", "1/(x^2-4)"}, .count = 3},
+        {.name = "transcendental", .kind = check_compiled, .accuracy = accuracy_full,
+         .expressions = {"tan(x)", "log(x^2+1)", "sin(x^2)+pi", "cos(1/x)"}, .count = 4},
+        {.name = "high_frequency", .kind = check_compiled, .accuracy = accuracy_full,
+         .expressions = {"sin(50*x)", "3*cos(37*x)*sin(x)"}, .count = 2},
+        {.name = "progressive", .kind = check_progressive, .accuracy = accuracy_full,
+         .expressions = {"sin(x)", "cos(x)", "x^2/4", "log(x^2)", "tan(x/2)", "-x^3/8", "e^(x/2)", "sin(3*x)*2"}, .count = 8},
+        {.name = "family", .kind = check_family, .accuracy = accuracy_full, .expressions = {"sin(a*x)*a/4"}, .count = 1,
+         .parameter_name = "a", .start = 1, .end = 8, .family_count = 64},
+        {.name = "family_dense", .kind = check_family, .accuracy = accuracy_fast, .expressions = {"a*x^2-a"}, .count = 1,
+         .parameter_name = "a", .start = -4, .end = 4, .family_count = 256},
+        {.name = "implicit", .kind = check_implicit, .accuracy = accuracy_full,
+         .expressions = {"x^2+y^2=16", "sin(x)=cos(y)", "x*y=1"}, .count = 3},
+        {.name = "tiled", .kind = check_tiled, .accuracy = accuracy_full,
+         .expressions = {"sin(2*x)+2*sin(x)", "x^2/(x-1)", "e^(-x^2/2)", "2*x+1"}, .count = 4},
+    };
+    int image_count = sizeof(images) / sizeof(images[0]);
+    long long size = get_bmp_file_size();
+    unsigned char *buffer = (unsigned char *)malloc(size);
+    if (buffer == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    int i, j;
+    for (i = 0; i < image_count; i++)
+    {
+        double best = -1;
+        for (j = 0; j < CHECK_REPEAT_COUNT; j++)
+        {
+            double start = get_check_milliseconds();
+            render_check_image(images + i, buffer, size);
+            double time = get_check_milliseconds() - start;
+            if (best < 0 || time < best)
+            {
+                best = time;
+            }
+        }
+        char name[MAX_CHECK_NAME_LENGTH];
+        snprintf(name, sizeof(name), "image_%s", images[i].name);
+        add_check_result(results, name, true, hash_bytes(buffer, size), best);
+    }
+    free(buffer);
+}
+
+// 描画の時間には、式のコンパイルとBMPの書き出しも含める。
+void render_check_image(CheckImage *image, unsigned char *buffer, long long size)
+{
+    Pixel colors[MAX_CHECK_EXPRESSIONS] = {
+        {255, 0, 0}, {0, 160, 0}, {0, 0, 255}, {200, 120, 0}, {160, 0, 160}, {0, 160, 160}, {90, 90, 90}, {0, 0, 0}};
+    int i;
+    if (image->kind == check_tiled)
+    {
+        TiledGraph *tiled_graph = init_tiled_graph(64);
+        set_tiled_graph_accuracy(tiled_graph, image->accuracy);
+        add_axis(tiled_graph);
+        add_graph_expressions(tiled_graph, colors, (char **)image->expressions, image->count);
+        ExportTarget *target = init_memory_target(buffer, size);
+        export_tiled_graph_to_target(tiled_graph, target);
+        close_export_target(target);
+        dispose_tiled_graph(tiled_graph);
+        return;
+    }
+
+    GraphContext *context = create_graph_context();
+    set_graph_context_accuracy(context, image->accuracy);
+    render_axis(context);
+    if (image->kind == check_compiled)
+    {
+        for (i = 0; i < image->count; i++)
+        {
+            GraphExpression *expression = compile_graph_expression(image->expressions[i], image->accuracy);
+            render_graph_expression(context, expression, colors[i]);
+            dispose_graph_expression(expression);
+        }
+    }
+    else if (image->kind == check_progressive)
+    {
+        render_graph_progressive(context, (char **)image->expressions, colors, image->count, NULL, NULL);
+    }
+    else if (image->kind == check_family)
+    {
+        GraphFamily family = {(char *)image->parameter_name, image->start, image->end, image->family_count, colors[0], colors[2]};
+        render_graph_family(context, &family, image->expressions[0]);
+    }
+    else
+    {
+        for (i = 0; i < image->count; i++)
+        {
+            render_graph_implicit(context, colors[i], image->expressions[i]);
+        }
+    }
+    export_graph_context_to_memory(context, buffer, size);
+    dispose_graph_context(context);
+}
+
+void *check_scaling(void *arg)
+{
+    CheckResults *results = (CheckResults *)arg;
+    check_scaling_shape(results, "parse", "flat", false, measure_parse);
+    check_scaling_shape(results, "parse", "nested", true, measure_parse);
+    check_scaling_shape(results, "compile", "flat", false, measure_compile);
+    check_scaling_shape(results, "compile", "nested", true, measure_compile);
+    return NULL;
+}
+
+// 直前の2つの大きさの時間の増え方(トークン数の1乗から2乗の間とする)で次の時間を見積もり、長すぎる場合はそれ以降を測定しない。
+void check_scaling_shape(CheckResults *results, const char *stage, const char *shape, bool is_nested,
+                         double (*measure)(const char *expression, int length))
+{
+    int token_count;
+    double previous_time = -1;
+    int previous_count = 0;
+    // 時間がトークン数の何乗に比例して増えているか
+    double exponent = 2;
+    // 1000トークンの時の1トークンあたりの時間(大きな式での比を表示する)
+    double base_time_per_token = -1;
+    for (token_count = 10; token_count <= 1000000; token_count *= 10)
+    {
+        char name[MAX_CHECK_NAME_LENGTH];
+        snprintf(name, sizeof(name), "%s_%s_%d", stage, shape, token_count);
+        if ((previous_time < 0 && previous_count > 0) ||
+            (previous_time >= 0 && previous_time * pow((double)token_count / previous_count, exponent) > SCALING_TIME_LIMIT * 1000))
+        {
+            add_check_result(results, name, false, 0, -1);
+            previous_time = -1;
+            continue;
+        }
+        char *expression = generate_scaling_expression(token_count, is_nested);
+        int length = strlen(expression);
+        double best = measure(expression, length);
+        int repeat;
+        for (repeat = 1; repeat < CHECK_REPEAT_COUNT && best < SCALING_REPEAT_LIMIT; repeat++)
+        {
+            double time = measure(expression, length);
+            best = time < best ? time : best;
+        }
+        free(expression);
+        add_check_result(results, name, false, 0, best);
+        if (token_count == 1000)
+        {
+            base_time_per_token = best / token_count;
+        }
+        else if (token_count > 1000 && base_time_per_token > 0)
+        {
+            printf("%s_%s: %dトークンの1トークンあたりの時間は、1000トークンの%.1f倍\n", stage, shape, token_count, best / token_count / base_time_per_token);
+        }
+        // 短すぎる時間は揺らぎが大きいので、増え方の見積もりに使わない。
+        if (previous_time > SCALING_REPEAT_LIMIT / 100 && best > previous_time)
+        {
+            exponent = fmin(2, fmax(1, log(best / previous_time) / log((double)token_count / previous_count)));
+        }
+        previous_time = best;
+        previous_count = token_count;
+    }
+}
+
+// 括弧のない式は、演算子と関数を混ぜた「x+x*x-sin(x)*2...」の形にする。(左結合の長い鎖になる)
+char *generate_scaling_expression(int token_count, bool is_nested)
+{
+    // 1トークンあたり最大3文字(sin)
+    char *buffer = (char *)malloc(token_count * 3 + 16);
+    if (buffer == NULL)
+    {
+        perror("メモリ確保エラー");
+        exit(-1);
+    }
+    if (is_nested)
+    {
+        write_nested_expression(buffer, token_count, 0);
+        return buffer;
+    }
+    const char *units[] = {"+x", "*x", "-sin(x)", "*2"};
+    int unit_tokens[] = {2, 2, 5, 2};
+    int length = sprintf(buffer, "x");
+    int count = 1;
+    int i;
+    for (i = 0; count + unit_tokens[i % 4] <= token_count; i++)
+    {
+        length += sprintf(buffer + length, "%s", units[i % 4]);
+        count += unit_tokens[i % 4];
+    }
+    return buffer;
+}
+
+// 「(左 演算子 右)」の左右にトークンを半分ずつ分けるので、構文木の深さはトークン数の対数程度になる。
+int write_nested_expression(char *buffer, int token_count, int depth)
+{
+    if (token_count < 5)
+    {
+        buffer[0] = 'x';
+        buffer[1] = '\0';
+        return 1;
+    }
+    const char operators[] = {'+', '*', '-', '/'};
+    int left_count = (token_count - 3) / 2;
+    int length = 0;
+    buffer[length++] = '(';
+    length += write_nested_expression(buffer + length, left_count, depth + 1);
+    buffer[length++] = operators[depth % 4];
+    length += write_nested_expression(buffer + length, token_count - 3 - left_count, depth + 1);
+    buffer[length++] = ')';
+    buffer[length] = '\0';
+    return length;
+}
+
+double measure_parse(const char *expression, int length)
+{
+    double start = get_check_milliseconds();
+    Token *tokens = lexical_range(expression, length);
+    Node *node = parse(tokens);
+    if (node != NULL)
+    {
+        dispose_tree(node);
+    }
+    return get_check_milliseconds() - start;
+}
+
+double measure_compile(const char *expression, int length)
+{
+    Node *node = parse(lexical_range(expression, length));
+    double start = get_check_milliseconds();
+    dispose_program(compile_program(node));
+    double time = get_check_milliseconds() - start;
+    if (node != NULL)
+    {
+        dispose_tree(node);
+    }
+    return time;
+}
+
+bool compare_check_result(CheckResult *result, CheckResult *golden, CheckResult *baseline, bool check_hash, double threshold)
+{
+    char hash[32] = "-";
+    if (result->has_hash)
+    {
+        snprintf(hash, sizeof(hash), "%016llx", result->hash);
+    }
+    char time[32] = "-";
+    if (result->time >= 0)
+    {
+        snprintf(time, sizeof(time), "%.3f", result->time);
+    }
+    char reference_time[32] = "-";
+    char ratio[32] = "-";
+    if (baseline != NULL && baseline->time >= 0)
+    {
+        snprintf(reference_time, sizeof(reference_time), "%.3f", baseline->time);
+        if (result->time >= 0 && baseline->time > 0)
+        {
+            snprintf(ratio, sizeof(ratio), "%.2f", result->time / baseline->time);
+        }
+    }
+
+    const char *message = "OK";
+    bool is_failed = false;
+    if (check_hash && result->has_hash && (golden == NULL || !golden->has_hash))
+    {
+        message = "失敗(画像の基準がない)";
+        is_failed = true;
+    }
+    else if (check_hash && result->has_hash && result->hash != golden->hash)
+    {
+        message = "失敗(画像が基準と異なる)";
+        is_failed = true;
+    }
+    else if (baseline == NULL)
+    {
+        message = "記録";
+    }
+    else if (baseline->time >= 0 && result->time < 0)
+    {
+        message = "失敗(時間がかかりすぎるため測定せず)";
+        is_failed = true;
+    }
+    else if (baseline->time >= 0 && result->time > baseline->time * (1 + threshold) &&
+             result->time - baseline->time > MIN_TIME_DIFFERENCE)
+    {
+        message = "失敗(遅くなった)";
+        is_failed = true;
+    }
+    else if (baseline->time < 0 && result->time >= 0)
+    {
+        message = "OK(測定できるようになった)";
+    }
+    printf("%-28s %18s %12s %12s %8s  %s\n", result->name, hash, time, reference_time, ratio, message);
+    return is_failed;
+}
+
+unsigned long long hash_bytes(const unsigned char *data, long long size)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    long long i;
+    for (i = 0; i < size; i++)
+    {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+double get_check_milliseconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec * 1.0e-6;
+}
\ No newline at end of file
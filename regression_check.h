@@ -0,0 +1,13 @@
+#ifndef REGRESSION_CHECK
+#define REGRESSION_CHECK
+#include <stdbool.h>
+
+// 出力と性能の回帰を調べる。(対話的な入力もネットワークも使わない)
+// 固定の式の集合を描画したBMPのハッシュ値と処理時間、生成した長い式(10から1,000,000トークン)の字句解析・構文解析とコンパイルの時間を求める。
+// ハッシュ値はgolden_path(リポジトリに含める)に、時間はbaseline_path(計算機ごとに記録する)に記録したものと比べ、
+// 画像が基準と異なるか基準がない項目と、処理時間が基準の(1 + threshold)倍を超えた項目を失敗とする。
+// update_goldenがtrueの場合はハッシュ値を、時間の基準ファイルがない場合とupdate_baselineがtrueの場合は時間を、今回の結果で記録する。
+// 失敗した項目の数を返す。
+int run_regression_check(const char *golden_path, const char *baseline_path, bool update_golden, bool update_baseline, double threshold);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,396 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <stdbool.h>
+#include "root_finder.h"
+
+// 既定の許容誤差
+#define DEFAULT_TOLERANCE 1.0e-10
+// 既定の反復回数の上限
+#define DEFAULT_MAX_ITER_COUNT 100
+// ニュートン法・ハレー法で、|f(x)|が増えた時に歩幅を半分にする回数の上限
+#define MAX_DAMPING_COUNT 30
+// ブレント法で符号の変わる区間を探す時に、探す範囲を広げる回数の上限
+#define MAX_BRACKET_SEARCH_COUNT 60
+
+// 関数を計算しながら反復を進める状態
+typedef struct root_state
+{
+    RootFunction function;
+    void *userdata;
+    RootOptions *options;
+    RootResult result;
+} RootState;
+
+// 関数の値とorder階までの微分係数を求め、計算回数を数える。
+void evaluate_root_function(RootState *state, double x, int order, double *values);
+// 反復ごとの関数を呼ぶ。
+void notify_root_observer(RootState *state, int iteration, double x, double fx, double slope);
+// 収束したかを調べる。(x_tolerance > 0の場合は近似解の変化dxも見る)
+bool is_root_converged(RootOptions *options, double fx, double dx);
+// ニュートン法(order == 1)・ハレー法(order == 2)で解を求める。
+void find_root_newton(RootState *state, double x0, int order);
+// 割線法で解を求める。
+void find_root_secant(RootState *state, double x0);
+// ブレント法で解を求める。
+void find_root_brent(RootState *state, double x0);
+// x0から範囲を広げながら、f(x0)と符号の変わる点を探す。(見つからなければfalse)
+bool search_bracket(RootState *state, double x0, double fx0, double *x1, double *fx1);
+
+RootOptions get_default_root_options(RootMethod method)
+{
+    RootOptions options;
+    options.method = method;
+    options.tolerance = DEFAULT_TOLERANCE;
+    options.x_tolerance = 0;
+    options.max_iter_count = DEFAULT_MAX_ITER_COUNT;
+    options.x1 = NAN;
+    options.observer = NULL;
+    options.observer_userdata = NULL;
+    return options;
+}
+
+const char *get_root_method_name(RootMethod method)
+{
+    switch (method)
+    {
+    case root_newton:
+        return "ニュートン法";
+    case root_halley:
+        return "ハレー法";
+    case root_secant:
+        return "割線法";
+    case root_brent:
+        return "ブレント法";
+    default:
+        return "不明な解法";
+    }
+}
+
+RootResult find_root(RootFunction function, void *userdata, double x0, RootOptions *options)
+{
+    RootState state;
+    state.function = function;
+    state.userdata = userdata;
+    state.options = options;
+    state.result.root = x0;
+    state.result.is_converged = false;
+    state.result.iteration_count = 0;
+    state.result.evaluation_count = 0;
+    switch (options->method)
+    {
+    case root_newton:
+        find_root_newton(&state, x0, 1);
+        break;
+    case root_halley:
+        find_root_newton(&state, x0, 2);
+        break;
+    case root_secant:
+        find_root_secant(&state, x0);
+        break;
+    case root_brent:
+        find_root_brent(&state, x0);
+        break;
+    default:
+        break;
+    }
+    return state.result;
+}
+
+void evaluate_root_function(RootState *state, double x, int order, double *values)
+{
+    state->function(x, order, values, state->userdata);
+    state->result.evaluation_count++;
+}
+
+void notify_root_observer(RootState *state, int iteration, double x, double fx, double slope)
+{
+    if (state->options->observer != NULL)
+    {
+        state->options->observer(iteration, x, fx, slope, state->options->observer_userdata);
+    }
+}
+
+bool is_root_converged(RootOptions *options, double fx, double dx)
+{
+    return fabs(fx) < options->tolerance || (options->x_tolerance > 0 && fabs(dx) <= options->x_tolerance);
+}
+
+void find_root_newton(RootState *state, double x0, int order)
+{
+    int i, j;
+    RootOptions *options = state->options;
+    // values[0]: f(x), values[1]: f'(x), values[2]: f''(x)
+    double values[3];
+    double next_values[3];
+    double x = x0;
+    // 符号の変わる区間[low, high](見つかるまではhas_bracketがfalse)
+    bool has_bracket = false;
+    double low = 0, high = 0, f_low = 0;
+    evaluate_root_function(state, x, order, values);
+    notify_root_observer(state, 0, x, values[0], values[1]);
+    state->result.root = x;
+    if (is_root_converged(options, values[0], INFINITY))
+    {
+        state->result.is_converged = true;
+        return;
+    }
+    for (i = 1; i <= options->max_iter_count; i++)
+    {
+        double dx;
+        if (order == 2)
+        {
+            // ハレー法: x - 2ff' / (2f'^2 - ff'')
+            dx = -2 * values[0] * values[1] / (2 * values[1] * values[1] - values[0] * values[2]);
+        }
+        else
+        {
+            dx = -values[0] / values[1];
+        }
+        double next_x = x + dx;
+        if (has_bracket && !(low < next_x && next_x < high))
+        {
+            // 区間の外に出る場合は二分法に切り替える。
+            next_x = (low + high) / 2;
+        }
+        else if (!isfinite(next_x))
+        {
+            // 微分係数が0で、区間も分からなければ先に進めない。
+            break;
+        }
+        evaluate_root_function(state, next_x, order, next_values);
+        // 区間が分かっていない間は、|f(x)|が増えるなら歩幅を縮める。
+        for (j = 0; !has_bracket && j < MAX_DAMPING_COUNT && !(fabs(next_values[0]) <= fabs(values[0])); j++)
+        {
+            if (signbit(next_values[0]) != signbit(values[0]) && isfinite(next_values[0]))
+            {
+                break;
+            }
+            dx /= 2;
+            next_x = x + dx;
+            evaluate_root_function(state, next_x, order, next_values);
+        }
+        // 符号の変わる区間を更新する。
+        if (has_bracket)
+        {
+            if (signbit(next_values[0]) == signbit(f_low))
+            {
+                low = next_x;
+                f_low = next_values[0];
+            }
+            else
+            {
+                high = next_x;
+            }
+        }
+        else if (signbit(next_values[0]) != signbit(values[0]) && isfinite(next_values[0]))
+        {
+            has_bracket = true;
+            low = fmin(x, next_x);
+            high = fmax(x, next_x);
+            f_low = x < next_x ? values[0] : next_values[0];
+        }
+        dx = next_x - x;
+        x = next_x;
+        for (j = 0; j <= order; j++)
+        {
+            values[j] = next_values[j];
+        }
+        state->result.root = x;
+        state->result.iteration_count = i;
+        notify_root_observer(state, i, x, values[0], values[1]);
+        if (is_root_converged(options, values[0], dx))
+        {
+            state->result.is_converged = true;
+            return;
+        }
+    }
+}
+
+void find_root_secant(RootState *state, double x0)
+{
+    int i;
+    RootOptions *options = state->options;
+    double previous_x = x0;
+    double previous_fx;
+    evaluate_root_function(state, previous_x, 0, &previous_fx);
+    state->result.root = x0;
+    if (is_root_converged(options, previous_fx, INFINITY))
+    {
+        notify_root_observer(state, 0, x0, previous_fx, NAN);
+        state->result.is_converged = true;
+        return;
+    }
+    // 2つ目の初期値が指定されていなければ、x0の少し隣の点にする。
+    double x = isnan(options->x1) ? x0 + 1.0e-4 * (fabs(x0) + 1) : options->x1;
+    double fx;
+    evaluate_root_function(state, x, 0, &fx);
+    // 0回目の近似解では、2つの初期値を通る割線を渡す。
+    notify_root_observer(state, 0, x0, previous_fx, (fx - previous_fx) / (x - previous_x));
+    for (i = 1; i <= options->max_iter_count; i++)
+    {
+        double slope = (fx - previous_fx) / (x - previous_x);
+        double next_x = x - fx / slope;
+        if (!isfinite(next_x))
+        {
+            break;
+        }
+        previous_x = x;
+        previous_fx = fx;
+        x = next_x;
+        evaluate_root_function(state, x, 0, &fx);
+        state->result.root = x;
+        state->result.iteration_count = i;
+        // 次の近似解を求める割線(直前の近似解との2点を通る直線)を渡す。
+        notify_root_observer(state, i, x, fx, (fx - previous_fx) / (x - previous_x));
+        if (is_root_converged(options, fx, x - previous_x))
+        {
+            state->result.is_converged = true;
+            return;
+        }
+    }
+}
+
+bool search_bracket(RootState *state, double x0, double fx0, double *x1, double *fx1)
+{
+    int i, side;
+    double step = 1.0e-2 * (fabs(x0) + 1);
+    for (i = 0; i < MAX_BRACKET_SEARCH_COUNT; i++)
+    {
+        // 両側を交互に調べる。
+        for (side = 1; side >= -1; side -= 2)
+        {
+            double x = x0 + side * step;
+            double fx;
+            evaluate_root_function(state, x, 0, &fx);
+            if (isfinite(fx) && signbit(fx) != signbit(fx0))
+            {
+                *x1 = x;
+                *fx1 = fx;
+                return true;
+            }
+        }
+        step *= 2;
+    }
+    return false;
+}
+
+void find_root_brent(RootState *state, double x0)
+{
+    int i;
+    RootOptions *options = state->options;
+    // 区間の端a, bと、bと符号の異なる端c。bが現在の近似解
+    double a = x0, b, c;
+    double fa, fb, fc;
+    evaluate_root_function(state, a, 0, &fa);
+    state->result.root = x0;
+    if (is_root_converged(options, fa, INFINITY))
+    {
+        notify_root_observer(state, 0, x0, fa, NAN);
+        state->result.is_converged = true;
+        return;
+    }
+    if (isnan(options->x1))
+    {
+        if (!search_bracket(state, a, fa, &b, &fb))
+        {
+            notify_root_observer(state, 0, x0, fa, NAN);
+            return;
+        }
+    }
+    else
+    {
+        b = options->x1;
+        evaluate_root_function(state, b, 0, &fb);
+        if (signbit(fa) == signbit(fb))
+        {
+            notify_root_observer(state, 0, x0, fa, NAN);
+            return;
+        }
+    }
+    notify_root_observer(state, 0, x0, fa, (fb - fa) / (b - a));
+    c = a;
+    fc = fa;
+    // d: 今回の歩幅, e: 前回の歩幅
+    double d = b - a, e = d;
+    for (i = 1; i <= options->max_iter_count; i++)
+    {
+        if (signbit(fb) == signbit(fc))
+        {
+            c = a;
+            fc = fa;
+            d = b - a;
+            e = d;
+        }
+        if (fabs(fc) < fabs(fb))
+        {
+            a = b;
+            b = c;
+            c = a;
+            fa = fb;
+            fb = fc;
+            fc = fa;
+        }
+        double tolerance = 2 * DBL_EPSILON * fabs(b) + options->x_tolerance / 2;
+        double middle = (c - b) / 2;
+        if (fabs(middle) <= tolerance || fabs(fb) < options->tolerance || fb == 0)
+        {
+            state->result.is_converged = true;
+            break;
+        }
+        if (fabs(e) >= tolerance && fabs(fa) > fabs(fb))
+        {
+            // 逆2次補間(2点しかなければ割線)を試す。
+            double s = fb / fa;
+            double p, q;
+            if (a == c)
+            {
+                p = 2 * middle * s;
+                q = 1 - s;
+            }
+            else
+            {
+                double r = fb / fc;
+                q = fa / fc;
+                p = s * (2 * middle * q * (q - r) - (b - a) * (r - 1));
+                q = (q - 1) * (r - 1) * (s - 1);
+            }
+            if (p > 0)
+            {
+                q = -q;
+            }
+            p = fabs(p);
+            if (2 * p < fmin(3 * middle * q - fabs(tolerance * q), fabs(e * q)))
+            {
+                e = d;
+                d = p / q;
+            }
+            else
+            {
+                // 補間がうまくいかないので二分法にする。
+                d = middle;
+                e = d;
+            }
+        }
+        else
+        {
+            d = middle;
+            e = d;
+        }
+        a = b;
+        fa = fb;
+        b += fabs(d) > tolerance ? d : copysign(tolerance, middle);
+        evaluate_root_function(state, b, 0, &fb);
+        state->result.root = b;
+        state->result.iteration_count = i;
+        // 区間の両端を通る割線を渡す。
+        notify_root_observer(state, i, b, fb, signbit(fb) == signbit(fc) ? (fb - fa) / (b - a) : (fc - fb) / (c - b));
+        if (fabs(fb) < options->tolerance || fb == 0)
+        {
+            state->result.is_converged = true;
+            break;
+        }
+    }
+    state->result.root = b;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef ROOT_FINDER
+#define ROOT_FINDER
+#include <stdbool.h>
+
+// 方程式f(x) = 0の解法
+typedef enum root_method
+{
+    root_newton, // ニュートン法(|f(x)|が増える場合は歩幅を縮め、符号の変わる区間が分かっていればその外に出ないようにする)
+    root_halley, // ハレー法(2階微分係数も使う3次収束の解法。ニュートン法と同じ安全策を取る)
+    root_secant, // 割線法(微分係数を使わない)
+    root_brent,  // ブレント法(符号の変わる区間を狭めていく。区間が見つかれば必ず収束する)
+    root_method_count,
+} RootMethod;
+
+// 解を求める関数。xにおける値とorder階までの微分係数を、values[0], values[1], ...に書き込む。
+typedef void (*RootFunction)(double x, int order, double *values, void *userdata);
+// 反復ごとに呼ばれる関数。iteration回目の近似解x(0回目は初期値)とその値fx、
+// 次の近似解を求めるのに使う直線(接線や割線)の傾きslopeを受け取る。(直線を使わない場合はNAN)
+typedef void (*RootObserver)(int iteration, double x, double fx, double slope, void *userdata);
+
+// 解法の設定
+typedef struct root_options
+{
+    RootMethod method;
+    // |f(x)|がこれより小さくなったら収束とする
+    double tolerance;
+    // 近似解の変化(ブレント法では区間の幅)がこれ以下になっても収束とする(0なら使わない)
+    double x_tolerance;
+    // 反復回数の上限
+    int max_iter_count;
+    // 割線法の2つ目の初期値、またはブレント法の区間のもう一方の端(NANなら初期値の近くから自動で決める)
+    double x1;
+    // 反復ごとに呼ばれる関数(NULLなら呼ばない)
+    RootObserver observer;
+    void *observer_userdata;
+} RootOptions;
+
+// 解法の結果
+typedef struct root_result
+{
+    // 近似解(収束しなかった場合は最後の値)
+    double root;
+    // 収束したか
+    bool is_converged;
+    // 反復回数
+    int iteration_count;
+    // 関数を計算した回数(微分係数も同時に求めた場合も1回と数える)
+    int evaluation_count;
+} RootResult;
+
+// 既定の設定(許容誤差1e-10, 最大100反復)を返す。
+RootOptions get_default_root_options(RootMethod method);
+// 初期値x0から、設定した解法で方程式function(x) = 0の解を求める。(userdataはfunctionにそのまま渡す)
+RootResult find_root(RootFunction function, void *userdata, double x0, RootOptions *options);
+// 解法の名前を返す。
+const char *get_root_method_name(RootMethod method);
+
+#endif
\ No newline at end of file